@@ -0,0 +1,50 @@
+#include "arena.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+
+Arena permanent_arena;
+
+static map<unsigned int, unique_ptr<Arena>> year_arenas;
+static mutex year_arenas_mutex;
+
+
+Arena::Arena(size_t initial_block_size) : blocks(initial_block_size) {}
+
+
+// Objects are destroyed newest first, in case later objects refer to earlier ones
+Arena::~Arena() {
+    for (auto it = destructors.rbegin(); it != destructors.rend(); it++) {
+        it->second(it->first);
+    }
+}
+
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    lock_guard<mutex> lock(arena_mutex);
+    return blocks.allocate(bytes, alignment);
+}
+
+
+Arena& get_year_arena(unsigned int year) {
+    lock_guard<mutex> lock(year_arenas_mutex);
+    unique_ptr<Arena>& arena = year_arenas[year];
+    if (!arena) arena = make_unique<Arena>();
+    return *arena;
+}
+
+
+void release_year_arena(unsigned int year) {
+    unique_ptr<Arena> arena;
+    {
+        lock_guard<mutex> lock(year_arenas_mutex);
+        auto it = year_arenas.find(year);
+        if (it == year_arenas.end()) return;
+        arena = move(it->second);
+        year_arenas.erase(it);
+    }
+}
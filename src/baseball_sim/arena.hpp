@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+#include <type_traits>
+#include <new>
+
+
+/* Bump allocator for data that is loaded once and then only read (stat tables and everything inside them).
+Allocations are carved out of large blocks one after another, so a table's columns end up next to each other in memory,
+and nothing is freed until the whole arena is destroyed, which releases all of its blocks at once.
+Arenas can be handed to std::pmr containers as their memory resource. Allocating is thread safe. */
+class Arena : public std::pmr::memory_resource {
+    public:
+        Arena(size_t initial_block_size = 64*1024);
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Builds an object inside the arena. Its destructor is run when the arena is destroyed.
+        template <class T, class... Args>
+        T* create(Args&&... args) {
+            T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                std::lock_guard<std::mutex> lock(arena_mutex);
+                destructors.push_back({object, [](void* p) { static_cast<T*>(p)->~T(); }});
+            }
+            return object;
+        }
+
+        // Copies the characters into the arena, the view stays valid for as long as the arena lives
+        std::string_view copy_string(std::string_view str) {
+            char* chars = static_cast<char*>(allocate(std::max<size_t>(str.size(), 1), 1));
+            std::copy(str.begin(), str.end(), chars);
+            return std::string_view(chars, str.size());
+        }
+
+    private:
+        std::pmr::monotonic_buffer_resource blocks;
+        std::vector<std::pair<void*, void(*)(void*)>> destructors;
+        std::mutex arena_mutex;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {} // Memory is only given back when the arena is destroyed
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+
+
+// Holds data that is kept for the whole run (ex: player career tables, which are shared by every year)
+extern Arena permanent_arena;
+
+// Holds the team and league tables of a single year
+Arena& get_year_arena(unsigned int year);
+
+// Destroys the year's arena, freeing all of its tables at once. Nothing may still point into it (see Stat_Loader::release_year).
+void release_year_arena(unsigned int year);
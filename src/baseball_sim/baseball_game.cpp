@@ -8,9 +8,20 @@
 #include <time.h>
 #include <cassert>
 
-Baseball_Game::Baseball_Game(Team* home_team, Team* away_team, uint day_of_year) {
+Baseball_Game::Baseball_Game(Team_Game_State* home_team, Team_Game_State* away_team, uint day_of_year, Game_Event_Recorder* event_recorder)
+    : Baseball_Game(home_team, away_team, day_of_year, probability_store.get_matchup_table(home_team->team, away_team->team),
+                    probability_store.get_matchup_table(away_team->team, home_team->team), event_recorder) {}
+
+
+Baseball_Game::Baseball_Game(Team_Game_State* home_team, Team_Game_State* away_team, uint day_of_year, const Matchup_Table& home_batting_table,
+                             const Matchup_Table& away_batting_table, Game_Event_Recorder* event_recorder) {
     teams[HOME_TEAM] = home_team;
     teams[AWAY_TEAM] = away_team;
+    this->event_recorder = event_recorder;
+    half_inning_players[HOME_TEAM] = get_half_inning_player(home_team, away_team, event_recorder != NULL);
+    half_inning_players[AWAY_TEAM] = get_half_inning_player(away_team, home_team, event_recorder != NULL);
+    matchup_tables[HOME_TEAM] = &home_batting_table;
+    matchup_tables[AWAY_TEAM] = &away_batting_table;
 
     score[HOME_TEAM] = 0;
     score[AWAY_TEAM] = 0;
@@ -22,9 +33,20 @@ Baseball_Game::Baseball_Game(Team* home_team, Team* away_team, uint day_of_year)
 }
 
 
+Baseball_Game::Baseball_Game(Team_Game_State* home_team, Team_Game_State* away_team, uint day_of_year, const Game_Situation& situation, Game_Event_Recorder* event_recorder)
+    : Baseball_Game(home_team, away_team, day_of_year, event_recorder) {
+    half_inning_count = situation.half_inning_count;
+    team_batting = (half_inning_count % 2) ? HOME_TEAM : AWAY_TEAM;
+    score[HOME_TEAM] = situation.score[HOME_TEAM];
+    score[AWAY_TEAM] = situation.score[AWAY_TEAM];
+    half_inning_start = situation.half_inning;
+    resuming_half_inning = true;
+}
+
+
 Game_Result Baseball_Game::play_game() {
     game_viewer_line(
-        std::cout << "MATCHUP: " + teams[AWAY_TEAM]->team_name + " @ " + teams[HOME_TEAM]->team_name + "\n";
+        std::cout << "MATCHUP: " + teams[AWAY_TEAM]->team->team_name + " @ " + teams[HOME_TEAM]->team->team_name + "\n";
         teams[AWAY_TEAM]->print_fielders();
         teams[HOME_TEAM]->print_fielders();
 
@@ -32,42 +54,43 @@ Game_Result Baseball_Game::play_game() {
         teams[HOME_TEAM]->print_batting_order();
     )
 
-    // Play first 8.5 innings
-    while (half_inning_count < MAX_HALF_INNINGS-1) {
+    // A game picked up in the middle of a half inning finishes it before checking whether the game is over
+    while (resuming_half_inning || !is_game_over()) {
         int runs_scored = play_half_inning();
         score[team_batting] += runs_scored;
         team_batting = !team_batting;
-    }
-
-    // keep playing innings until someone wins
-    if (score[HOME_TEAM] <= score[AWAY_TEAM]) {
-        while ((half_inning_count%2 == 1) || (score[HOME_TEAM] == score[AWAY_TEAM])) {
-            int runs_scored = play_half_inning();
-            score[team_batting] += runs_scored;
-            team_batting = !team_batting;
-        }
+        resuming_half_inning = false;
     }
 
     game_viewer_line(print_game_result());
-    return Game_Result(teams[HOME_TEAM], teams[AWAY_TEAM], score, half_inning_count);
+    return Game_Result(score, half_inning_count);
 }
 
 
 uint8_t Baseball_Game::play_half_inning() {
-    game_viewer_print(teams[AWAY_TEAM]->team_name +"| " << score[AWAY_TEAM] <<"-"<< score[HOME_TEAM] << " |"+ teams[HOME_TEAM]->team_name + "\n");
-    Half_Inning inning(teams[team_batting], teams[!team_batting], half_inning_count, day_of_year, get_runs_to_end_game());
-    int runs_scored = inning.play();
+    game_viewer_print(teams[AWAY_TEAM]->team->team_name +"| " << score[AWAY_TEAM] <<"-"<< score[HOME_TEAM] << " |"+ teams[HOME_TEAM]->team->team_name + "\n");
+    int runs_scored = half_inning_players[team_batting](teams[team_batting], teams[!team_batting], matchup_tables[team_batting], half_inning_count, day_of_year,
+                                                        get_runs_to_end_game(), half_inning_start, event_recorder);
+    half_inning_start = Half_Inning_Situation();
     half_inning_count++;
     return runs_scored;
 }
 
 
+// Play the first 8.5 innings, then keep playing until someone wins. Only checked between half innings.
+bool Baseball_Game::is_game_over() {
+    if (half_inning_count < MAX_HALF_INNINGS-1) return false;
+    if (half_inning_count%2 == 1) return score[HOME_TEAM] > score[AWAY_TEAM]; // The home team doesn't bat in the bottom half if it is already ahead
+    return score[HOME_TEAM] != score[AWAY_TEAM];
+}
+
+
 void Baseball_Game::print_game_result() {
     if (score[HOME_TEAM] > score[AWAY_TEAM]) {
-        std::cout << teams[HOME_TEAM]->team_name << " wins!" << "\n";
+        std::cout << teams[HOME_TEAM]->team->team_name << " wins!" << "\n";
     }
     else {
-        std::cout << teams[AWAY_TEAM]->team_name << " wins!" << "\n";
+        std::cout << teams[AWAY_TEAM]->team->team_name << " wins!" << "\n";
     }
     std::cout << "TOTAL INNINGS: " << (float)half_inning_count/2 << "\n";
     std::cout << "FINAL SCORE: " << score[HOME_TEAM] << " - " << score[AWAY_TEAM] << "\n\n";
@@ -7,20 +7,40 @@
 
 const int MAX_HALF_INNINGS = 18;
 
+
+// Where a game in progress stands at the start of a plate appearance. The score includes the runs scored so far in the current half inning.
+struct Game_Situation {
+    uint8_t half_inning_count = 0;
+    int score[2] = {0, 0};
+    Half_Inning_Situation half_inning; // Outs and runners in the current half inning
+};
+
 class Baseball_Game {
     public:
         uint day_of_year;
         uint8_t half_inning_count;
         uint8_t team_batting;
         int score[2];
-        Team* teams[2];
+        Team_Game_State* teams[2];
+        Half_Inning_Player half_inning_players[2]; // Indexed by the team at bat, chosen once per game by the teams' stat eras
+        const Matchup_Table* matchup_tables[2]; // Indexed by the team at bat
+        Game_Event_Recorder* event_recorder; // NULL unless this game is written to an event log
 
-        Baseball_Game(Team* home_team, Team* away_team, uint day_of_year);
+        Baseball_Game(Team_Game_State* home_team, Team_Game_State* away_team, uint day_of_year, Game_Event_Recorder* event_recorder = NULL);
+        // Plays with the given matchup tables instead of the store's (see Player_Value_Evaluator)
+        Baseball_Game(Team_Game_State* home_team, Team_Game_State* away_team, uint day_of_year, const Matchup_Table& home_batting_table,
+                      const Matchup_Table& away_batting_table, Game_Event_Recorder* event_recorder = NULL);
+        // Picks up a game in progress. The teams' game states must already be where the situation has them (see Game_Snapshot).
+        Baseball_Game(Team_Game_State* home_team, Team_Game_State* away_team, uint day_of_year, const Game_Situation& situation, Game_Event_Recorder* event_recorder = NULL);
 
         Game_Result play_game();
         void print_game_result();
     
     private:
+        Half_Inning_Situation half_inning_start; // Only set for the first half inning of a game that was picked up in the middle of it
+        bool resuming_half_inning = false;
+
         uint8_t play_half_inning();
+        bool is_game_over();
         float get_runs_to_end_game();
 };
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "career_store.hpp"
+
+#include <vector>
+#include <array>
+#include <shared_mutex>
+#include <mutex>
+
+using namespace std;
+
+
+Career_Store career_store;
+
+
+const Stat_Table* Career_Store::find(Entity_Id player_id_number, ePlayer_Stat_Types stat_type) const {
+    shared_lock<shared_mutex> lock(store_mutex);
+    if (player_id_number >= tables_by_player.size()) return NULL;
+    return tables_by_player[player_id_number][stat_type];
+}
+
+
+const Stat_Table* Career_Store::add(Entity_Id player_id_number, ePlayer_Stat_Types stat_type, Stat_Table&& table) {
+    unique_lock<shared_mutex> lock(store_mutex);
+    if (player_id_number >= tables_by_player.size()) {
+        array<const Stat_Table*, NUM_PLAYER_STAT_TYPES> no_tables;
+        no_tables.fill(NULL);
+        tables_by_player.resize(player_id_number + 1, no_tables);
+    }
+
+    const Stat_Table*& stored_table = tables_by_player[player_id_number][stat_type];
+    if (stored_table == NULL) {
+        tables.push_back(move(table));
+        stored_table = &tables.back();
+    }
+    return stored_table;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "statistics.hpp"
+#include "registry.hpp"
+#include "table.hpp"
+
+#include <vector>
+#include <array>
+#include <deque>
+#include <shared_mutex>
+
+
+/* Every player's career stat tables, parsed once per process no matter how many teams and years the player is loaded for.
+Tables are indexed by the player's id number (see player_id_registry) and stat type, and are never changed or removed
+once they are added (releasing a year keeps them, along with the id numbers), so the pointers handed out stay valid for the
+rest of the run. Thread safe. */
+class Career_Store {
+    public:
+        // Returns NULL if this table has not been added yet
+        const Stat_Table* find(Entity_Id player_id_number, ePlayer_Stat_Types stat_type) const;
+
+        // If another thread added this table first, that one is kept. Returns the stored table.
+        const Stat_Table* add(Entity_Id player_id_number, ePlayer_Stat_Types stat_type, Stat_Table&& table);
+
+    private:
+        std::vector<std::array<const Stat_Table*, NUM_PLAYER_STAT_TYPES>> tables_by_player;
+        std::deque<Stat_Table> tables;
+        mutable std::shared_mutex store_mutex;
+};
+
+
+extern Career_Store career_store;
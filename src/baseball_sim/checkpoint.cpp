@@ -0,0 +1,205 @@
+#include "checkpoint.hpp"
+
+#include "serialization.hpp"
+#include "season.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <csignal>
+#include <stdexcept>
+
+using namespace std;
+
+
+const uint32_t CHECKPOINT_MAGIC = 0x4b434242; // "BBCK"
+const uint32_t CHECKPOINT_VERSION = 5;
+
+static volatile sig_atomic_t interrupt_requested = 0;
+
+
+void Simulation_Config::write(Binary_Writer& writer) const {
+    writer.write<uint32_t>(sim_type);
+    writer.write<uint32_t>(num_sims);
+    writer.write<uint32_t>(first_sim);
+    writer.write<uint64_t>(seed);
+    writer.write<uint32_t>(season_year);
+    for (int i = 0; i < 2; i++) {
+        writer.write_string(team_abbrs[i]);
+        writer.write<uint32_t>(team_years[i]);
+    }
+    writer.write<uint32_t>(games_in_series);
+}
+
+
+void Simulation_Config::read(Binary_Reader& reader) {
+    sim_type = (eSimulation_Type)reader.read<uint32_t>();
+    num_sims = reader.read<uint32_t>();
+    first_sim = reader.read<uint32_t>();
+    seed = reader.read<uint64_t>();
+    season_year = reader.read<uint32_t>();
+    for (int i = 0; i < 2; i++) {
+        team_abbrs[i] = reader.read_string();
+        team_years[i] = reader.read<uint32_t>();
+    }
+    games_in_series = reader.read<uint32_t>();
+}
+
+
+// Shards of the same run simulate the same thing with the same seed, they only differ in which simulations they cover
+bool Simulation_Config::is_shard_of_same_run(const Simulation_Config& other) const {
+    if ((sim_type != other.sim_type) || (seed != other.seed)) return false;
+    if (sim_type == SIM_SEASON) return season_year == other.season_year;
+
+    for (int i = 0; i < 2; i++) {
+        if ((team_abbrs[i] != other.team_abbrs[i]) || (team_years[i] != other.team_years[i])) return false;
+    }
+    return games_in_series == other.games_in_series;
+}
+
+
+Checkpointer::Checkpointer(const string& filename, const Simulation_Config& config, float interval_seconds) {
+    this->filename = filename;
+    this->config = config;
+    this->interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<float>(interval_seconds));
+    this->last_save = chrono::steady_clock::now();
+}
+
+
+// A non-positive interval means we only checkpoint when the run ends or is interrupted
+bool Checkpointer::is_due() const {
+    return (interval > chrono::steady_clock::duration::zero()) && (chrono::steady_clock::now() - last_save >= interval);
+}
+
+
+void Checkpointer::save(const Season& season) {
+    string temp_filename = filename + ".tmp";
+    Binary_Writer writer = begin_save(temp_filename, season.sims_completed);
+    season.save_state(writer);
+    finish_save(writer, temp_filename);
+}
+
+
+void Checkpointer::save(const Series& series) {
+    string temp_filename = filename + ".tmp";
+    Binary_Writer writer = begin_save(temp_filename, series.sims_completed);
+    series.save_state(writer);
+    finish_save(writer, temp_filename);
+}
+
+
+Binary_Writer Checkpointer::begin_save(const string& temp_filename, uint sims_completed) {
+    Binary_Writer writer(temp_filename);
+    writer.write(CHECKPOINT_MAGIC);
+    writer.write(CHECKPOINT_VERSION);
+    config.write(writer);
+    writer.write<uint32_t>(sims_completed);
+    return writer;
+}
+
+
+// We write to a temporary file and then rename it, so an interruption in the middle of a save never leaves us without a valid checkpoint
+void Checkpointer::finish_save(Binary_Writer& writer, const string& temp_filename) {
+    writer.close();
+    if (rename(temp_filename.c_str(), filename.c_str()) != 0) {
+        throw runtime_error("Could not move checkpoint into place at " + filename);
+    }
+    last_save = chrono::steady_clock::now();
+}
+
+
+static Binary_Reader open_checkpoint(const string& filename, Simulation_Config& config) {
+    Binary_Reader reader(filename);
+    if (reader.read<uint32_t>() != CHECKPOINT_MAGIC) {
+        throw runtime_error(filename + " is not a simulation checkpoint");
+    }
+    if (reader.read<uint32_t>() != CHECKPOINT_VERSION) {
+        throw runtime_error(filename + " was written by an incompatible version of the simulation");
+    }
+    config.read(reader);
+    return reader;
+}
+
+
+Simulation_Config read_checkpoint_config(const string& filename, uint* sims_completed) {
+    Simulation_Config config;
+    Binary_Reader reader = open_checkpoint(filename, config);
+    if (sims_completed) *sims_completed = reader.read<uint32_t>();
+    return config;
+}
+
+
+void merge_checkpoint(const string& filename, Season& season) {
+    Simulation_Config config;
+    Binary_Reader reader = open_checkpoint(filename, config);
+    uint sims_completed = reader.read<uint32_t>();
+    season.merge_state(reader, sims_completed);
+}
+
+
+void merge_checkpoint(const string& filename, Series& series) {
+    Simulation_Config config;
+    Binary_Reader reader = open_checkpoint(filename, config);
+    uint sims_completed = reader.read<uint32_t>();
+    series.merge_state(reader, sims_completed);
+}
+
+
+// Makes sure all the shards come from the same run and don't cover any simulation twice.
+// Returns a config describing the merged run.
+Simulation_Config check_shards_can_merge(const vector<string>& filenames) {
+    if (filenames.empty()) {
+        cerr << "No shard files given to merge\n";
+        throw exception();
+    }
+
+    vector<pair<uint, uint>> sim_ranges;
+    Simulation_Config merged_config;
+    for (size_t i = 0; i < filenames.size(); i++) {
+        uint sims_completed;
+        Simulation_Config config = read_checkpoint_config(filenames[i], &sims_completed);
+
+        if (i == 0) {
+            merged_config = config;
+            merged_config.num_sims = 0;
+        }
+        else if (!config.is_shard_of_same_run(merged_config)) {
+            cerr << "Shard " << filenames[i] << " is not from the same run as " << filenames[0] << "\n";
+            throw exception();
+        }
+
+        if (sims_completed < config.num_sims) {
+            cerr << "WARNING: shard " << filenames[i] << " is incomplete (" << sims_completed << " of " << config.num_sims << " simulations), merging its partial results\n";
+        }
+        sim_ranges.push_back({config.first_sim, config.first_sim + config.num_sims});
+        merged_config.num_sims += sims_completed;
+    }
+
+    sort(sim_ranges.begin(), sim_ranges.end());
+    for (size_t i = 1; i < sim_ranges.size(); i++) {
+        if (sim_ranges[i].first < sim_ranges[i-1].second) {
+            cerr << "Shards overlap: simulations " << sim_ranges[i].first << " to " << sim_ranges[i-1].second - 1 << " are covered more than once\n";
+            throw exception();
+        }
+    }
+    return merged_config;
+}
+
+
+static void handle_interrupt(int signal) {
+    interrupt_requested = 1;
+    std::signal(signal, SIG_DFL);
+}
+
+
+void install_interrupt_handler() {
+    std::signal(SIGINT, handle_interrupt);
+}
+
+
+bool simulation_interrupted() {
+    return interrupt_requested;
+}
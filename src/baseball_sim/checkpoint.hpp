@@ -0,0 +1,71 @@
+#pragma once
+
+#include "includes.hpp"
+#include "serialization.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+
+class Season;
+class Series;
+
+enum eSimulation_Type {
+    SIM_SERIES,
+    SIM_SEASON
+};
+
+// Everything needed to set up a simulation run again from scratch (which teams, how many games, etc.)
+struct Simulation_Config {
+    eSimulation_Type sim_type = SIM_SEASON;
+    uint num_sims = 0;
+    uint first_sim = 0; // Index of the first simulation in this run, so shards of a big run can cover different ranges
+    uint64_t seed = 0;
+
+    // Season only
+    uint season_year = 0;
+
+    // Series only, indexed by eTeam
+    std::string team_abbrs[2];
+    uint team_years[2] = {0, 0};
+    uint games_in_series = 0;
+
+    void write(Binary_Writer& writer) const;
+    void read(Binary_Reader& reader);
+    bool is_shard_of_same_run(const Simulation_Config& other) const;
+};
+
+
+/* Periodically saves the accumulated results of a run to a checkpoint file, so that a long run can be resumed with --resume if it gets interrupted.
+Since every simulation is seeded from the run's seed and its own index, the config and the number of completed simulations are all we need to
+know where the random streams left off.
+The final checkpoint of a run also serves as its shard file when a run is split across processes (see merge_shards). */
+class Checkpointer {
+    public:
+        Checkpointer(const std::string& filename, const Simulation_Config& config, float interval_seconds);
+
+        bool is_due() const;
+        void save(const Season& season);
+        void save(const Series& series);
+
+    private:
+        std::string filename;
+        Simulation_Config config;
+        std::chrono::steady_clock::duration interval;
+        std::chrono::steady_clock::time_point last_save;
+
+        Binary_Writer begin_save(const std::string& temp_filename, uint sims_completed);
+        void finish_save(Binary_Writer& writer, const std::string& temp_filename);
+};
+
+
+Simulation_Config read_checkpoint_config(const std::string& filename, uint* sims_completed = NULL);
+void merge_checkpoint(const std::string& filename, Season& season);
+void merge_checkpoint(const std::string& filename, Series& series);
+Simulation_Config check_shards_can_merge(const std::vector<std::string>& filenames);
+
+// SIGINT handling: the first interrupt asks the simulation to stop at the next safe point, a second one kills the process as usual.
+void install_interrupt_handler();
+bool simulation_interrupted();
@@ -0,0 +1,449 @@
+#include "event_log.hpp"
+
+#include "includes.hpp"
+#include "team.hpp"
+#include "game_states.hpp"
+#include "serialization.hpp"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <stdexcept>
+#include <iostream>
+
+using namespace std;
+
+
+const uint32_t EVENT_LOG_VERSION = 1;
+const char EVENT_LOG_MAGIC[8] = {'B', 'B', 'E', 'V', 'L', 'O', 'G', '\0'};
+const size_t EVENT_LOG_CHUNK_SIZE = 1 << 20; // Bytes, a chunk is handed to the writer thread at the end of the first game that fills it
+const size_t MAX_PENDING_CHUNKS = 8; // If the disk falls this far behind the simulation waits for it
+
+// Lineup slots hold a player's index in team->all_players plus one, or this if the slot is wherever the current pitcher bats
+const uint PITCHER_SLOT = 0;
+
+
+static void write_log_string(Game_Event_Recorder& out, const string& str) {
+    out.write_varint(str.size());
+    out.bytes.insert(out.bytes.end(), str.begin(), str.end());
+}
+
+
+// Signed deltas are zigzag encoded so small steps in either direction stay one byte
+static uint64_t zigzag_encode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+// The teams and their players, which every log starts with
+static void write_log_teams(Game_Event_Recorder& out, const vector<const Team_Definition*>& teams, vector<unordered_map<const Player*, uint>>& player_indices) {
+    out.write_varint(teams.size());
+    for (const Team_Definition* team : teams) {
+        write_log_string(out, team->team_stats.team_cache_id);
+        out.write_varint(team->all_players.size());
+        unordered_map<const Player*, uint>& team_player_indices = player_indices.emplace_back();
+        for (uint i = 0; i < team->all_players.size(); i++) {
+            write_log_string(out, team->all_players[i]->id);
+            write_log_string(out, team->all_players[i]->name);
+            team_player_indices[team->all_players[i]] = i;
+        }
+        out.write_varint(team->pitchers.size());
+        for (const Player* pitcher : team->pitchers) {
+            out.write_varint(team_player_indices.at(pitcher));
+        }
+    }
+}
+
+
+static void write_log_lineup(Game_Event_Recorder& out, const Team_Game_State& team_state, const unordered_map<const Player*, uint>& team_player_indices) {
+    out.write_varint(team_state.get_pitcher_index());
+    for (int i = 0; i < 9; i++) {
+        if (team_state.team->most_common_batting_order[i] == NULL) out.write_varint(PITCHER_SLOT);
+        else out.write_varint(team_player_indices.at(team_state.batting_order[i]) + 1);
+    }
+}
+
+
+// Everything a game starts with after its simulation index and day: which teams play and both lineups
+static void write_log_game_start(Game_Event_Recorder& out, const vector<unordered_map<const Player*, uint>>& player_indices,
+                                 uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) {
+    out.write_varint(away_index);
+    out.write_varint(home_index);
+    write_log_lineup(out, away_state, player_indices[away_index]);
+    write_log_lineup(out, home_state, player_indices[home_index]);
+}
+
+
+Event_Log::Event_Log(const string& filename, const vector<const Team_Definition*>& teams) : filename(filename), file(filename, ios::binary) {
+    if (!file.is_open()) {
+        throw runtime_error("Could not open event log " + filename);
+    }
+
+    Game_Event_Recorder header;
+    header.bytes.insert(header.bytes.end(), EVENT_LOG_MAGIC, EVENT_LOG_MAGIC + sizeof(EVENT_LOG_MAGIC));
+    header.write_varint(EVENT_LOG_VERSION);
+    write_log_teams(header, teams, player_indices);
+    file.write(reinterpret_cast<const char*>(header.bytes.data()), header.bytes.size());
+
+    recorder.bytes.reserve(EVENT_LOG_CHUNK_SIZE*2);
+    writer_thread = thread(&Event_Log::write_chunks, this);
+}
+
+
+Event_Log::~Event_Log() {
+    close();
+}
+
+
+Game_Event_Recorder* Event_Log::begin_game(uint sim_index, uint day_of_year, uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) {
+    if (games_in_chunk == 0) { // Chunks are decoded on their own, so their first game is a delta from 0
+        previous_sim_index = 0;
+        previous_day_of_year = 0;
+    }
+    recorder.write_varint(zigzag_encode((int64_t)sim_index - (int64_t)previous_sim_index));
+    recorder.write_varint(zigzag_encode((int64_t)day_of_year - (int64_t)previous_day_of_year));
+    previous_sim_index = sim_index;
+    previous_day_of_year = day_of_year;
+
+    write_log_game_start(recorder, player_indices, home_index, home_state, away_index, away_state);
+    return &recorder;
+}
+
+
+void Event_Log::end_game() {
+    recorder.record_event(EVENT_GAME_END, 0);
+    games_in_chunk++;
+    if (recorder.bytes.size() >= EVENT_LOG_CHUNK_SIZE) submit_chunk();
+}
+
+
+void Event_Log::submit_chunk() {
+    if (games_in_chunk == 0) return;
+
+    unique_lock<mutex> lock(chunks_mutex);
+    chunks_changed.wait(lock, [this]() { return pending_chunks.size() < MAX_PENDING_CHUNKS; });
+    pending_chunks.emplace_back(games_in_chunk, move(recorder.bytes));
+    lock.unlock();
+    chunks_changed.notify_all();
+
+    recorder.bytes = vector<uint8_t>();
+    recorder.bytes.reserve(EVENT_LOG_CHUNK_SIZE*2);
+    games_in_chunk = 0;
+}
+
+
+// Runs on writer_thread until the log is closed and every chunk is written. Every chunk is written as [byte count][game count][bytes].
+void Event_Log::write_chunks() {
+    while (true) {
+        unique_lock<mutex> lock(chunks_mutex);
+        chunks_changed.wait(lock, [this]() { return !pending_chunks.empty() || closing; });
+        if (pending_chunks.empty()) return;
+        pair<uint32_t, vector<uint8_t>> chunk = move(pending_chunks.front());
+        pending_chunks.pop_front();
+        lock.unlock();
+        chunks_changed.notify_all();
+
+        uint32_t num_bytes = chunk.second.size();
+        file.write(reinterpret_cast<const char*>(&num_bytes), sizeof(num_bytes));
+        file.write(reinterpret_cast<const char*>(&chunk.first), sizeof(chunk.first));
+        file.write(reinterpret_cast<const char*>(chunk.second.data()), chunk.second.size());
+        if (!file.good()) write_failed = true;
+    }
+}
+
+
+// Errors are only reported, since this also runs when the log is destroyed
+void Event_Log::close() {
+    if (!writer_thread.joinable()) return;
+    submit_chunk();
+    {
+        lock_guard<mutex> lock(chunks_mutex);
+        closing = true;
+    }
+    chunks_changed.notify_all();
+    writer_thread.join();
+
+    file.close();
+    if (write_failed || file.fail()) {
+        cerr << "ERROR: Could not write the whole event log to " << filename << "\n";
+    }
+}
+
+
+// Reads an event log front to back, throwing if it ends in the middle of something
+class Event_Log_Reader {
+    public:
+        Event_Log_Reader(const char* data, size_t size, const string& filename) : position(data), end(data + size), filename(filename) {}
+
+        bool at_end() const {
+            return position == end;
+        }
+
+        uint8_t read_byte() {
+            check_available(1);
+            return *position++;
+        }
+
+        uint64_t read_varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t byte = read_byte();
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            throw runtime_error("Event log " + filename + " is damaged");
+        }
+
+        uint32_t read_uint32() {
+            check_available(sizeof(uint32_t));
+            uint32_t value;
+            memcpy(&value, position, sizeof(value));
+            position += sizeof(value);
+            return value;
+        }
+
+        string read_string() {
+            uint64_t length = read_varint();
+            check_available(length);
+            string str(position, length);
+            position += length;
+            return str;
+        }
+
+        const char* read_bytes(size_t count) {
+            check_available(count);
+            const char* bytes = position;
+            position += count;
+            return bytes;
+        }
+
+    private:
+        const char* position;
+        const char* end;
+        string filename;
+
+        void check_available(uint64_t count) const {
+            if (count > (uint64_t)(end - position)) {
+                throw runtime_error("Event log " + filename + " is truncated or damaged");
+            }
+        }
+};
+
+
+struct Logged_Team {
+    string cache_id;
+    vector<string> player_ids;
+    vector<string> player_names;
+    vector<uint> pitchers; // Indices into player_ids
+};
+
+// Where a team is during the game being decoded
+struct Logged_Lineup {
+    const Logged_Team* team;
+    uint pitcher; // Index into team->pitchers
+    uint slots[9]; // See PITCHER_SLOT
+    uint position_in_batting_order = 0;
+    uint runs = 0;
+
+    uint get_player(uint slot) const {
+        return (slots[slot] == PITCHER_SLOT) ? team->pitchers.at(pitcher) : slots[slot] - 1;
+    }
+};
+
+
+static vector<Logged_Team> read_log_teams(Event_Log_Reader& reader, const string& filename) {
+    vector<Logged_Team> teams(reader.read_varint());
+    for (Logged_Team& team : teams) {
+        team.cache_id = reader.read_string();
+        uint64_t num_players = reader.read_varint();
+        for (uint64_t i = 0; i < num_players; i++) {
+            team.player_ids.push_back(reader.read_string());
+            team.player_names.push_back(reader.read_string());
+        }
+        uint64_t num_pitchers = reader.read_varint();
+        for (uint64_t i = 0; i < num_pitchers; i++) {
+            team.pitchers.push_back(reader.read_varint());
+            if (team.pitchers.back() >= num_players) throw runtime_error("Event log " + filename + " is damaged");
+        }
+    }
+    return teams;
+}
+
+
+static Logged_Lineup read_lineup(Event_Log_Reader& reader, const Logged_Team& team) {
+    Logged_Lineup lineup;
+    lineup.team = &team;
+    lineup.pitcher = reader.read_varint();
+    if (lineup.pitcher >= team.pitchers.size()) throw runtime_error("Event log has a pitcher that is not on " + team.cache_id);
+    for (uint& slot : lineup.slots) {
+        slot = reader.read_varint();
+        if (slot > team.player_ids.size()) throw runtime_error("Event log has a batter who is not on " + team.cache_id);
+    }
+    return lineup;
+}
+
+
+static void print_lineup(const Logged_Lineup& lineup, eTeam team) {
+    bool pitcher_bats = false;
+    for (uint slot = 0; slot < 9; slot++) {
+        uint player = lineup.get_player(slot);
+        pitcher_bats |= lineup.slots[slot] == PITCHER_SLOT;
+        cout << "start," << lineup.team->player_ids[player] << ",\"" << lineup.team->player_names[player] << "\"," << team << "," << slot + 1 << "," << ((lineup.slots[slot] == PITCHER_SLOT) ? 1 : 0) << "\n";
+    }
+    if (!pitcher_bats) {
+        uint pitcher = lineup.team->pitchers[lineup.pitcher];
+        cout << "start," << lineup.team->player_ids[pitcher] << ",\"" << lineup.team->player_names[pitcher] << "\"," << team << ",0,1\n";
+    }
+}
+
+
+// Runner advances in Retrosheet's notation (ex: ".2-H;1-3"), lead runner first. The batter's own advance is implied by the event.
+static string get_runner_advances(uint8_t occupied_bases, const Base_Transition& transition) {
+    string advances;
+    for (int base = THIRD_BASE; base >= FIRST_BASE; base--) {
+        if (!(occupied_bases & (1 << base)) || (transition.runner_destinations[base] == base)) continue;
+        advances += advances.empty() ? "." : ";";
+        advances += to_string(base + 1) + "-" + ((transition.runner_destinations[base] == HOME_PLATE) ? string("H") : to_string(transition.runner_destinations[base] + 1));
+    }
+    return advances;
+}
+
+
+static void print_logged_game(Event_Log_Reader& reader, const vector<Logged_Team>& teams, uint64_t sim_index, uint day_of_year) {
+    uint team_indices[2];
+    team_indices[AWAY_TEAM] = reader.read_varint();
+    team_indices[HOME_TEAM] = reader.read_varint();
+    if ((team_indices[AWAY_TEAM] >= teams.size()) || (team_indices[HOME_TEAM] >= teams.size())) throw runtime_error("Event log has a game with an unknown team");
+
+    Logged_Lineup lineups[2];
+    lineups[AWAY_TEAM] = read_lineup(reader, teams[team_indices[AWAY_TEAM]]);
+    lineups[HOME_TEAM] = read_lineup(reader, teams[team_indices[HOME_TEAM]]);
+
+    cout << "id," << teams[team_indices[HOME_TEAM]].cache_id << "_sim" << sim_index << "_day" << day_of_year << "\n";
+    cout << "info,visteam," << teams[team_indices[AWAY_TEAM]].cache_id << "\n";
+    cout << "info,hometeam," << teams[team_indices[HOME_TEAM]].cache_id << "\n";
+    print_lineup(lineups[AWAY_TEAM], AWAY_TEAM);
+    print_lineup(lineups[HOME_TEAM], HOME_TEAM);
+
+    static const char* const PLATE_APPEARANCE_CODES[] = {"K", "W", "O", "S", "D", "T", "HR"};
+    uint half_inning = 0;
+    uint8_t occupied_bases = 0;
+    while (true) {
+        uint8_t event = reader.read_byte();
+        uint8_t details = event & 0x1f;
+        eTeam batting_team = (half_inning % 2) ? HOME_TEAM : AWAY_TEAM;
+        Logged_Lineup& offense = lineups[batting_team];
+        Logged_Lineup& defense = lineups[!batting_team];
+        const string& batter_id = offense.team->player_ids[offense.get_player(offense.position_in_batting_order)];
+        string play_prefix = "play," + to_string(half_inning/2 + 1) + "," + to_string(batting_team) + "," + batter_id + ",??,,";
+
+        switch (event >> 5) {
+            case EVENT_PLATE_APPEARANCE: {
+                uint8_t outcome = details & 0x7;
+                uint8_t extra_bases_taken = details >> 3;
+                if (outcome > PA_HOME_RUN) throw runtime_error("Event log has an unknown plate appearance outcome");
+
+                string advances;
+                if (outcome == PA_WALK || outcome >= PA_SINGLE) {
+                    const Base_Transition& transition = (outcome == PA_WALK) ? BASE_TRANSITIONS.walks[occupied_bases]
+                                                                             : BASE_TRANSITIONS.hits[outcome - PA_SINGLE][occupied_bases][extra_bases_taken];
+                    advances = get_runner_advances(occupied_bases, transition);
+                    occupied_bases = transition.new_mask;
+                    offense.runs += transition.runs_scored;
+                }
+                cout << play_prefix << PLATE_APPEARANCE_CODES[outcome] << advances << "\n";
+                offense.position_in_batting_order = (offense.position_in_batting_order + 1) % 9;
+                break;
+            }
+            case EVENT_STEAL: {
+                uint8_t starting_base = details & 1;
+                bool succeeded = details & 2;
+                cout << play_prefix << (succeeded ? "SB" : "CS") << starting_base + 2 << "\n";
+                occupied_bases &= ~(1 << starting_base);
+                if (succeeded) occupied_bases |= 1 << (starting_base + 1);
+                break;
+            }
+            case EVENT_PITCHING_CHANGE: {
+                defense.pitcher = reader.read_varint();
+                if (defense.pitcher >= defense.team->pitchers.size()) throw runtime_error("Event log has a pitcher that is not on " + defense.team->cache_id);
+                uint batting_slot = 0;
+                for (uint slot = 0; slot < 9; slot++) {
+                    if (defense.slots[slot] == PITCHER_SLOT) batting_slot = slot + 1;
+                }
+                uint pitcher = defense.team->pitchers[defense.pitcher];
+                cout << "sub," << defense.team->player_ids[pitcher] << ",\"" << defense.team->player_names[pitcher] << "\"," << !batting_team << "," << batting_slot << ",1\n";
+                break;
+            }
+            case EVENT_HALF_INNING_END:
+                half_inning++;
+                occupied_bases = 0;
+                break;
+            case EVENT_GAME_END:
+                cout << "data,final," << lineups[AWAY_TEAM].runs << "," << lineups[HOME_TEAM].runs << "\n";
+                return;
+            default:
+                throw runtime_error("Event log has an unknown event");
+        }
+    }
+}
+
+
+void print_event_log(const string& filename) {
+    Mapped_File file(filename);
+    Event_Log_Reader reader(file.data(), file.size(), filename);
+    if ((file.size() < sizeof(EVENT_LOG_MAGIC)) || (memcmp(reader.read_bytes(sizeof(EVENT_LOG_MAGIC)), EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC)) != 0)) {
+        throw runtime_error(filename + " is not an event log");
+    }
+    if (reader.read_varint() != EVENT_LOG_VERSION) {
+        throw runtime_error("Event log " + filename + " was written by another version of the simulator");
+    }
+
+    vector<Logged_Team> teams = read_log_teams(reader, filename);
+
+    while (!reader.at_end()) {
+        uint32_t num_bytes = reader.read_uint32();
+        uint32_t num_games = reader.read_uint32();
+        Event_Log_Reader chunk_reader(reader.read_bytes(num_bytes), num_bytes, filename);
+
+        uint64_t sim_index = 0;
+        uint day_of_year = 0;
+        for (uint32_t game = 0; game < num_games; game++) {
+            sim_index += zigzag_decode(chunk_reader.read_varint());
+            day_of_year += zigzag_decode(chunk_reader.read_varint());
+            print_logged_game(chunk_reader, teams, sim_index, day_of_year);
+        }
+    }
+}
+
+
+Game_Printer::Game_Printer(const vector<const Team_Definition*>& teams) {
+    write_log_teams(teams_header, teams, player_indices);
+}
+
+
+Game_Event_Recorder* Game_Printer::begin_game(uint sim_index, uint day_of_year, uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) {
+    this->sim_index = sim_index;
+    this->day_of_year = day_of_year;
+    recorder.bytes.clear();
+    write_log_game_start(recorder, player_indices, home_index, home_state, away_index, away_state);
+    return &recorder;
+}
+
+
+void Game_Printer::end_game() {
+    recorder.record_event(EVENT_GAME_END, 0);
+    Event_Log_Reader header_reader(reinterpret_cast<const char*>(teams_header.bytes.data()), teams_header.bytes.size(), "(replay)");
+    vector<Logged_Team> teams = read_log_teams(header_reader, "(replay)");
+    Event_Log_Reader reader(reinterpret_cast<const char*>(recorder.bytes.data()), recorder.bytes.size(), "(replay)");
+    print_logged_game(reader, teams, sim_index, day_of_year);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "includes.hpp"
+#include "team.hpp"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <cstdint>
+
+
+/* Every plate appearance ends in one of these, written to the log along with which runners took an extra base on a hit
+(so the decoder can replay the runners' movements with BASE_TRANSITIONS) */
+enum ePlate_Appearance_Events : uint8_t {
+    PA_STRIKEOUT,
+    PA_WALK,
+    PA_OUT,
+    PA_SINGLE,
+    PA_DOUBLE,
+    PA_TRIPLE,
+    PA_HOME_RUN
+};
+
+// Stored in the top 3 bits of the first byte of every event, the other 5 bits hold the event's details
+enum eGame_Event_Types : uint8_t {
+    EVENT_PLATE_APPEARANCE,
+    EVENT_STEAL,
+    EVENT_PITCHING_CHANGE, // Followed by the new pitcher's index in team->pitchers
+    EVENT_HALF_INNING_END,
+    EVENT_GAME_END
+};
+
+
+// Appends the events of the game being played to the log's current chunk. Only used by games that are being logged.
+class Game_Event_Recorder {
+    public:
+        std::vector<uint8_t> bytes;
+
+        void record_plate_appearance(ePlate_Appearance_Events event, uint8_t extra_bases_taken) {
+            record_event(EVENT_PLATE_APPEARANCE, event | (extra_bases_taken << 3));
+        }
+        void record_steal(eBases starting_base, bool succeeded) {
+            record_event(EVENT_STEAL, starting_base | (succeeded << 1));
+        }
+        void record_pitching_change(uint pitcher_index) {
+            record_event(EVENT_PITCHING_CHANGE, 0);
+            write_varint(pitcher_index);
+        }
+        void record_half_inning_end() {
+            record_event(EVENT_HALF_INNING_END, 0);
+        }
+
+        void record_event(eGame_Event_Types type, uint8_t details) {
+            bytes.push_back((type << 5) | details);
+        }
+
+        void write_varint(uint64_t value) {
+            while (value >= 0x80) {
+                bytes.push_back((value & 0x7f) | 0x80);
+                value >>= 7;
+            }
+            bytes.push_back(value);
+        }
+};
+
+
+// Receives the events of every game a Season or Series plays while it is set as their event_sink
+class Game_Event_Sink {
+    public:
+        virtual ~Game_Event_Sink() {}
+
+        // Team indices are the season's (or series') team indices. Called after both teams are prepared for the game.
+        // The returned recorder gets every event of the game, until end_game is called.
+        virtual Game_Event_Recorder* begin_game(uint sim_index, uint day_of_year, uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) = 0;
+        virtual void end_game() = 0;
+};
+
+
+/* Compact play-by-play log of every game played while it is open (see --event-log), decoded with print_event_log.
+The file starts with the teams (their players' names and pitchers), followed by chunks of games. A game starts with its
+simulation index and day (as deltas from the previous game in the chunk) and both lineups, followed by one or two bytes per
+event. Full chunks are written to disk by a background thread so the simulation never waits on the disk. */
+class Event_Log : public Game_Event_Sink {
+    public:
+        // The teams have to be indexed like the season's (or series') teams
+        Event_Log(const std::string& filename, const std::vector<const Team_Definition*>& teams);
+        ~Event_Log();
+
+        Event_Log(const Event_Log&) = delete;
+        Event_Log& operator=(const Event_Log&) = delete;
+
+        Game_Event_Recorder* begin_game(uint sim_index, uint day_of_year, uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) override;
+        void end_game() override;
+
+        // Writes everything that is still buffered and waits for it to reach the file
+        void close();
+
+    private:
+        std::string filename;
+        std::ofstream file;
+        std::vector<std::unordered_map<const Player*, uint>> player_indices; // Indexed like teams, gives each player's index in team->all_players
+
+        Game_Event_Recorder recorder; // Holds the chunk being filled
+        uint games_in_chunk = 0;
+        uint64_t previous_sim_index = 0;
+        uint previous_day_of_year = 0;
+
+        std::thread writer_thread;
+        std::deque<std::pair<uint32_t, std::vector<uint8_t>>> pending_chunks; // Number of games and the chunk's bytes
+        std::mutex chunks_mutex;
+        std::condition_variable chunks_changed;
+        bool closing = false;
+        bool write_failed = false;
+
+        void submit_chunk();
+        void write_chunks();
+};
+
+
+// Prints every game in an event log as Retrosheet style event lines
+void print_event_log(const std::string& filename);
+
+
+// Prints each game it gets as soon as the game ends, exactly as print_event_log would print it from a log (ex: for the replay command)
+class Game_Printer : public Game_Event_Sink {
+    public:
+        // The teams have to be indexed like the season's (or series') teams
+        Game_Printer(const std::vector<const Team_Definition*>& teams);
+
+        Game_Event_Recorder* begin_game(uint sim_index, uint day_of_year, uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) override;
+        void end_game() override;
+
+    private:
+        Game_Event_Recorder teams_header; // Written like an event log's, so the game can be decoded the same way
+        std::vector<std::unordered_map<const Player*, uint>> player_indices;
+        Game_Event_Recorder recorder; // The game being played
+        uint sim_index = 0;
+        uint day_of_year = 0;
+};
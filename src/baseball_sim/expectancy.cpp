@@ -0,0 +1,219 @@
+#include "expectancy.hpp"
+
+#include "includes.hpp"
+#include "season.hpp"
+#include "baseball_game.hpp"
+#include "game_states.hpp"
+#include "event_log.hpp"
+#include "worker_pool.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+const double CONVERGED_WIN_EXPECTANCY_ERROR = .01;
+const double CONVERGED_RUN_EXPECTANCY_ERROR = .01;
+
+
+void Expectancy_Tables::merge(const Expectancy_Tables& other) {
+    Expectancy_Cell* cells = &win_expectancy[0][0][0][0][0];
+    const Expectancy_Cell* other_cells = &other.win_expectancy[0][0][0][0][0];
+    for (size_t i = 0; i < sizeof(win_expectancy)/sizeof(Expectancy_Cell); i++) cells[i].merge(other_cells[i]);
+
+    cells = &run_expectancy[0][0];
+    other_cells = &other.run_expectancy[0][0];
+    for (size_t i = 0; i < sizeof(run_expectancy)/sizeof(Expectancy_Cell); i++) cells[i].merge(other_cells[i]);
+}
+
+
+Game_Event_Recorder* Expectancy_Recorder::begin_game(uint sim_index, uint day_of_year, uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) {
+    recorder.bytes.clear();
+    return &recorder;
+}
+
+
+// Replays the game's events (see Game_Event_Recorder), tracking the outs, bases and score the same way the game did
+void Expectancy_Recorder::end_game() {
+    const vector<uint8_t>& events = recorder.bytes;
+    game_states_visited.clear();
+    half_inning_states_visited.clear();
+
+    int score[2] = {0, 0};
+    uint half_inning = 0;
+    uint8_t outs = 0, occupied_bases = 0, half_inning_runs = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        uint8_t details = events[i] & 0x1f;
+        eTeam batting_team = (half_inning % 2) ? HOME_TEAM : AWAY_TEAM;
+
+        switch (events[i] >> 5) {
+            case EVENT_PLATE_APPEARANCE: {
+                if (outs < 3) {
+                    int score_difference = score[HOME_TEAM] - score[AWAY_TEAM] + ((batting_team == HOME_TEAM) ? half_inning_runs : -half_inning_runs);
+                    score_difference = clamp(score_difference, -MAX_SCORE_DIFFERENCE, MAX_SCORE_DIFFERENCE);
+                    uint inning = min(half_inning/2, EXPECTANCY_INNINGS - 1);
+                    game_states_visited.push_back(&tables.win_expectancy[inning][batting_team][score_difference + MAX_SCORE_DIFFERENCE][outs][occupied_bases]);
+                    half_inning_states_visited.push_back({&tables.run_expectancy[outs][occupied_bases], half_inning_runs});
+                }
+
+                uint8_t outcome = details & 0x7;
+                if ((outcome == PA_STRIKEOUT) || (outcome == PA_OUT)) {
+                    outs++;
+                }
+                else {
+                    const Base_Transition& transition = (outcome == PA_WALK) ? BASE_TRANSITIONS.walks[occupied_bases]
+                                                                             : BASE_TRANSITIONS.hits[outcome - PA_SINGLE][occupied_bases][details >> 3];
+                    occupied_bases = transition.new_mask;
+                    half_inning_runs += transition.runs_scored;
+                }
+                break;
+            }
+            case EVENT_STEAL: {
+                uint8_t starting_base = details & 1;
+                occupied_bases &= ~(1 << starting_base);
+                if (details & 2) occupied_bases |= 1 << (starting_base + 1);
+                else outs++;
+                break;
+            }
+            case EVENT_PITCHING_CHANGE:
+                while (events[++i] & 0x80) {} // Skip the pitcher's index
+                break;
+            case EVENT_HALF_INNING_END: {
+                bool can_end_game = (half_inning >= MAX_HALF_INNINGS - 1) && (batting_team == HOME_TEAM); // Walk offs cut these short
+                if (!can_end_game) {
+                    for (auto [cell, runs_before_visit] : half_inning_states_visited) cell->add(half_inning_runs - runs_before_visit);
+                }
+                half_inning_states_visited.clear();
+                score[batting_team] += half_inning_runs;
+                half_inning++;
+                outs = occupied_bases = half_inning_runs = 0;
+                break;
+            }
+        }
+    }
+
+    bool home_team_won = score[HOME_TEAM] > score[AWAY_TEAM];
+    for (Expectancy_Cell* cell : game_states_visited) cell->add(home_team_won);
+}
+
+
+Expectancy_Generator::Expectancy_Generator(const Season& season) : season(season) {}
+
+
+void Expectancy_Generator::run(uint num_sims, uint64_t seed, uint num_workers) {
+    Worker_Pool worker_pool(num_workers);
+    for (const Sim_Chunk& chunk : split_into_chunks(num_sims, season.matchups.size())) {
+        worker_pool.submit([this, chunk, seed]() {
+            run_chunk(chunk.first_sim, chunk.num_sims, seed);
+        });
+    }
+}
+
+
+void Expectancy_Generator::run_chunk(uint first_sim, uint num_sims, uint64_t seed) {
+    unique_ptr<Expectancy_Recorder> recorder = make_unique<Expectancy_Recorder>(); // Too big for a worker's stack
+    Season chunk_season = season;
+    chunk_season.event_sink = recorder.get();
+    chunk_season.run_games(num_sims, seed, first_sim);
+
+    lock_guard<mutex> lock(tables_mutex);
+    tables.merge(recorder->tables);
+    sims_completed += chunk_season.sims_completed;
+}
+
+
+static string get_bases_name(uint8_t occupied_bases) {
+    string name = "___";
+    for (int base = FIRST_BASE; base <= THIRD_BASE; base++) {
+        if (occupied_bases & (1 << base)) name[base] = '1' + base;
+    }
+    return name;
+}
+
+
+void Expectancy_Generator::write_csv_files(const string& output_dir) const {
+    filesystem::create_directories(output_dir);
+    const string win_filename = output_dir + "/" + to_string(season.year) + "_win_expectancy.csv";
+    const string run_filename = output_dir + "/" + to_string(season.year) + "_run_expectancy.csv";
+
+    ofstream win_file(win_filename);
+    win_file << "inning,half,score_difference,outs,bases,visits,home_win_probability,standard_error\n";
+    for (uint inning = 0; inning < EXPECTANCY_INNINGS; inning++) {
+        for (int half : {AWAY_TEAM, HOME_TEAM}) {
+            for (int difference = -MAX_SCORE_DIFFERENCE; difference <= MAX_SCORE_DIFFERENCE; difference++) {
+                for (uint outs = 0; outs < 3; outs++) {
+                    for (uint8_t bases = 0; bases < NUM_BASE_MASKS; bases++) {
+                        const Expectancy_Cell& cell = tables.win_expectancy[inning][half][difference + MAX_SCORE_DIFFERENCE][outs][bases];
+                        if (cell.count == 0) continue; // Most leads never happen early on
+                        win_file << inning + 1 << ((inning == EXPECTANCY_INNINGS - 1) ? "+" : "") << "," << ((half == AWAY_TEAM) ? "top" : "bottom") << ","
+                                 << difference << "," << outs << "," << get_bases_name(bases) << "," << cell.count << "," << cell.get_mean() << "," << cell.get_standard_error() << "\n";
+                    }
+                }
+            }
+        }
+    }
+
+    ofstream run_file(run_filename);
+    run_file << "outs,bases,visits,expected_runs,standard_error\n";
+    for (uint outs = 0; outs < 3; outs++) {
+        for (uint8_t bases = 0; bases < NUM_BASE_MASKS; bases++) {
+            const Expectancy_Cell& cell = tables.run_expectancy[outs][bases];
+            run_file << outs << "," << get_bases_name(bases) << "," << cell.count << "," << cell.get_mean() << "," << cell.get_standard_error() << "\n";
+        }
+    }
+
+    if (!win_file.good() || !run_file.good()) {
+        cerr << "Could not write expectancy tables to " << output_dir << "\n";
+        throw exception();
+    }
+    cout << "Wrote " << win_filename << " and " << run_filename << "\n";
+}
+
+
+// Prints the RE24 table and how converged the win expectancy cells are. The standard error of a cell shrinks with the square
+// root of its visits, so halving it takes four times as many simulations.
+void Expectancy_Generator::print_summary() const {
+    cout << std::fixed << std::setprecision(3);
+    cout << "RUN EXPECTANCY (" << sims_completed << " simulated seasons):\n";
+    cout << "Bases\t0 outs\t\t1 out\t\t2 outs\n";
+    for (uint8_t bases = 0; bases < NUM_BASE_MASKS; bases++) {
+        cout << get_bases_name(bases);
+        for (uint outs = 0; outs < 3; outs++) {
+            const Expectancy_Cell& cell = tables.run_expectancy[outs][bases];
+            cout << "\t" << cell.get_mean() << " +-" << setprecision(3) << cell.get_standard_error();
+        }
+        cout << "\n";
+    }
+
+    uint visited_cells = 0, converged_cells = 0;
+    uint64_t converged_visits = 0, total_visits = 0;
+    const Expectancy_Cell* cells = &tables.win_expectancy[0][0][0][0][0];
+    for (size_t i = 0; i < sizeof(tables.win_expectancy)/sizeof(Expectancy_Cell); i++) {
+        if (cells[i].count == 0) continue;
+        visited_cells++;
+        total_visits += cells[i].count;
+        if (cells[i].get_standard_error() <= CONVERGED_WIN_EXPECTANCY_ERROR) {
+            converged_cells++;
+            converged_visits += cells[i].count;
+        }
+    }
+    uint converged_run_cells = 0;
+    for (uint outs = 0; outs < 3; outs++) {
+        for (uint8_t bases = 0; bases < NUM_BASE_MASKS; bases++) {
+            converged_run_cells += tables.run_expectancy[outs][bases].get_standard_error() <= CONVERGED_RUN_EXPECTANCY_ERROR;
+        }
+    }
+
+    cout << "\nCONVERGENCE:\n";
+    cout << converged_run_cells << " of 24 run expectancy cells are within " << CONVERGED_RUN_EXPECTANCY_ERROR << " runs (one standard error)\n";
+    cout << converged_cells << " of " << visited_cells << " visited win expectancy cells are within " << CONVERGED_WIN_EXPECTANCY_ERROR
+         << " (one standard error), covering " << 100.0*converged_visits/max<uint64_t>(total_visits, 1) << "% of plate appearances\n\n";
+}
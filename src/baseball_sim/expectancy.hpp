@@ -0,0 +1,68 @@
+#pragma once
+
+#include "includes.hpp"
+#include "season.hpp"
+#include "event_log.hpp"
+#include "game_states.hpp"
+#include "sample_sums.hpp"
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+
+const uint EXPECTANCY_INNINGS = 10; // Extra innings all share the last row
+const int MAX_SCORE_DIFFERENCE = 10; // Bigger leads are counted as this
+
+
+// How often a state was reached (the count) and how it turned out from there (the samples)
+typedef Sample_Sums Expectancy_Cell;
+
+
+// States are the ones at the start of each plate appearance
+struct Expectancy_Tables {
+    // [inning][top/bottom][home score - away score + MAX_SCORE_DIFFERENCE][outs][bases], the outcome is whether the home team won
+    Expectancy_Cell win_expectancy[EXPECTANCY_INNINGS][2][2*MAX_SCORE_DIFFERENCE + 1][3][NUM_BASE_MASKS];
+    // [outs][bases], the outcome is the runs scored in the rest of the half inning (RE24). Half innings that can end the game are left out.
+    Expectancy_Cell run_expectancy[3][NUM_BASE_MASKS];
+
+    void merge(const Expectancy_Tables& other);
+};
+
+
+/* Adds up the states of every game it is sent (as the event sink of a season), replaying each game's events once the game is over.
+Only ever used by one thread. */
+class Expectancy_Recorder : public Game_Event_Sink {
+    public:
+        Expectancy_Tables tables;
+
+        Game_Event_Recorder* begin_game(uint sim_index, uint day_of_year, uint home_index, const Team_Game_State& home_state, uint away_index, const Team_Game_State& away_state) override;
+        void end_game() override;
+
+    private:
+        Game_Event_Recorder recorder;
+        std::vector<Expectancy_Cell*> game_states_visited;
+        std::vector<std::pair<Expectancy_Cell*, uint>> half_inning_states_visited; // With the runs scored in the half inning before the visit
+};
+
+
+/* Generates win expectancy and run expectancy tables for a league year's run environment by simulating its season many times.
+Simulations are split into chunks that run on a worker pool, each with its own copy of the season and its own tables, which are
+merged once the chunk is done. Every simulation is seeded by its index, so the tables don't depend on the number of workers. */
+class Expectancy_Generator {
+    public:
+        Expectancy_Generator(const Season& season);
+
+        void run(uint num_sims, uint64_t seed, uint num_workers);
+        void write_csv_files(const std::string& output_dir) const;
+        void print_summary() const;
+
+    private:
+        const Season& season;
+        Expectancy_Tables tables;
+        uint sims_completed = 0;
+        std::mutex tables_mutex;
+
+        void run_chunk(uint first_sim, uint num_sims, uint64_t seed);
+};
@@ -3,119 +3,176 @@
 #include "includes.hpp"
 #include "probability.hpp"
 #include "statistics.hpp"
+#include "sim_counters.hpp"
 #include "user_interface.hpp"
 
 #include <random>
 #include <time.h>
 #include <cassert>
 #include <string>
+#include <algorithm>
 
-//https://sabr.org/journal/article/matchup-probabilities-in-major-league-baseball/
+const Base_Transition_Tables BASE_TRANSITIONS;
 
-const float MIN_DEFENSE_STOLEN_BASE_PROB = .01;
-const float MAX_DEFENSE_STOLEN_BASE_PROB = .99;
+
+Base_Transition_Tables::Base_Transition_Tables() {
+    for (uint8_t mask = 0; mask < NUM_BASE_MASKS; mask++) {
+        walks[mask] = make_walk_transition(mask);
+        for (uint8_t hit_type = 0; hit_type < NUM_HIT_TYPES; hit_type++) {
+            for (uint8_t extra_bases_taken = 0; extra_bases_taken < 4; extra_bases_taken++) {
+                hits[hit_type][mask][extra_bases_taken] = make_hit_transition(hit_type + 1, mask, extra_bases_taken);
+            }
+        }
+    }
+}
+
+
+// Only runners that are forced to move do
+Base_Transition Base_Transition_Tables::make_walk_transition(uint8_t mask) {
+    Base_Transition transition;
+    transition.new_mask = mask | (1 << FIRST_BASE);
+    for (int base = FIRST_BASE; (base <= THIRD_BASE) && (mask & (1 << base)); base++) {
+        transition.runner_destinations[base] = base + 1;
+        if (base == THIRD_BASE) transition.runs_scored++;
+        else transition.new_mask |= 1 << (base + 1);
+    }
+    return transition;
+}
+
+
+// Runners move up as many bases as the batter, plus one if they took an extra base. A runner can only try for an extra
+// base if it would not take them home on its own and the runner ahead of them did not stop on the base right in front.
+Base_Transition Base_Transition_Tables::make_hit_transition(uint8_t bases_advanced, uint8_t mask, uint8_t extra_bases_taken) {
+    Base_Transition transition;
+    int max_base = HOME_PLATE + 1; // Makes sure that runners can't pass other runners
+    for (int base = THIRD_BASE; base >= FIRST_BASE; base--) {
+        if (!(mask & (1 << base))) continue;
+
+        int new_base = base + bases_advanced;
+        if ((base + bases_advanced <= THIRD_BASE) && (base + bases_advanced < max_base - 1)) {
+            transition.extra_base_candidates |= 1 << base;
+            if (extra_bases_taken & (1 << base)) new_base++;
+        }
+
+        if (new_base > THIRD_BASE) {
+            transition.runner_destinations[base] = HOME_PLATE;
+            transition.runs_scored++;
+        }
+        else {
+            transition.runner_destinations[base] = new_base;
+            transition.new_mask |= 1 << new_base;
+            if (new_base < max_base) max_base = new_base;
+        }
+    }
+
+    int batter_base = bases_advanced - 1;
+    if (batter_base > THIRD_BASE) {
+        transition.batter_destination = HOME_PLATE;
+        transition.runs_scored++;
+    }
+    else {
+        transition.batter_destination = batter_base;
+        transition.new_mask |= 1 << batter_base;
+    }
+    return transition;
+}
 
 
-At_Bat::At_Bat(Team* batting_team, Team* pitching_team) {
+At_Bat::At_Bat(Team_Game_State* batting_team, Team_Game_State* pitching_team, const Matchup_Probabilities* probabilities) {
     this->pitcher = pitching_team->fielders[POS_PITCHER];
     this->batter = batting_team->get_batter();
     this->batting_team = batting_team;
     this->pitching_team = pitching_team;
+    this->probabilities = probabilities;
     strikes = 0;
     balls = 0;
 }
 
 
+// The matchup's probabilities were derived ahead of time, see Probability_Store
 eAt_Bat_Outcomes At_Bat::play() {
     game_viewer_print("\n\tUp to bat: " + batter->name + "\n");
-    float batter_probs[NUM_AB_OUTCOMES];
-    float pitcher_probs[NUM_AB_OUTCOMES];
-    const float* league_probs = ALL_LEAGUE_STATS[batter->stats.current_year].at_bat_probs;
-
-    int batter_plate_appearances = batter->stats.get_stat(PLAYER_BATTING, "b_pa", .0f);
-    if (batter_plate_appearances == 0) {
-        debug_print(batter->name + " has no batting plate appearances, defaulting to 0...\n");
-        batter_probs[OUTCOME_STRIKEOUT] = 1;
-        batter_probs[OUTCOME_WALK] = 0;
-    }
-    else {
-        batter_probs[OUTCOME_STRIKEOUT] = batter->stats.get_stat(PLAYER_BATTING, "b_so", .0f)/batter_plate_appearances;
-        batter_probs[OUTCOME_WALK] = (batter->stats.get_stat(PLAYER_BATTING, "b_bb", .0f) + batter->stats.get_stat(PLAYER_BATTING, "b_hbp", .0f))/batter_plate_appearances;
-    }
-    batter_probs[OUTCOME_BALL_IN_PLAY] = 1 - batter_probs[OUTCOME_STRIKEOUT] - batter_probs[OUTCOME_WALK];
-
-    int pitcher_plate_appearances = pitcher->stats.get_stat(PLAYER_PITCHING, "p_bfp", .0f);
-    if (pitcher_plate_appearances == 0) {
-        debug_print(pitcher->name + " has no pitching plate appearances, defaulting to league avg...\n");
-        pitcher_probs[OUTCOME_STRIKEOUT] = league_probs[OUTCOME_STRIKEOUT];
-        pitcher_probs[OUTCOME_WALK] = league_probs[OUTCOME_WALK];
-    }
-    else {
-        pitcher_probs[OUTCOME_STRIKEOUT] = pitcher->stats.get_stat(PLAYER_PITCHING, "p_so", .0f)/pitcher_plate_appearances;
-        pitcher_probs[OUTCOME_WALK] = (pitcher->stats.get_stat(PLAYER_PITCHING, "p_bb", .0f) + pitcher->stats.get_stat(PLAYER_PITCHING, "p_hbp", .0f))/pitcher_plate_appearances;
-    }
-    pitcher_probs[OUTCOME_BALL_IN_PLAY] = 1 - pitcher_probs[OUTCOME_STRIKEOUT] - pitcher_probs[OUTCOME_WALK];
-
-    float outcome_probs[NUM_AB_OUTCOMES];
-    calculate_event_probabilities(batter_probs, pitcher_probs, league_probs, outcome_probs, NUM_AB_OUTCOMES);
-    return (eAt_Bat_Outcomes) get_random_event(outcome_probs, NUM_AB_OUTCOMES);
+    return (eAt_Bat_Outcomes) probabilities->at_bat.draw();
 }
 
 
-Half_Inning::Half_Inning(Team* batting_team, Team* pitching_team, uint8_t half_inning_number, uint day_of_year, float runs_to_end_game) {
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+Half_Inning<Offense_Stats, Defense_Stats, record_events>::Half_Inning(Team_Game_State* batting_team, Team_Game_State* pitching_team, const Matchup_Table* matchup_table, uint8_t half_inning_number, uint day_of_year,
+                                                                      float runs_to_end_game, const Half_Inning_Situation& situation, Game_Event_Recorder* event_recorder) {
     this->batting_team = batting_team;
     this->pitching_team = pitching_team;
+    this->matchup_table = matchup_table;
     this->half_inning_number = half_inning_number;
     this->day_of_year = day_of_year;
     this->runs_to_end_game = runs_to_end_game;
-    this->bases = Base_State(batting_team, pitching_team);
-    outs = 0;
+    this->event_recorder = event_recorder;
+    this->bases = Base_State<Offense_Stats, Defense_Stats, record_events>(batting_team, pitching_team, event_recorder);
+    if (situation.occupied_bases) bases.place_runners(situation);
+    outs = situation.outs;
     runs_scored = 0;
 }
 
 
-uint8_t Half_Inning::play() {
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+uint8_t Half_Inning<Offense_Stats, Defense_Stats, record_events>::play() {
     game_viewer_line(
         std::string top_or_bottom = "TOP ";
         if (half_inning_number % 2) top_or_bottom = "BOTTOM ";
         std::cout << top_or_bottom << half_inning_number / 2 + 1<< "\n";
-        std::cout << "TEAM AT BAT: " << batting_team->team_name << "\n";
+        std::cout << "TEAM AT BAT: " << batting_team->team->team_name << "\n";
     );
 
-    while ((outs < Half_Inning::NUM_OUTS_TO_END_INNING) && (runs_scored < runs_to_end_game)) {
+    while ((outs < NUM_OUTS_TO_END_INNING) && (runs_scored < runs_to_end_game)) {
         play_at_bat();
         game_viewer_line(bases.print());
         game_viewer_line(wait_for_user_input(""));
     }
 
     game_viewer_print("HALF INNING OVER: RUNS SCORED: " << (int)runs_scored << "\n\n");
+    if constexpr (record_events) event_recorder->record_half_inning_end();
     return runs_scored;
 }
 
 
 // Check pitcher switch calling, it should be here
-void Half_Inning::play_at_bat() {
-    pitching_team->try_switching_pitcher(half_inning_number, day_of_year);
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+void Half_Inning<Offense_Stats, Defense_Stats, record_events>::play_at_bat() {
+    if constexpr (record_events) {
+        Player* previous_pitcher = pitching_team->get_pitcher();
+        if (pitching_team->try_switching_pitcher(half_inning_number, day_of_year) != previous_pitcher) {
+            event_recorder->record_pitching_change(pitching_team->get_pitcher_index());
+        }
+    }
+    else {
+        pitching_team->try_switching_pitcher(half_inning_number, day_of_year);
+    }
     outs += bases.check_stolen_bases(pitching_team->get_pitcher());
 
     if (outs < 3) {
-        global_stats.total_PAs++;
+        sim_counters.add(COUNTER_PLATE_APPEARANCES);
         uint8_t runs_from_at_bat = 0;
-        At_Bat at_bat(batting_team, pitching_team);
+        const Matchup_Probabilities& probabilities = matchup_table->get(batting_team->get_batter_matchup_row(), pitching_team->get_pitcher_index());
+        At_Bat at_bat(batting_team, pitching_team, &probabilities);
         eAt_Bat_Outcomes at_bat_outcome = at_bat.play();
 
         if (at_bat_outcome == OUTCOME_STRIKEOUT) {
             game_viewer_print("\tSTRIKEOUT!\n");
+            if constexpr (record_events) event_recorder->record_plate_appearance(PA_STRIKEOUT, 0);
             outs++;
         }
         else if (at_bat_outcome == OUTCOME_WALK) {
             game_viewer_print("\tWALK...\n");
+            if constexpr (record_events) event_recorder->record_plate_appearance(PA_WALK, 0);
             runs_from_at_bat = bases.handle_walk(batting_team->get_batter());
         }
         else { // Ball in play
-            global_stats.balls_in_play++;
-            Ball_In_Play_Result result = get_ball_in_play_result(batting_team->get_batter(), pitching_team->get_pitcher());
+            sim_counters.add(COUNTER_BALLS_IN_PLAY);
+            Ball_In_Play_Result result = get_ball_in_play_result(batting_team->get_batter(), pitching_team->get_pitcher(), probabilities);
             runs_from_at_bat = bases.handle_ball_in_play(batting_team->get_batter(), result);
+            if constexpr (record_events) {
+                // Outs and hits follow each other in ePlate_Appearance_Events, ordered by bases advanced
+                event_recorder->record_plate_appearance((ePlate_Appearance_Events)(PA_OUT + result.batter_bases_advanced), result.extra_bases_taken);
+            }
 
             if (result.batter_bases_advanced == 0) {
                 game_viewer_print("\tBATTER WAS PUT OUT!\n");
@@ -129,79 +186,26 @@ void Half_Inning::play_at_bat() {
 }
 
 
-Ball_In_Play_Result Half_Inning::get_ball_in_play_result(Player* batter, Player* pitcher) {
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+Ball_In_Play_Result Half_Inning<Offense_Stats, Defense_Stats, record_events>::get_ball_in_play_result(Player* batter, Player* pitcher, const Matchup_Probabilities& probabilities) {
     Ball_In_Play_Result result;
 
-    // Probabilities of getting a hit or getting out, index 0 is hit, index 1 is out.
-    float batter_hit_probs[2];
-    float pitcher_hit_probs[2];
-    const float* league_hit_probs = ALL_LEAGUE_STATS[batter->stats.current_year].hit_or_out_probs;
-
-    float batter_balls_in_play = batter->stats.get_stat(PLAYER_BATTING, "b_pa", .0f) - batter->stats.get_stat(PLAYER_BATTING, "b_bb", .0f)
-                               - batter->stats.get_stat(PLAYER_BATTING, "b_hbp", .0f) - batter->stats.get_stat(PLAYER_BATTING, "b_so", .0f);
-    float batter_hits = batter->stats.get_stat(PLAYER_BATTING, "b_h", .0f);
-    if (batter_balls_in_play == 0)
-        batter_hit_probs[0] = 0; // If we have no data for batter, we just assume that the batter is always out so that batters with no baserunning file never get on base
-    else
-        batter_hit_probs[0] = batter_hits/batter_balls_in_play;
-    batter_hit_probs[1] = 1 - batter_hit_probs[0];
-
-    int pitcher_balls_in_play = pitcher->stats.get_stat(PLAYER_PITCHING, "p_bfp", .0f) - pitcher->stats.get_stat(PLAYER_PITCHING, "p_bb", .0f)
-                              - pitcher->stats.get_stat(PLAYER_PITCHING, "p_hbp", .0f) - pitcher->stats.get_stat(PLAYER_PITCHING, "p_so", .0f);
-    float pitcher_hits = pitcher->stats.get_stat(PLAYER_PITCHING, "p_h", .0f);
-    if ((pitcher_balls_in_play == 0) || (pitcher_hits == 0))
-        pitcher_hit_probs[0] = league_hit_probs[0]; // If we have no data for pitcher, we just give them the league avg stats
-    else
-        pitcher_hit_probs[0] = pitcher_hits/pitcher_balls_in_play;
-    pitcher_hit_probs[1] = 1 - pitcher_hit_probs[0];
-
-    float hit_probs[2];
-    calculate_event_probabilities(batter_hit_probs, pitcher_hit_probs, league_hit_probs, hit_probs, 2);
-    uint8_t hit_or_out = get_random_event(hit_probs, 2);
+    // Event 0 is a hit, event 1 is an out
+    uint8_t hit_or_out = probabilities.hit_or_out.draw();
 
     if (hit_or_out == 1) // if batter is out
         result.batter_bases_advanced = 0;
     else // if batter got a hit
-        result.batter_bases_advanced = get_batter_bases_advanced(batter, pitcher);
+        result.batter_bases_advanced = get_batter_bases_advanced(batter, pitcher, probabilities);
     
     return result;
 }
 
 
-uint8_t Half_Inning::get_batter_bases_advanced(Player* batter, Player* pitcher) {
-    global_stats.total_hits++;
-    float batter_probs[4];
-    float outcome_probabilities[4];
-
-    const int batter_total_hits = batter->stats.get_stat(PLAYER_BATTING, "b_h", 1.f);
-    batter_probs[1] = batter->stats.get_stat(PLAYER_BATTING, "b_doubles", .0f)/batter_total_hits;
-    batter_probs[2] = batter->stats.get_stat(PLAYER_BATTING, "b_triples", .0f)/batter_total_hits;
-    batter_probs[3] = batter->stats.get_stat(PLAYER_BATTING, "b_hr", .0f)/batter_total_hits;
-    batter_probs[0] = 1 - batter_probs[1] - batter_probs[2] - batter_probs[3];
-
-    if (!pitcher->stats[PLAYER_BATTING_AGAINST].empty()) {
-        const float* league_probs = ALL_LEAGUE_STATS[batter->stats.current_year].hit_type_probs;
-        float pitcher_probs[4];
-
-        const int pitcher_total_hits = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "H", .0f);
-        if (pitcher_total_hits == 0)
-            for (int i = 0; i < 4; i++)
-                pitcher_probs[i] = league_probs[i];
-        else {
-            pitcher_probs[1] = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "2B", .0f)/pitcher_total_hits;
-            pitcher_probs[2] = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "3B", .0f)/pitcher_total_hits;
-            pitcher_probs[3] = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "HR", .0f)/pitcher_total_hits;
-            pitcher_probs[0] = 1 - pitcher_probs[1] - pitcher_probs[2] - pitcher_probs[3];
-        }
-        
-        calculate_event_probabilities(batter_probs, pitcher_probs, league_probs, outcome_probabilities, 4);
-    }
-    else {
-        debug_line(game_viewer_print("No batting_against file available for " + pitcher->name + ", using batter probs only for batter bases advanced...\n"));
-        for (int i = 0; i < 4; i++)
-            outcome_probabilities[i] = batter_probs[i];
-    }
-    uint8_t bases_advanced = get_random_event(outcome_probabilities, 4) + 1;
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+uint8_t Half_Inning<Offense_Stats, Defense_Stats, record_events>::get_batter_bases_advanced(Player* batter, Player* pitcher, const Matchup_Probabilities& probabilities) {
+    sim_counters.add(COUNTER_HITS);
+    uint8_t bases_advanced = probabilities.hit_type.draw() + 1;
 
     game_viewer_line(
         if (bases_advanced == 1) std::cout << "\tSINGLE\n";
@@ -210,7 +214,7 @@ uint8_t Half_Inning::get_batter_bases_advanced(Player* batter, Player* pitcher)
         else if (bases_advanced == 4) std::cout << "\tHOME RUN!!!\n";
     )
     debug_line(
-        if (batter_total_hits == 0)
+        if (batter->stats.has_stats(PLAYER_BATTING) && (batter->stats.get_stat(PLAYER_BATTING, "b_h", 1.f) == 0))
             std::cout << "WARNING: batter " + batter->name + " got a hit against pitcher " + pitcher->name + " despite having no career hits.\n";
     )
 
@@ -218,31 +222,40 @@ uint8_t Half_Inning::get_batter_bases_advanced(Player* batter, Player* pitcher)
 }
 
 
-bool Base_State::bases_empty() {
-    return (players_on_base[FIRST_BASE] == players_on_base[SECOND_BASE]) && (players_on_base[FIRST_BASE] == players_on_base[THIRD_BASE]);
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+bool Base_State<Offense_Stats, Defense_Stats, record_events>::bases_empty() {
+    return occupied_bases == 0;
 }
 
 
-bool Base_State::can_simulate_steal(Player* runner, Player* pitcher) {
-    return runner->stats[PLAYER_BASERUNNING].size() && pitcher->stats[PLAYER_BATTING_AGAINST].size();
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+bool Base_State<Offense_Stats, Defense_Stats, record_events>::can_simulate_steal(Player* runner, Player* pitcher) {
+    return Offense_Stats::has_baserunning(runner) && Defense_Stats::has_batting_against(pitcher);
 }
 
 
 // Checks to see if any of the baserunners (if there are any) tried to steal, and if so, returns the number of outs (if any) that resulted from the play.
-uint8_t Base_State::check_stolen_bases(Player* pitcher) {
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+uint8_t Base_State<Offense_Stats, Defense_Stats, record_events>::check_stolen_bases(Player* pitcher) {
     uint8_t outs = 0;
     for (int i = SECOND_BASE; i >= FIRST_BASE; i--) {
         if (!base_occupied((eBases)(i+1)) && base_occupied((eBases)i)) {
-            if (can_simulate_steal(players_on_base[i], pitcher) && will_runner_attempt_steal((eBases)i, pitcher)) {
-                if (will_steal_succeed((eBases)i, pitcher)) {
+            if (can_simulate_steal(players_on_base[i], pitcher) && will_runner_attempt_steal((eBases)i)) {
+                bool steal_succeeded = will_steal_succeed((eBases)i);
+                sim_counters.add(COUNTER_STEAL_ATTEMPTS);
+                sim_counters.add(COUNTER_STOLEN_BASES, steal_succeeded);
+                if constexpr (record_events) event_recorder->record_steal((eBases)i, steal_succeeded);
+                if (steal_succeeded) {
                     game_viewer_print(players_on_base[i]->name +" STOLE BASE "<< i+2 << "\n");
                     players_on_base[i+1] = players_on_base[i];
+                    runner_probabilities[i+1] = runner_probabilities[i];
+                    occupied_bases |= 1 << (i+1);
                 }
                 else {
                     game_viewer_print(players_on_base[i]->name +" WAS CAUGHT STEALING BASE "<< i+2 << "\n");
                     outs++;
                 }
-                players_on_base[i] = NULL;
+                occupied_bases &= ~(1 << i);
                 game_viewer_line(print();wait_for_user_input(""));
             }
         }
@@ -251,157 +264,126 @@ uint8_t Base_State::check_stolen_bases(Player* pitcher) {
 }
 
 
-bool Base_State::will_runner_attempt_steal(eBases runner_base, Player* pitcher) {
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+bool Base_State<Offense_Stats, Defense_Stats, record_events>::will_runner_attempt_steal(eBases runner_base) {
     debug_line(assert((runner_base == FIRST_BASE) || (runner_base == SECOND_BASE)))
-
-    Player* runner = players_on_base[runner_base];
+    const Steal_Defense_Probabilities& defense = pitching_team->steal_defense;
 
     // Will the runner steal or not: index 1 == yes, index 0 == no
     float runner_attempt_probs[2];
-    float pitcher_attempt_probs[2];
-    const float* league_attempt_probs = ALL_LEAGUE_STATS[pitcher->stats.current_year].steal_attempt_probs[runner_base];
-
-    float runner_sbo_multiplier = ALL_LEAGUE_STATS[runner->stats.current_year].sbo_on_first_percent;
-    float pitcher_sbo_multiplier = ALL_LEAGUE_STATS[pitcher->stats.current_year].sbo_on_first_percent;
-    if (runner_base == SECOND_BASE) {
-        runner_sbo_multiplier = 1 - runner_sbo_multiplier;
-        pitcher_sbo_multiplier = 1 - pitcher_sbo_multiplier;
-    }
-
-    float runner_sbo = runner->stats.get_stat(PLAYER_BASERUNNING, "SB_opp", .0f)*runner_sbo_multiplier;
-    if (runner_sbo == 0)
-        runner_attempt_probs[1] = 0;
-    else
-        runner_attempt_probs[1] = (runner->stats.get_stat(PLAYER_BASERUNNING, BASE_STEALING_STAT_STRINGS[runner_base][0], .0f) + runner->stats.get_stat(PLAYER_BASERUNNING, BASE_STEALING_STAT_STRINGS[runner_base][1], .0f))/runner_sbo;;
+    runner_attempt_probs[1] = runner_probabilities[runner_base]->steal_attempt[runner_base];
     runner_attempt_probs[0] = 1 - runner_attempt_probs[1];
 
-    float pitcher_sbo = pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, "SB_opp", .0f)*pitcher_sbo_multiplier;
-    if (pitcher_sbo <= 20)
-        pitcher_attempt_probs[1] = league_attempt_probs[1];
-    else
-        pitcher_attempt_probs[1] = (pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, BASE_STEALING_STAT_STRINGS[runner_base][0], .0f) + pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, BASE_STEALING_STAT_STRINGS[runner_base][1], .0f))/pitcher_sbo;
+    float pitcher_attempt_probs[2];
+    pitcher_attempt_probs[1] = defense.attempt[runner_base];
     pitcher_attempt_probs[0] = 1 - pitcher_attempt_probs[1];
 
-    
     float attempt_probs[2];
-    calculate_event_probabilities(runner_attempt_probs, pitcher_attempt_probs, league_attempt_probs, attempt_probs, 2);
-    return get_random_event(attempt_probs, 2);
+    calculate_event_probabilities(runner_attempt_probs, pitcher_attempt_probs, defense.league_attempt_probs[runner_base], attempt_probs, 2);
+    return Event_Thresholds<2>(attempt_probs).draw();
 }
 
 
-bool Base_State::will_steal_succeed(eBases runner_starting_base, Player* pitcher) {
-    Player* runner = players_on_base[runner_starting_base];
-    Player* baseman = pitching_team->fielders[BASE_TO_POSITION_KEY[runner_starting_base+1]];
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+bool Base_State<Offense_Stats, Defense_Stats, record_events>::will_steal_succeed(eBases runner_starting_base) {
+    const Steal_Defense_Probabilities& defense = pitching_team->steal_defense;
 
     // Will the runner successfully steal: index 1 == yes, index 0 == no
     float runner_probs[2];
-    float defense_probs[2];
-    const float* league_probs = ALL_LEAGUE_STATS[pitcher->stats.current_year].steal_success_probs[runner_starting_base];
-
-    float runner_steals = runner->stats.get_stat(PLAYER_BASERUNNING, BASE_STEALING_STAT_STRINGS[runner_starting_base][0], .0f);
-    float runner_caught = runner->stats.get_stat(PLAYER_BASERUNNING, BASE_STEALING_STAT_STRINGS[runner_starting_base][1], .0f);
-    if (runner_steals + runner_caught == 0)
-        runner_probs[1] = runner->stats.get_stat(PLAYER_BASERUNNING, "stolen_base_perc", .0f)/100;
-    else
-        runner_probs[1] = runner_steals/(runner_steals + runner_caught);
+    runner_probs[1] = runner_probabilities[runner_starting_base]->steal_success[runner_starting_base];
     runner_probs[0] = 1 - runner_probs[1];
 
-    float pitcher_steals = pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, BASE_STEALING_STAT_STRINGS[runner_starting_base][0], .0f);
-    float pitcher_caught = pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, BASE_STEALING_STAT_STRINGS[runner_starting_base][1], .0f);
-    float baseman_fielding = baseman->stats.get_stat(PLAYER_FIELDING, "f_fielding_perc", .0f);
-    if (pitcher_steals + pitcher_caught == 0)
-        defense_probs[1] = league_probs[1];
-    else
-        defense_probs[1] = std::clamp(baseman_fielding * pitcher_steals/(pitcher_steals + pitcher_caught), MIN_DEFENSE_STOLEN_BASE_PROB, MAX_DEFENSE_STOLEN_BASE_PROB); // We don't want pitchers who never ever give up stolen bases
+    float defense_probs[2];
+    defense_probs[1] = defense.success[runner_starting_base];
     defense_probs[0] = 1 - defense_probs[1];
 
     float success_probs[2];
-    calculate_event_probabilities(runner_probs, defense_probs, league_probs, success_probs, 2);
-    return get_random_event(success_probs, 2);
+    calculate_event_probabilities(runner_probs, defense_probs, defense.league_success_probs[runner_starting_base], success_probs, 2);
+    return Event_Thresholds<2>(success_probs).draw();
 }
 
 
-// Return runs scored after hit
-uint8_t Base_State::handle_ball_in_play(Player* batter, const Ball_In_Play_Result& result) {
+// Return runs scored after hit, and fills in which runners took an extra base
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+uint8_t Base_State<Offense_Stats, Defense_Stats, record_events>::handle_ball_in_play(Player* batter, Ball_In_Play_Result& result) {
     if (result.batter_bases_advanced == 0) {
         return 0;
     }
 
-    uint8_t runs_scored = 0;
-    int max_base = HOME_PLATE + 1; // Makes sure that runners can't pass other runners
-    for (int i = THIRD_BASE; i >= FIRST_BASE; i--) {
-
-        if (base_occupied((eBases)i)) {
-            int new_base = i + get_runner_advancement((eBases)i, result.batter_bases_advanced, max_base);
-            if (new_base > THIRD_BASE) {
-                game_viewer_print("\t -" << players_on_base[i]->name << " SCORED\n");
-                runs_scored++;
-            }
-            else {
-                players_on_base[new_base] = players_on_base[i];
-                if (new_base < max_base) max_base = new_base;
-            }
-
-            players_on_base[i] = NULL;
+    const Base_Transition (&transitions)[4] = BASE_TRANSITIONS.hits[result.batter_bases_advanced - 1][occupied_bases];
+    uint8_t extra_bases_taken = 0;
+    for (eBases base : {SECOND_BASE, FIRST_BASE}) { // Lead runner decides first, a runner on third always scores on a hit
+        if ((transitions[extra_bases_taken].extra_base_candidates & (1 << base)) && Offense_Stats::has_baserunning(players_on_base[base])
+                && will_runner_take_extra_base(base, result.batter_bases_advanced)) {
+            extra_bases_taken |= 1 << base;
         }
     }
-
-    int batter_base = result.batter_bases_advanced - 1;
-    if (batter_base > THIRD_BASE) {
-        game_viewer_print("\t -" << batter->name << " SCORED\n");
-        runs_scored++;
-    }
-    else {
-        players_on_base[batter_base] = batter;
-    }
-    return runs_scored;
+    result.extra_bases_taken = extra_bases_taken;
+    return apply_transition(transitions[extra_bases_taken], batter);
 }
 
 
-uint8_t Base_State::get_runner_advancement(eBases starting_base, uint8_t batter_bases_advanced, int max_base) {
-    if ((starting_base + batter_bases_advanced > THIRD_BASE) || (starting_base + batter_bases_advanced >= max_base - 1) || (players_on_base[starting_base]->stats[PLAYER_BASERUNNING].empty())) {
-        return batter_bases_advanced;
-    }
-
-    const int times_in_situation = players_on_base[starting_base]->stats.get_stat(PLAYER_BASERUNNING, BASERUNNING_STAT_STRINGS[starting_base][batter_bases_advanced-1][0], .0f);
-    float extra_base_percentage;
-    if (times_in_situation == 0) { 
-        extra_base_percentage = players_on_base[starting_base]->stats.get_stat(PLAYER_BASERUNNING, "extra_bases_taken_perc", .0f)/100;
-    }
-    else {
-        extra_base_percentage = players_on_base[starting_base]->stats.get_stat(PLAYER_BASERUNNING, BASERUNNING_STAT_STRINGS[starting_base][batter_bases_advanced-1][1], .0f)/times_in_situation;
-    }
-
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+bool Base_State<Offense_Stats, Defense_Stats, record_events>::will_runner_take_extra_base(eBases starting_base, uint8_t batter_bases_advanced) {
+    const float extra_base_percentage = runner_probabilities[starting_base]->extra_base[starting_base][batter_bases_advanced-1];
     const float normal_base_percentage = 1.0 - extra_base_percentage;
     float outcomes[2] = {normal_base_percentage, extra_base_percentage};
 
-    return get_random_event(outcomes, 2) + batter_bases_advanced;
+    return Event_Thresholds<2>(outcomes).draw();
 }
 
 
-uint8_t Base_State::handle_walk(Player* batter) {
-    uint8_t runs_scored = 0;
-    Player* current_player = players_on_base[FIRST_BASE];
-    Player* temp;
-    uint8_t current_base = FIRST_BASE;
+// Puts the batting team's runners on base, for half innings that pick up in the middle
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+void Base_State<Offense_Stats, Defense_Stats, record_events>::place_runners(const Half_Inning_Situation& situation) {
+    occupied_bases = situation.occupied_bases;
+    for (int i = FIRST_BASE; i <= THIRD_BASE; i++) {
+        if (!base_occupied((eBases)i)) continue;
+        uint8_t slot = situation.runner_batting_slots[i];
+        players_on_base[i] = batting_team->batting_order[slot];
+        runner_probabilities[i] = &batting_team->batting_order_runner_probabilities[slot];
+    }
+}
+
+
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+uint8_t Base_State<Offense_Stats, Defense_Stats, record_events>::handle_walk(Player* batter) {
+    return apply_transition(BASE_TRANSITIONS.walks[occupied_bases], batter);
+}
+
 
-    while (current_player != NULL) {
-        if (current_base >= THIRD_BASE) {
-            game_viewer_print("\t -" << players_on_base[current_base]->name << " SCORED\n");
-            ++runs_scored;
-            break;
+// Moves the runners and the batter, returns the runs scored
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+uint8_t Base_State<Offense_Stats, Defense_Stats, record_events>::apply_transition(const Base_Transition& transition, Player* batter) {
+    Player* new_players_on_base[3] = {};
+    const Runner_Probabilities* new_runner_probabilities[3] = {};
+    for (int i = THIRD_BASE; i >= FIRST_BASE; i--) {
+        if (!base_occupied((eBases)i)) continue;
+        if (transition.runner_destinations[i] == HOME_PLATE) {
+            game_viewer_print("\t -" << players_on_base[i]->name << " SCORED\n");
         }
-        temp = players_on_base[++current_base];
-        players_on_base[current_base] = current_player;
-        current_player = temp;
+        else {
+            new_players_on_base[transition.runner_destinations[i]] = players_on_base[i];
+            new_runner_probabilities[transition.runner_destinations[i]] = runner_probabilities[i];
+        }
+    }
+    if (transition.batter_destination == HOME_PLATE) {
+        game_viewer_print("\t -" << batter->name << " SCORED\n");
+    }
+    else {
+        new_players_on_base[transition.batter_destination] = batter;
+        new_runner_probabilities[transition.batter_destination] = &batting_team->batting_order_runner_probabilities[batting_team->position_in_batting_order];
     }
 
-    players_on_base[FIRST_BASE] = batter;
-    return runs_scored;
+    std::copy(new_players_on_base, new_players_on_base + 3, players_on_base);
+    std::copy(new_runner_probabilities, new_runner_probabilities + 3, runner_probabilities);
+    occupied_bases = transition.new_mask;
+    return transition.runs_scored;
 }
 
 
-void Base_State::print() {
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+void Base_State<Offense_Stats, Defense_Stats, record_events>::print() {
     const char empty_base = 'o';
     const char full_base = (char)254;
     // Print out second base
@@ -441,4 +423,29 @@ void Base_State::print() {
     }
 
     std::cout << "\n\n\t\tH\n";
-}
\ No newline at end of file
+}
+
+
+template <class Offense_Stats, class Defense_Stats, bool record_events>
+static uint8_t play_half_inning(Team_Game_State* batting_team, Team_Game_State* pitching_team, const Matchup_Table* matchup_table, uint8_t half_inning_number,
+                                uint day_of_year, float runs_to_end_game, const Half_Inning_Situation& situation, Game_Event_Recorder* event_recorder) {
+    return Half_Inning<Offense_Stats, Defense_Stats, record_events>(batting_team, pitching_team, matchup_table, half_inning_number, day_of_year, runs_to_end_game, situation, event_recorder).play();
+}
+
+
+template <bool record_events>
+static Half_Inning_Player get_half_inning_player(const Team_Game_State* batting_team, const Team_Game_State* pitching_team) {
+    if (batting_team->team->has_baserunning_stats()) {
+        if (pitching_team->team->has_baserunning_stats()) return play_half_inning<Full_Stat_Availability, Full_Stat_Availability, record_events>;
+        return play_half_inning<Full_Stat_Availability, Basic_Stat_Availability, record_events>;
+    }
+    if (pitching_team->team->has_baserunning_stats()) return play_half_inning<Basic_Stat_Availability, Full_Stat_Availability, record_events>;
+    return play_half_inning<Basic_Stat_Availability, Basic_Stat_Availability, record_events>;
+}
+
+
+// The offense's baserunning and the defense's batting against stats are the only ones that depend on the era
+Half_Inning_Player get_half_inning_player(const Team_Game_State* batting_team, const Team_Game_State* pitching_team, bool record_events) {
+    if (record_events) return get_half_inning_player<true>(batting_team, pitching_team);
+    return get_half_inning_player<false>(batting_team, pitching_team);
+}
@@ -2,13 +2,27 @@
 
 #include "player.hpp"
 #include "team.hpp"
+#include "includes.hpp"
+#include "matchup_probabilities.hpp"
+#include "event_log.hpp"
 
 #include <stdint.h>
+#include <cassert>
 
 
 // We will put more in here later (ex: double plays, pop flys, etc.)
 struct Ball_In_Play_Result {
     uint8_t batter_bases_advanced = 0;
+    uint8_t extra_bases_taken = 0; // Filled in by Base_State::handle_ball_in_play, see Base_Transition_Tables::hits
+};
+
+
+// Outs and runners at the start of a half inning. Half innings normally start with no outs and nobody on, except in games
+// that pick up in the middle of one (see Game_Situation).
+struct Half_Inning_Situation {
+    uint8_t outs = 0;
+    uint8_t occupied_bases = 0; // Bit mask, see Base_Transition_Tables
+    uint8_t runner_batting_slots[3] = {0, 0, 0}; // The batting order slot of the runner on each occupied base
 };
 
 
@@ -17,81 +31,156 @@ class At_Bat {
         uint8_t balls;
         uint8_t strikes;
 
-        Team* batting_team;
-        Team* pitching_team;
+        Team_Game_State* batting_team;
+        Team_Game_State* pitching_team;
 
         Player* pitcher;
         Player* batter;
+        const Matchup_Probabilities* probabilities;
 
-        At_Bat(Team* batting_team, Team* pitching_team);
+        At_Bat(Team_Game_State* batting_team, Team_Game_State* pitching_team, const Matchup_Probabilities* probabilities);
         eAt_Bat_Outcomes play();
 };
 
 
+/* Stat availability policies. Baserunning and batting against stats only exist from 1912 on (see PLAYER_STAT_EARLIEST_YEARS),
+so for teams from before then we know at compile time that runners and pitchers never have them and steals and extra bases
+are never simulated. Teams from later years can still be missing a single player's tables, so that policy asks the player.
+A half inning is compiled once for each (offense, defense) pair of policies, and once more with record_events set for games
+that are written to an event log, so games that are not logged never even check for a log. */
+struct Basic_Stat_Availability {
+    static bool has_baserunning(const Player* runner) {
+        debug_line(assert(!runner->stats.has_stats(PLAYER_BASERUNNING)))
+        return false;
+    }
+    static bool has_batting_against(const Player* pitcher) {
+        debug_line(assert(!pitcher->stats.has_stats(PLAYER_BATTING_AGAINST)))
+        return false;
+    }
+};
+
+struct Full_Stat_Availability {
+    static bool has_baserunning(const Player* runner) {
+        return runner->stats.has_stats(PLAYER_BASERUNNING);
+    }
+    static bool has_batting_against(const Player* pitcher) {
+        return pitcher->stats.has_stats(PLAYER_BATTING_AGAINST);
+    }
+};
+
+
+/* Bases are encoded as a 3 bit occupancy mask (bit i is set when there is a runner on base i), so every walk and hit can
+be resolved with a single lookup in a precomputed table instead of walking the bases. */
+const uint8_t NUM_BASE_MASKS = 8;
+const uint8_t NUM_HIT_TYPES = 4; // Single, double, triple, home run
+
+// Where every runner (and the batter) ends up after one play, for one starting mask
+struct Base_Transition {
+    uint8_t new_mask = 0;
+    uint8_t runs_scored = 0;
+    uint8_t runner_destinations[3] = {FIRST_BASE, SECOND_BASE, THIRD_BASE}; // Indexed by starting base, HOME_PLATE if the runner scored
+    uint8_t batter_destination = FIRST_BASE;
+    uint8_t extra_base_candidates = 0; // Bit i is set if the runner on base i gets to decide whether to take an extra base
+};
+
+class Base_Transition_Tables {
+    public:
+        Base_Transition walks[NUM_BASE_MASKS];
+
+        /* Indexed by [hit type][starting mask][extra bases taken], where bit i of extra bases taken is set if the runner who
+        started on base i took an extra base. Runners decide from the lead runner back, and a runner can only take an extra
+        base if the runners ahead of them left room, so extra_base_candidates only covers the runners that have not decided yet. */
+        Base_Transition hits[NUM_HIT_TYPES][NUM_BASE_MASKS][4];
+
+        Base_Transition_Tables();
+
+    private:
+        static Base_Transition make_walk_transition(uint8_t mask);
+        static Base_Transition make_hit_transition(uint8_t bases_advanced, uint8_t mask, uint8_t extra_bases_taken);
+};
+
+extern const Base_Transition_Tables BASE_TRANSITIONS;
+
+
+template <class Offense_Stats, class Defense_Stats, bool record_events>
 class Base_State {
     public:
         Base_State() {}
-        Base_State(Team* batting_team, Team* pitching_team) : players_on_base(), batting_team(batting_team), pitching_team(pitching_team) {}
+        Base_State(Team_Game_State* batting_team, Team_Game_State* pitching_team, Game_Event_Recorder* event_recorder)
+            : players_on_base(), runner_probabilities(), batting_team(batting_team), pitching_team(pitching_team), event_recorder(event_recorder) {}
 
+        void place_runners(const Half_Inning_Situation& situation);
         uint8_t handle_walk(Player* batter);
-        uint8_t handle_ball_in_play(Player* batter, const Ball_In_Play_Result& ball_in_play_result);
+        uint8_t handle_ball_in_play(Player* batter, Ball_In_Play_Result& ball_in_play_result);
         uint8_t check_stolen_bases(Player* pitcher);
         bool bases_empty();
         void print();
 
     private:
-        Player* players_on_base[3];
-        Team* batting_team;
-        Team* pitching_team;
+        uint8_t occupied_bases = 0; // Bit mask, see Base_Transition_Tables
+        Player* players_on_base[3]; // Only valid for the bases set in occupied_bases
+        const Runner_Probabilities* runner_probabilities[3]; // Points into the batting team's batting_order_runner_probabilities
+        Team_Game_State* batting_team;
+        Team_Game_State* pitching_team;
+        Game_Event_Recorder* event_recorder; // Only used when record_events is set
 
         bool can_simulate_steal(Player* runner, Player* pitcher);
-        bool will_runner_attempt_steal(eBases runner_base, Player* pitcher);
-        bool will_steal_succeed(eBases runner_starting_base, Player* pitcher);
-        uint8_t get_runner_advancement(eBases starting_base, uint8_t batter_bases_advanced, int max_base);
+        bool will_runner_attempt_steal(eBases runner_base);
+        bool will_steal_succeed(eBases runner_starting_base);
+        bool will_runner_take_extra_base(eBases starting_base, uint8_t batter_bases_advanced);
+        uint8_t apply_transition(const Base_Transition& transition, Player* batter);
 
         bool base_occupied(eBases base) {
-            return players_on_base[base] != NULL;
+            return occupied_bases & (1 << base);
         }
 };
 
 
+template <class Offense_Stats, class Defense_Stats, bool record_events>
 class Half_Inning {
     public:
         const static uint8_t NUM_OUTS_TO_END_INNING = 3;
-        
-        Half_Inning(Team* batting_team, Team* pitching_team, uint8_t half_inning_number, uint day_of_year, float runs_to_end_game);
+
+
+        Half_Inning(Team_Game_State* batting_team, Team_Game_State* pitching_team, const Matchup_Table* matchup_table, uint8_t half_inning_number, uint day_of_year,
+                    float runs_to_end_game, const Half_Inning_Situation& situation, Game_Event_Recorder* event_recorder);
         uint8_t play();
     
     private:
-        Team* batting_team;
-        Team* pitching_team;
+        Team_Game_State* batting_team;
+        Team_Game_State* pitching_team;
+        const Matchup_Table* matchup_table; // The batting team's batters against the pitching team's pitchers
 
         uint8_t outs;
         uint8_t runs_scored;
         float runs_to_end_game; // This is a float so it can be infinity
 
-        Base_State bases;
+        Base_State<Offense_Stats, Defense_Stats, record_events> bases;
+        Game_Event_Recorder* event_recorder; // Only used when record_events is set
 
         uint8_t half_inning_number;
         uint day_of_year;
 
         void play_at_bat();
-        Ball_In_Play_Result get_ball_in_play_result(Player* batter, Player* pitcher);
-        uint8_t get_batter_bases_advanced(Player* batter, Player* pitcher);
+        Ball_In_Play_Result get_ball_in_play_result(Player* batter, Player* pitcher, const Matchup_Probabilities& probabilities);
+        uint8_t get_batter_bases_advanced(Player* batter, Player* pitcher, const Matchup_Probabilities& probabilities);
 };
 
 
+// Plays a whole half inning (or the rest of one, starting from situation) and returns the runs scored. Picked once per game for each team at bat (see get_half_inning_player).
+typedef uint8_t (*Half_Inning_Player)(Team_Game_State* batting_team, Team_Game_State* pitching_team, const Matchup_Table* matchup_table, uint8_t half_inning_number,
+                                      uint day_of_year, float runs_to_end_game, const Half_Inning_Situation& situation, Game_Event_Recorder* event_recorder);
+
+Half_Inning_Player get_half_inning_player(const Team_Game_State* batting_team, const Team_Game_State* pitching_team, bool record_events);
+
+
 class Game_Result {
     public:
-        Team* home_team;
-        Team* away_team;
         int final_score[2];
         int half_innings_played;
         eTeam winner;
 
-        Game_Result(Team* home_team, Team* away_team, int final_score[2], int half_innings_played) {
-            this->home_team = home_team;
-            this->away_team = away_team;
+        Game_Result(int final_score[2], int half_innings_played) {
             this->final_score[HOME_TEAM] = final_score[HOME_TEAM];
             this->final_score[AWAY_TEAM] = final_score[AWAY_TEAM];
             this->half_innings_played = half_innings_played;
@@ -102,10 +191,5 @@ class Game_Result {
             else {
                 winner = AWAY_TEAM;
             }
-
-            home_team->running_stats.runs_scored += final_score[HOME_TEAM];
-            home_team->running_stats.runs_allowed += final_score[AWAY_TEAM];
-            away_team->running_stats.runs_scored += final_score[AWAY_TEAM];
-            away_team->running_stats.runs_allowed += final_score[HOME_TEAM];
         }
 };
\ No newline at end of file
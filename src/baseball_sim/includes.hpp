@@ -13,8 +13,9 @@
 
 
 #if BASEBALL_VIEW
-    #define game_viewer_print(print_string) std::cout << print_string;
-    #define game_viewer_line(line_of_code) line_of_code;
+    extern bool game_viewer_enabled; // Turned off while find-game plays the games leading up to the one it finds
+    #define game_viewer_print(print_string) if (game_viewer_enabled) std::cout << print_string;
+    #define game_viewer_line(line_of_code) if (game_viewer_enabled) {line_of_code;}
 #else
     #define game_viewer_print(print_string) /*Print a string if we are in game viewing mode*/
     #define game_viewer_line(line_of_code) /*Compile a line of code only if we are in game viewing mode*/
@@ -0,0 +1,218 @@
+#include "json.hpp"
+
+#include <string>
+#include <map>
+#include <variant>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+
+static void skip_whitespace(const string& text, size_t& pos) {
+    while ((pos < text.size()) && isspace((unsigned char)text[pos])) pos++;
+}
+
+
+static void expect_char(const string& text, size_t& pos, char expected) {
+    skip_whitespace(text, pos);
+    if ((pos >= text.size()) || (text[pos] != expected)) {
+        throw runtime_error(string("Malformed JSON: expected '") + expected + "' at position " + to_string(pos));
+    }
+    pos++;
+}
+
+
+static string parse_json_string(const string& text, size_t& pos) {
+    expect_char(text, pos, '"');
+    string result;
+    while ((pos < text.size()) && (text[pos] != '"')) {
+        char c = text[pos++];
+        if (c == '\\') {
+            if (pos >= text.size()) break;
+            char escaped = text[pos++];
+            switch (escaped) {
+                case 'n': result += '\n'; break;
+                case 't': result += '\t'; break;
+                case 'r': result += '\r'; break;
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                default: result += escaped; break; // Covers \" \\ and \/ (unicode escapes are not needed for our requests)
+            }
+        }
+        else {
+            result += c;
+        }
+    }
+    expect_char(text, pos, '"');
+    return result;
+}
+
+
+static Json_Value parse_json_value(const string& text, size_t& pos) {
+    skip_whitespace(text, pos);
+    if (pos >= text.size()) {
+        throw runtime_error("Malformed JSON: missing value");
+    }
+
+    if (text[pos] == '"') {
+        return Json_Value(in_place_type<string>, parse_json_string(text, pos));
+    }
+    if (text.compare(pos, 4, "true") == 0) {
+        pos += 4;
+        return Json_Value(in_place_type<bool>, true);
+    }
+    if (text.compare(pos, 5, "false") == 0) {
+        pos += 5;
+        return Json_Value(in_place_type<bool>, false);
+    }
+    if (text.compare(pos, 4, "null") == 0) {
+        pos += 4;
+        return monostate{};
+    }
+
+    size_t chars_read = 0;
+    double number;
+    try {
+        number = stod(text.substr(pos), &chars_read);
+    }
+    catch (const logic_error&) {
+        throw runtime_error("Malformed JSON: unsupported value at position " + to_string(pos));
+    }
+    pos += chars_read;
+    return Json_Value(in_place_type<double>, number);
+}
+
+
+Json_Object Json_Object::parse(const string& text) {
+    Json_Object result;
+    size_t pos = 0;
+
+    expect_char(text, pos, '{');
+    skip_whitespace(text, pos);
+    if ((pos < text.size()) && (text[pos] == '}')) {
+        pos++;
+        return result;
+    }
+
+    while (true) {
+        string key = parse_json_string(text, pos);
+        expect_char(text, pos, ':');
+        result.values[key] = parse_json_value(text, pos);
+
+        skip_whitespace(text, pos);
+        if ((pos < text.size()) && (text[pos] == ',')) {
+            pos++;
+            continue;
+        }
+        expect_char(text, pos, '}');
+        break;
+    }
+    return result;
+}
+
+
+bool Json_Object::has(const string& key) const {
+    return values.find(key) != values.end();
+}
+
+
+string Json_Object::get_string(const string& key, const string& default_val) const {
+    auto it = values.find(key);
+    if ((it == values.end()) || holds_alternative<monostate>(it->second)) return default_val;
+    if (!holds_alternative<string>(it->second)) {
+        throw runtime_error("Expected \"" + key + "\" to be a string");
+    }
+    return get<string>(it->second);
+}
+
+
+double Json_Object::get_number(const string& key, double default_val) const {
+    auto it = values.find(key);
+    if ((it == values.end()) || holds_alternative<monostate>(it->second)) return default_val;
+    if (!holds_alternative<double>(it->second)) {
+        throw runtime_error("Expected \"" + key + "\" to be a number");
+    }
+    return get<double>(it->second);
+}
+
+
+void Json_Writer::begin_object(const string& key) {
+    write_key(key);
+    stream << "{";
+    needs_comma = false;
+}
+
+
+void Json_Writer::end_object() {
+    stream << "}";
+    needs_comma = true;
+}
+
+
+void Json_Writer::begin_array(const string& key) {
+    write_key(key);
+    stream << "[";
+    needs_comma = false;
+}
+
+
+void Json_Writer::end_array() {
+    stream << "]";
+    needs_comma = true;
+}
+
+
+void Json_Writer::add(const string& key, const string& value) {
+    write_key(key);
+    write_string(value);
+    needs_comma = true;
+}
+
+
+void Json_Writer::add(const string& key, const char* value) {
+    add(key, string(value));
+}
+
+
+void Json_Writer::add_number(const string& key, double value) {
+    write_key(key);
+    if (isfinite(value)) stream << value;
+    else stream << "null";
+    needs_comma = true;
+}
+
+
+void Json_Writer::add(const string& key, bool value) {
+    write_key(key);
+    stream << (value ? "true" : "false");
+    needs_comma = true;
+}
+
+
+string Json_Writer::str() const {
+    return stream.str();
+}
+
+
+// Keys are left out for values inside of arrays
+void Json_Writer::write_key(const string& key) {
+    if (needs_comma) stream << ",";
+    if (!key.empty()) {
+        write_string(key);
+        stream << ":";
+    }
+}
+
+
+void Json_Writer::write_string(const string& str) {
+    stream << '"';
+    for (char c : str) {
+        if ((c == '"') || (c == '\\')) stream << '\\' << c;
+        else if (c == '\n') stream << "\\n";
+        else if (c == '\t') stream << "\\t";
+        else stream << c;
+    }
+    stream << '"';
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <variant>
+#include <sstream>
+#include <type_traits>
+
+
+typedef std::variant<std::monostate, double, std::string, bool> Json_Value;
+
+/* A flat JSON object (no nested objects or arrays), which is all the simulation server needs to read requests.
+Throws std::runtime_error on malformed input. */
+class Json_Object {
+    public:
+        Json_Object() {}
+
+        static Json_Object parse(const std::string& text);
+
+        bool has(const std::string& key) const;
+        std::string get_string(const std::string& key, const std::string& default_val) const;
+        double get_number(const std::string& key, double default_val) const;
+
+    private:
+        std::map<std::string, Json_Value> values;
+};
+
+
+/* Builds a single line of JSON. Objects and arrays are opened and closed explicitly:
+    writer.begin_object(); writer.add("wins", 97); writer.begin_array("games"); ... writer.end_array(); writer.end_object(); */
+class Json_Writer {
+    public:
+        void begin_object(const std::string& key = "");
+        void end_object();
+        void begin_array(const std::string& key);
+        void end_array();
+
+        void add(const std::string& key, const std::string& value);
+        void add(const std::string& key, const char* value);
+        void add(const std::string& key, bool value);
+
+        template <class T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+        void add(const std::string& key, T value) {
+            add_number(key, (double)value);
+        }
+
+        std::string str() const;
+
+    private:
+        std::ostringstream stream;
+        bool needs_comma = false;
+
+        void add_number(const std::string& key, double value);
+        void write_key(const std::string& key);
+        void write_string(const std::string& str);
+};
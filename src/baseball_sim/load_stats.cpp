@@ -5,16 +5,23 @@
 #include "team.hpp"
 #include "player.hpp"
 #include "utils.hpp"
+#include "career_store.hpp"
+#include "matchup_probabilities.hpp"
+#include "stat_database.hpp"
+#include "worker_pool.hpp"
 
-#include <unordered_map>
 #include <algorithm>
+#include <set>
+#include <thread>
 
 using namespace std;
 
 
 All_League_Stats_Wrapper ALL_LEAGUE_STATS;
-unordered_map<string, unique_ptr<Player>> player_cache;
-unordered_map<string, unique_ptr<Team>> team_cache;
+Entity_Registry<string> player_id_registry;
+Entity_Registry<Player> player_registry;
+Entity_Registry<Team_Definition> team_registry;
+static Entity_Registry<const Team_Definition*> teams_by_main_abbreviation; // Lets load_team find a cached team before reading any of its files
 
 
 Season Stat_Loader::load_season(uint year) {
@@ -23,17 +30,21 @@ Season Stat_Loader::load_season(uint year) {
         throw exception();
     }
 
+    check_season_files(year);
     load_league_year_stats(year);
-    vector<string> real_team_abbrs = load_all_real_team_abbrs_from_year(year);
-    vector<Team*> locally_saved_teams = load_all_saved_teams_from_year(year);
-    
-    for (const string& abbr : real_team_abbrs) {
-        if (!is_team_cached(get_team_cache_id(abbr, year))) {
-            cerr << "Data not found locally for "+ abbr + "_"+ to_string(year) + ". You must scrape stats for this team before simulating this season.\n";
-            throw exception();
-        }
+    vector<const Team_Definition*> locally_saved_teams = load_all_saved_teams_from_year(year);
+
+    // Every probability the season needs is compiled into one file, which later runs read in place as long as none of the
+    // stat files it was derived from changed. It has to be attached before the season sets up its teams.
+    const string compiled_file_path = get_compiled_season_file_path(year);
+    uint64_t content_hash = hash_source_files(locally_saved_teams);
+    bool compiled_file_attached = probability_store.attach_compiled_file(compiled_file_path, content_hash, locally_saved_teams);
+
+    Season season(locally_saved_teams, year);
+    if (!compiled_file_attached) {
+        probability_store.write_compiled_file(compiled_file_path, content_hash, locally_saved_teams, season.get_matchup_pairs());
     }
-    return Season(locally_saved_teams, year);
+    return season;
 }
 
 
@@ -47,26 +58,180 @@ std::vector<std::string> Stat_Loader::load_all_real_team_abbrs_from_year(uint ye
 }
 
 
-vector<Team*> Stat_Loader::load_all_saved_teams_from_year(uint year) {
-    const Stat_Table all_teams_table = load_all_teams_table();
+vector<const Team_Definition*> Stat_Loader::load_all_saved_teams_from_year(uint year) {
+    vector<const Team_Definition*> loaded_teams;
+    for (const string& team_abbr : get_saved_team_abbrs_from_year(year)) {
+        loaded_teams.push_back(load_team(team_abbr, year));
+    }
+    return loaded_teams;
+}
+
+
+// Returns the main abbreviations of every team that has a directory for this year
+vector<string> Stat_Loader::get_saved_team_abbrs_from_year(uint year) {
+    Arena all_teams_arena; // We only need this table until we have the abbreviations
+    const Stat_Table all_teams_table = load_all_teams_table(all_teams_arena);
     vector<string> team_abbreviations = all_teams_table.column<string>("TEAM_ID", "NO ID FOUND");
 
-    vector<Team*> loaded_teams;
+    vector<string> saved_team_abbrs;
     for (const string& team_abbr : team_abbreviations) {
         string team_year_dir = get_team_year_dir_path(team_abbr, year);
 
-        if (file_exists(team_year_dir)) { // If file doesn't exist, for now we just assume the team didn't exist that year (this is verified later)
-            loaded_teams.push_back(load_team(team_abbr, year));
+        if (file_exists(team_year_dir)) { // If file doesn't exist, for now we just assume the team didn't exist that year (check_season_files verifies this)
+            saved_team_abbrs.push_back(team_abbr);
         }
     }
-    return loaded_teams;
+    return saved_team_abbrs;
+}
+
+
+// Stats the files on a few threads at once, which is what makes checking a whole season quick on cold caches and network drives.
+// Returns the ones that don't exist, in the order they were given.
+static vector<string> find_missing_files(const vector<string>& filenames) {
+    const size_t FILES_PER_JOB = 64;
+    size_t num_jobs = (filenames.size() + FILES_PER_JOB - 1)/FILES_PER_JOB;
+    vector<char> file_found(filenames.size(), false);
+    if (num_jobs > 0) {
+        Worker_Pool worker_pool(max<size_t>(1, min<size_t>(thread::hardware_concurrency(), num_jobs))); // Waits for every job to finish when it goes out of scope
+        for (size_t start = 0; start < filenames.size(); start += FILES_PER_JOB) {
+            worker_pool.submit([&filenames, &file_found, start]() {
+                for (size_t i = start; i < min(start + FILES_PER_JOB, filenames.size()); i++) {
+                    file_found[i] = file_exists(filenames[i]);
+                }
+            });
+        }
+    }
+
+    vector<string> missing_files;
+    for (size_t i = 0; i < filenames.size(); i++) {
+        if (!file_found[i]) missing_files.push_back(filenames[i]);
+    }
+    return missing_files;
+}
+
+
+static void report_load_problems(const vector<string>& problems) {
+    if (problems.empty()) return;
+    for (const string& problem : problems) {
+        cerr << problem << "\n";
+    }
+    cerr << "ERROR: Found " << problems.size() << " problem(s) with the local stat data, nothing was loaded.\n";
+    throw exception();
+}
+
+
+/* Everything a season needs is checked before any of its teams are loaded. The league tables have to be read first,
+since the standings are what say which teams played that year. */
+void Stat_Loader::check_season_files(uint year) {
+    vector<string> problems;
+    for (const string& filename : find_missing_files(get_league_year_files(year))) {
+        problems.push_back("Missing file " + filename);
+    }
+
+    if (problems.empty()) {
+        load_league_year_stats(year);
+        vector<pair<string, uint>> team_years;
+        for (const string& team_abbr : get_saved_team_abbrs_from_year(year)) {
+            team_years.push_back({team_abbr, year});
+        }
+
+        set<string> found_team_cache_ids = find_missing_team_files(team_years, problems);
+        for (const string& abbr : load_all_real_team_abbrs_from_year(year)) {
+            if (!found_team_cache_ids.count(get_team_cache_id(abbr, year))) {
+                problems.push_back("Data not found locally for "+ abbr + "_"+ to_string(year) + ". You must scrape stats for this team before simulating this season.");
+            }
+        }
+    }
+    report_load_problems(problems);
+}
+
+
+void Stat_Loader::check_team_files(const vector<pair<string, uint>>& team_years) {
+    set<string> league_files;
+    for (auto const& [team_abbr, year] : team_years) {
+        vector<string> year_files = get_league_year_files(year);
+        league_files.insert(year_files.begin(), year_files.end());
+    }
+
+    vector<string> problems;
+    for (const string& filename : find_missing_files(vector<string>(league_files.begin(), league_files.end()))) {
+        problems.push_back("Missing file " + filename);
+    }
+    find_missing_team_files(team_years, problems);
+    report_load_problems(problems);
+}
+
+
+/* Which player files a team needs depends on its team tables (see get_player_stat_types_to_load), so those are read here and kept
+for load_team. Player files are only checked for teams whose own files are all there.
+Returns the (year specific) cache ids of the teams whose team files were all found. */
+set<string> Stat_Loader::find_missing_team_files(const vector<pair<string, uint>>& team_years, vector<string>& problems) {
+    set<string> found_team_cache_ids;
+    vector<pair<string, uint>> teams_to_check;
+    vector<string> team_files;
+    for (auto const& [team_abbr, year] : team_years) {
+        const string main_team_cache_id = get_team_cache_id(team_abbr, year);
+        const Team_Definition** cached_team = teams_by_main_abbreviation.find(main_team_cache_id);
+        if (cached_team) {
+            found_team_cache_ids.insert((*cached_team)->team_stats.team_cache_id);
+        }
+        else if (!file_exists(get_team_year_dir_path(team_abbr, year))) {
+            problems.push_back("No data found locally for " + main_team_cache_id + " (missing directory " + get_team_year_dir_path(team_abbr, year) + ")");
+        }
+        else {
+            teams_to_check.push_back({team_abbr, year});
+            for (int i = 0; i < NUM_TEAM_STAT_TYPES; i++) {
+                team_files.push_back(get_team_data_file_path(team_abbr, year, TEAM_STAT_NAMES[i]));
+            }
+        }
+    }
+
+    vector<string> missing_team_files = find_missing_files(team_files);
+    for (const string& filename : missing_team_files) {
+        problems.push_back("Missing file " + filename);
+    }
+
+    set<string> player_files;
+    for (auto const& [team_abbr, year] : teams_to_check) {
+        bool team_files_found = true;
+        for (int i = 0; i < NUM_TEAM_STAT_TYPES; i++) {
+            string filename = get_team_data_file_path(team_abbr, year, TEAM_STAT_NAMES[i]);
+            team_files_found &= find(missing_team_files.begin(), missing_team_files.end(), filename) == missing_team_files.end();
+        }
+        if (!team_files_found) continue;
+
+        Team_Stats team_stats = read_team_stats(team_abbr, year);
+        for (size_t i = 0; i < team_stats[TEAM_ROSTER].size(); i++) {
+            string player_id = team_stats.get_stat<string>(TEAM_ROSTER, "ID", i, "");
+            for (ePlayer_Stat_Types stat_type : get_player_stat_types_to_load(player_id, team_stats)) {
+                player_files.insert(get_player_data_file_path(player_id, PLAYER_STAT_NAMES[stat_type]));
+            }
+        }
+        found_team_cache_ids.insert(team_stats.team_cache_id);
+        checked_team_stats.insert_or_assign(get_team_cache_id(team_abbr, year), move(team_stats));
+    }
+
+    for (const string& filename : find_missing_files(vector<string>(player_files.begin(), player_files.end()))) {
+        problems.push_back("Missing file " + filename);
+    }
+    return found_team_cache_ids;
+}
+
+
+vector<string> Stat_Loader::get_league_year_files(uint year) {
+    vector<string> filenames;
+    for (int i = 0; i < NUM_LEAGUE_STAT_TYPES; i++) {
+        if (year >= LEAGUE_STAT_EARLIEST_YEARS.at((eLeague_Stat_Types)i)) {
+            filenames.push_back(get_league_data_file_path(LEAGUE_STAT_NAMES[i], year));
+        }
+    }
+    return filenames;
 }
 
 
-Stat_Table Stat_Loader::load_all_teams_table() {
+Stat_Table Stat_Loader::load_all_teams_table(Arena& arena) {
     string filename = RESOURCES_FILE_PATH + "/all_teams.csv";
-    map<string, vector<Table_Entry>> table_data = read_csv_file(filename);
-    return Stat_Table(table_data, "all_teams");
+    return Stat_Table(read_csv_file(filename), "all_teams", arena);
 }
 
 
@@ -80,30 +245,74 @@ void Stat_Loader::load_league_year_stats(uint year) {
             continue;
         }
         const string filename = get_league_data_file_path(LEAGUE_STAT_NAMES[i], year);
-        map<string, vector<Table_Entry>> file_data = read_csv_file(filename);
-        league_year_stat_tables[i] = Stat_Table(file_data, filename);
+        league_year_stat_tables[i] = read_stat_table(filename, get_year_arena(year));
     }
 
     ALL_LEAGUE_STATS.add_year(year, League_Stats(year, league_year_stat_tables));
 }
 
 
-Team* Stat_Loader::load_team(const string& main_team_abbreviation, uint year) {
+void Stat_Loader::release_year(uint year) {
+    teams_by_main_abbreviation.remove_if([year](const Team_Definition* team) { // Before the teams it points to are reset
+        return team->team_stats.year == year;
+    });
+    vector<Entity_Id> released_team_ids;
+    vector<const Player*> released_players;
+    team_registry.remove_if([year, &released_team_ids, &released_players](const Team_Definition& team) {
+        if (team.team_stats.year != year) return false;
+        released_team_ids.push_back(team.entity_id);
+        released_players.insert(released_players.end(), team.all_players.begin(), team.all_players.end());
+        return true;
+    });
+    probability_store.release_teams(released_team_ids);
+    sort(released_players.begin(), released_players.end());
+    player_registry.remove_if([&released_players](const Player& player) {
+        return binary_search(released_players.begin(), released_players.end(), &player);
+    });
+    for (auto it = checked_team_stats.begin(); it != checked_team_stats.end();) {
+        it = (it->second.year == year) ? checked_team_stats.erase(it) : next(it);
+    }
+
+    ALL_LEAGUE_STATS.remove_year(year);
+    release_year_arena(year);
+}
+
+
+// If this team was already loaded, the cached team is returned instead of loading it again (simulations may be holding pointers to it)
+const Team_Definition* Stat_Loader::load_team(const string& main_team_abbreviation, uint year) {
+    const string main_team_cache_id = get_team_cache_id(main_team_abbreviation, year);
+    const Team_Definition** cached_team = teams_by_main_abbreviation.find(main_team_cache_id);
+    if (cached_team) return *cached_team;
+
     Team_Stats team_stats = load_team_stats(main_team_abbreviation, year);
     vector<Player*> roster = load_team_roster(team_stats, year);
-    Team team(team_stats.year_specific_abbreviation, roster, team_stats);
+    Team_Definition team(team_stats.year_specific_abbreviation, roster, team_stats);
 
-    return cache_team(team, team_stats.team_cache_id);
+    const Team_Definition* new_team = cache_team(move(team), team_stats.team_cache_id);
+    teams_by_main_abbreviation.find_or_add(main_team_cache_id, [new_team](Entity_Id){return new_team;});
+    return new_team;
 }
 
 
+// Teams that were checked (see check_team_files) already had their tables read
 Team_Stats Stat_Loader::load_team_stats(const string& main_team_abbreviation, uint year) {
+    auto checked_stats = checked_team_stats.find(get_team_cache_id(main_team_abbreviation, year));
+    if (checked_stats == checked_team_stats.end()) {
+        return read_team_stats(main_team_abbreviation, year);
+    }
+    Team_Stats team_stats = move(checked_stats->second);
+    checked_team_stats.erase(checked_stats);
+    return team_stats;
+}
+
+
+Team_Stats Stat_Loader::read_team_stats(const string& main_team_abbreviation, uint year) {
     Stat_Table team_stat_tables[NUM_TEAM_STAT_TYPES];
 
     for (int i = 0; i < NUM_TEAM_STAT_TYPES; i++) {
         string filename = get_team_data_file_path(main_team_abbreviation, year, TEAM_STAT_NAMES[i]);
-        map<string, vector<Table_Entry>> file_data = read_csv_file(filename);
-        team_stat_tables[i] = Stat_Table(file_data, filename);
+        team_stat_tables[i] = read_stat_table(filename, get_year_arena(year));
+        team_stat_tables[i].add_index("ID"); // Searched for every player on the roster (see get_player_stat_types_to_load)
     }
     return Team_Stats(main_team_abbreviation, team_stat_tables, year);
 }
@@ -154,58 +363,86 @@ bool Stat_Loader::should_load_player_stat_type(const Team_Stats& team_stats, siz
 }
 
 
-Team* Stat_Loader::cache_team(const Team& team, const string& cache_id) {
-    team_cache[cache_id] = make_unique<Team>(team);
-    return team_cache[cache_id].get();
+// Nothing is ever replaced in the cache, if another thread cached this team first we return that one instead
+const Team_Definition* Stat_Loader::cache_team(Team_Definition&& team, const string& cache_id) {
+    Entity_Id id = team_registry.find_or_add(cache_id, [&team](Entity_Id new_id) {
+        team.entity_id = new_id;
+        return std::move(team);
+    });
+    return &team_registry.get(id);
 }
 
 
 Player* Stat_Loader::load_player(const string& player_name, const string& player_id, uint year, const string& team_abbreviation, const vector<ePlayer_Stat_Types>& stats_to_load) {
     const string cache_id = get_player_cache_id(player_id, team_abbreviation, year);
-    if (is_player_cached(cache_id)) { // Check if player was loaded by a different team
-        return player_cache.at(cache_id).get();
+    Player* cached_player = find_cached_player(cache_id);
+    if (cached_player) { // Check if player was loaded by a different team
+        return cached_player;
     }
 
     Player_Stats stats = load_necessary_player_stats(player_id, year, team_abbreviation, stats_to_load);
-    Player new_player(player_name, stats);
-    return cache_player(new_player, cache_id);
+    return cache_player(Player(player_name, stats), cache_id);
 }
 
 
 Player_Stats Stat_Loader::load_necessary_player_stats(const string& player_id, uint year, const string& team_abbreviation, const vector<ePlayer_Stat_Types>& stats_to_load) {
-    Stat_Table all_player_stats[NUM_PLAYER_STAT_TYPES];
+    const Stat_Table* all_player_stats[NUM_PLAYER_STAT_TYPES] = {};
 
     for (ePlayer_Stat_Types stat_type : stats_to_load) {
-        Stat_Table stat_table = load_player_stat_table(player_id, team_abbreviation, year, stat_type);
-        all_player_stats[stat_type] = stat_table;
+        all_player_stats[stat_type] = load_player_stat_table(player_id, stat_type);
     }
     return Player_Stats(player_id, year, team_abbreviation, all_player_stats);
 }
 
 
-Stat_Table Stat_Loader::load_player_stat_table(const string& player_id, const string& team_abbreviation, uint year, ePlayer_Stat_Types player_stat_type) {
+// Player files hold their whole career, so each one is only read the first time any team/year needs it
+const Stat_Table* Stat_Loader::load_player_stat_table(const string& player_id, ePlayer_Stat_Types player_stat_type) {
+    Entity_Id player_id_number = intern_player_id(player_id);
+    const Stat_Table* stored_table = career_store.find(player_id_number, player_stat_type);
+    if (stored_table) return stored_table;
+
     string stat_type = PLAYER_STAT_NAMES[player_stat_type];
     string filename = get_player_data_file_path(player_id, stat_type);
-    map<string, vector<Table_Entry>> player_file_data = read_csv_file(filename);
+    Stat_Table table = read_stat_table(filename, permanent_arena);
+    // Searched by year and team whenever a player is loaded (see Player_Stats::change_stat_table_target_row). Most careers are too
+    // short to get the index.
+    table.add_index(is_player_stat_out_of_date(player_stat_type) ? "year_ID" : "year_id");
+    return career_store.add(player_id_number, player_stat_type, move(table));
+}
+
+
+// Tables in the compiled stat database are read in place, anything else (or anything whose file changed since) is parsed from its CSV file
+Stat_Table Stat_Loader::read_stat_table(const string& filename, Arena& arena) {
+    stat_database.open(DATABASE_FILE_PATH);
+    const Compiled_Table_Header* compiled_table = stat_database.find(filename);
+    if (compiled_table) return Stat_Table(compiled_table, filename);
+    return Stat_Table(read_csv_file(filename), filename, arena);
+}
+
 
-    Stat_Table stat_table(player_file_data, filename);
-    return stat_table;
+void Stat_Loader::compile_stat_database() {
+    ::compile_stat_database(DATABASE_FILE_PATH);
 }
 
 
-Player* Stat_Loader::cache_player(const Player& player, const string& cache_id) {
-    player_cache[cache_id] = make_unique<Player>(player);
-    return player_cache.at(cache_id).get();
+Player* Stat_Loader::cache_player(Player&& player, const string& cache_id) {
+    Entity_Id id = player_registry.find_or_add(cache_id, [&player](Entity_Id new_id) {
+        player.entity_id = new_id;
+        return std::move(player);
+    });
+    return &player_registry.get(id);
 }
 
 
-bool Stat_Loader::is_team_cached(const string& team_cache_id) {
-    return team_cache.count(team_cache_id) > 0;
+// Returns NULL if the team is not cached
+const Team_Definition* Stat_Loader::find_cached_team(const string& team_cache_id) {
+    return team_registry.find(team_cache_id);
 }
 
 
-bool Stat_Loader::is_player_cached(const string& player_cache_id) {
-    return player_cache.count(player_cache_id) > 0;
+// Returns NULL if the player is not cached
+Player* Stat_Loader::find_cached_player(const string& player_cache_id) {
+    return player_registry.find(player_cache_id);
 }
 
 
@@ -231,4 +468,9 @@ std::string Stat_Loader::get_league_data_file_path(const string& league_data_fil
 
 std::string Stat_Loader::get_league_year_dir_path(uint year) {
     return LEAGUE_FILE_PATH + "/" + to_string(year);
+}
+
+
+string Stat_Loader::get_compiled_season_file_path(uint year) {
+    return COMPILED_FILE_PATH + "/" + to_string(year) + "_season_probabilities.bin";
 }
\ No newline at end of file
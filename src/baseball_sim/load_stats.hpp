@@ -13,6 +13,8 @@
 #include <unordered_map>
 #include <memory>
 #include <stdexcept>
+#include <set>
+#include <utility>
 
 
 class Stat_Loader {
@@ -20,37 +22,62 @@ class Stat_Loader {
     public:
         Stat_Loader() {}
 
-        Team* load_team(const std::string& main_team_abbreviation, uint year);
+        const Team_Definition* load_team(const std::string& main_team_abbreviation, uint year);
         Player* load_player(const std::string& player_name, const std::string& player_id, uint year, const std::string& team_abbreviation, const std::vector<ePlayer_Stat_Types>& stats_to_load);
         void load_league_year_stats(uint year);
         Season load_season(uint year);
 
+        /* Forgets everything loaded for the year (its teams, their players and probability tables, and its league stats) and
+        destroys the year's arena, which frees all of their tables at once. Later loads of the year read it again. Players' career
+        tables are shared by every year, so they are kept. Nothing may be using any of the year's teams (ex: a season or series
+        being simulated). */
+        void release_year(uint year);
+
+        /* Makes sure every file needed to load these teams (and their league years) exists before any player is loaded.
+        Every missing file is reported at once, then an exception is thrown. load_season runs the same check on its own. */
+        void check_team_files(const std::vector<std::pair<std::string, uint>>& team_years);
+
+        // Packs the data tree into the compiled stat database (see Stat_Database), which is then read instead of the CSV files
+        void compile_stat_database();
+
     private:
         const std::string RESOURCES_FILE_PATH = "../stat_collection/resources";
         const std::string DATABASE_FILE_PATH = "../stat_collection/data";
         const std::string PLAYERS_FILE_PATH = DATABASE_FILE_PATH + "/players";
         const std::string TEAMS_FILE_PATH = DATABASE_FILE_PATH + "/teams";
         const std::string LEAGUE_FILE_PATH = DATABASE_FILE_PATH + "/league";
+        const std::string COMPILED_FILE_PATH = DATABASE_FILE_PATH + "/compiled";
+
+        std::unordered_map<std::string, Team_Stats> checked_team_stats; // Team tables read while checking files, keyed by main team cache id, so load_team does not read them again
 
         std::string get_player_data_file_path(const std::string& player_id, const std::string& stat_type);
         std::string get_team_data_file_path(const std::string& main_team_abbreviation, uint year, const std::string& team_data_file_type);
         std::string get_team_year_dir_path(const std::string& main_team_abbreviation, uint year);
         std::string get_league_data_file_path(const std::string& league_data_file_type, uint year);
         std::string get_league_year_dir_path(uint year);
+        std::string get_compiled_season_file_path(uint year);
+
+        Stat_Table read_stat_table(const std::string& filename, Arena& arena);
+
+        void check_season_files(uint year);
+        std::set<std::string> find_missing_team_files(const std::vector<std::pair<std::string, uint>>& team_years, std::vector<std::string>& problems);
+        std::vector<std::string> get_league_year_files(uint year);
 
-        bool is_player_cached(const std::string& player_cache_id);
-        bool is_team_cached(const std::string& team_cache_id);
-        Player* cache_player(const Player& player, const std::string& cache_id);
-        Team* cache_team(const Team& team, const std::string& cache_id);
+        const Team_Definition* find_cached_team(const std::string& team_cache_id);
+        Player* find_cached_player(const std::string& player_cache_id);
+        Player* cache_player(Player&& player, const std::string& cache_id);
+        const Team_Definition* cache_team(Team_Definition&& team, const std::string& cache_id);
 
         Team_Stats load_team_stats(const std::string& main_team_abbreviation, uint year);
+        Team_Stats read_team_stats(const std::string& main_team_abbreviation, uint year);
         std::vector<Player*> load_team_roster(Team_Stats& team_stats, uint year);
         Player_Stats load_necessary_player_stats(const std::string& player_id, uint year, const std::string& team_abbreviation, const std::vector<ePlayer_Stat_Types>& stats_to_load);
         std::vector<ePlayer_Stat_Types> get_player_stat_types_to_load(const std::string& player_id, Team_Stats& team_stats);
         bool should_load_player_stat_type(const Team_Stats& team_stats, size_t player_row, ePlayer_Stat_Types stat_type);
-        Stat_Table load_player_stat_table(const std::string& player_id, const std::string& team_abbreviation, uint year, ePlayer_Stat_Types player_stat_type);
+        const Stat_Table* load_player_stat_table(const std::string& player_id, ePlayer_Stat_Types player_stat_type);
 
-        Stat_Table load_all_teams_table();
-        std::vector<Team*> load_all_saved_teams_from_year(uint year);
+        Stat_Table load_all_teams_table(Arena& arena);
+        std::vector<const Team_Definition*> load_all_saved_teams_from_year(uint year);
+        std::vector<std::string> get_saved_team_abbrs_from_year(uint year);
         std::vector<std::string> load_all_real_team_abbrs_from_year(uint year);
 };
\ No newline at end of file
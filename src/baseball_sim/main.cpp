@@ -3,6 +3,14 @@
 #include "baseball_game.hpp"
 #include "probability.hpp"
 #include "user_interface.hpp"
+#include "checkpoint.hpp"
+#include "server.hpp"
+#include "tournament.hpp"
+#include "event_log.hpp"
+#include "expectancy.hpp"
+#include "rollout.hpp"
+#include "player_value.hpp"
+#include "sim_counters.hpp"
 
 #include <iostream>
 #include <iomanip>
@@ -11,98 +19,552 @@
 #include <cstdint>
 #include <time.h>
 #include <chrono>
+#include <thread>
+#include <memory>
 
 
 std::string get_simulation_type();
-void play_series();
-void play_season();
+Simulation_Config get_series_config();
+Simulation_Config get_season_config();
+Simulation_Config get_config_from_command(const Run_Options& options);
+void play_series(const Simulation_Config& config, const Run_Options& options);
+void play_season(const Simulation_Config& config, const Run_Options& options);
+void merge_shards(const std::vector<std::string>& shard_filenames);
+void play_tournament(const Run_Options& options);
+void generate_expectancy_tables(const Run_Options& options);
+void play_rollouts(const Run_Options& options);
+void evaluate_player_values(const Run_Options& options);
+void replay_game(const Run_Options& options);
+void find_game(const Run_Options& options);
+Season load_season(Stat_Loader& loader, uint season_year);
+Series load_series(Stat_Loader& loader, const Simulation_Config& config);
+void print_season_results(Season& season);
+void print_series_results(Series& series);
+void print_recorded_game(const std::string& title, const Recorded_Game& game, const Team_Definition* home_team, const Team_Definition* away_team);
 
-int main() {
+int main(int argc, char* argv[]) {
     debug_print("IN DEBUG MODE\n");
     game_viewer_print("IN VIEWING MODE\n");
     set_up_rand();
 
-    std::string sim_type = get_simulation_type();
+    Run_Options options = parse_run_options(argc, argv);
+    Simulation_Config config;
 
-    if (sim_type == "t") play_series();
-    else if (sim_type == "s") play_season();
+    if (options.command == "merge") {
+        merge_shards(options.command_args);
+        return 0;
+    }
+    else if (options.command == "serve") {
+        std::string socket_path = options.command_args.empty() ? "baseball_sim.sock" : options.command_args[0];
+        uint num_workers = options.num_workers ? options.num_workers : std::thread::hardware_concurrency();
+        run_simulation_server(socket_path, num_workers);
+        return 0;
+    }
+    else if (options.command == "tournament") {
+        play_tournament(options);
+        return 0;
+    }
+    else if (options.command == "expectancy") {
+        generate_expectancy_tables(options);
+        return 0;
+    }
+    else if (options.command == "rollout") {
+        play_rollouts(options);
+        return 0;
+    }
+    else if (options.command == "player-value") {
+        evaluate_player_values(options);
+        return 0;
+    }
+    else if (options.command == "replay") {
+        replay_game(options);
+        return 0;
+    }
+    else if (options.command == "find-game") {
+        find_game(options);
+        return 0;
+    }
+    else if (options.command == "check-sampling") {
+        uint64_t num_draws = options.command_args.empty() ? 10000000 : std::stoull(options.command_args[0]);
+        return run_sampling_check(num_draws) ? 0 : 1;
+    }
+    else if ((options.command == "decode-events") && (options.command_args.size() == 1)) {
+        print_event_log(options.command_args[0]);
+        return 0;
+    }
+    else if (options.command == "compile-stats") {
+        Stat_Loader loader;
+        loader.compile_stat_database();
+        return 0;
+    }
+    else if (!options.resume_filename.empty()) {
+        config = read_checkpoint_config(options.resume_filename);
+        options.checkpoint_filename = options.resume_filename;
+        std::cout << "Resuming run from " << options.resume_filename << "\n";
+    }
+    else {
+        if (!options.command.empty()) {
+            config = get_config_from_command(options);
+        }
+        else {
+            std::string sim_type = get_simulation_type();
+            config = (sim_type == "t") ? get_series_config() : get_season_config();
+        }
+        config.seed = options.has_seed ? options.seed : time(NULL);
+        config.first_sim = options.first_sim;
+    }
+
+    install_interrupt_handler();
+    if (config.sim_type == SIM_SERIES) play_series(config, options);
+    else play_season(config, options);
 
     return 0;
 }
 
 
-void play_season() {
-    Stat_Loader loader;
+Simulation_Config get_season_config() {
+    Simulation_Config config;
+    config.sim_type = SIM_SEASON;
+    config.season_year = get_user_input<uint>("Input season to simulate: ");
+    config.num_sims = get_user_input<uint>("Input number of times to simulate season: ");
+    return config;
+}
+
+
+Simulation_Config get_series_config() {
+    Simulation_Config config;
+    config.sim_type = SIM_SERIES;
+    config.team_abbrs[HOME_TEAM] = get_user_input<std::string>("Input Home Team Abbreviation (Ex: NYY or LAD): ");
+    config.team_years[HOME_TEAM] = get_user_input<uint>("Input Home Team Year (Ex: 1924 or 2024): ");
+    config.team_abbrs[AWAY_TEAM] = get_user_input<std::string>("Input Away Team Abbreviation (Ex: NYY or LAD): ");
+    config.team_years[AWAY_TEAM] = get_user_input<uint>("Input Away Team Year (Ex: 1924 or 2024): ");
+    config.games_in_series = get_user_input<uint>("Input number of games in the series (ex: the world series is a 7 game series): ");
+    config.num_sims = get_user_input<uint>("Input number of times to simulate series: ");
+    return config;
+}
+
 
-    uint season_year = get_user_input<uint>("Input season to simulate: ");
-    uint season_sims = get_user_input<uint>("Input number of times to simulate season: ");
+// Lets batch jobs describe the whole run on the command line instead of answering prompts
+Simulation_Config get_config_from_command(const Run_Options& options) {
+    Simulation_Config config;
+    const std::vector<std::string>& args = options.command_args;
 
+    if ((options.command == "season") && (args.size() == 2)) {
+        config.sim_type = SIM_SEASON;
+        config.season_year = std::stoul(args[0]);
+        config.num_sims = std::stoul(args[1]);
+    }
+    else if ((options.command == "series") && (args.size() == 6)) {
+        config.sim_type = SIM_SERIES;
+        config.team_abbrs[HOME_TEAM] = args[0];
+        config.team_years[HOME_TEAM] = std::stoul(args[1]);
+        config.team_abbrs[AWAY_TEAM] = args[2];
+        config.team_years[AWAY_TEAM] = std::stoul(args[3]);
+        config.games_in_series = std::stoul(args[4]);
+        config.num_sims = std::stoul(args[5]);
+    }
+    else {
+        std::cerr << "Usage: simulation.exe season YEAR SIMS\n"
+                  << "       simulation.exe series HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAMES SIMS\n"
+                  << "       simulation.exe merge SHARD_FILE...\n"
+                  << "       simulation.exe serve [SOCKET_PATH] [--workers N]\n"
+                  << "       simulation.exe tournament GAMES SIMS TEAM YEAR TEAM YEAR [TEAM YEAR]... [--workers N]\n"
+                  << "       simulation.exe expectancy YEAR SIMS [OUTPUT_DIR] [--workers N]\n"
+                  << "       simulation.exe rollout HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR INNING top|bottom OUTS BASES AWAY_SCORE HOME_SCORE [ROLLOUTS] [--workers N]\n"
+                  << "       simulation.exe player-value TEAM YEAR SIMS [--workers N]\n"
+                  << "       simulation.exe replay HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAME_CODE\n"
+                  << "       simulation.exe find-game season YEAR SIM GAME --seed N\n"
+                  << "       simulation.exe find-game series HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAMES SIM GAME --seed N\n"
+                  << "       simulation.exe check-sampling [DRAWS]\n"
+                  << "       simulation.exe compile-stats\n"
+                  << "       simulation.exe decode-events EVENT_LOG_FILE\n";
+        throw std::exception();
+    }
+    return config;
+}
+
+
+Season load_season(Stat_Loader& loader, uint season_year) {
     std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
-    
+
     std::cout << "Loading " << season_year << " Season, could take up to a minute...\n";
     Season season = loader.load_season(season_year);
 
     float load_duration = (std::chrono::steady_clock::now() - load_start).count()/(1e+9);
     std::cout << "Data loaded in " << load_duration << " seconds\n\n";
+    return season;
+}
+
+
+Series load_series(Stat_Loader& loader, const Simulation_Config& config) {
+    std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+    loader.check_team_files({{config.team_abbrs[HOME_TEAM], config.team_years[HOME_TEAM]}, {config.team_abbrs[AWAY_TEAM], config.team_years[AWAY_TEAM]}});
+    const Team_Definition* home_team = loader.load_team(config.team_abbrs[HOME_TEAM], config.team_years[HOME_TEAM]);
+    const Team_Definition* away_team = loader.load_team(config.team_abbrs[AWAY_TEAM], config.team_years[AWAY_TEAM]);
+
+    loader.load_league_year_stats(config.team_years[HOME_TEAM]);
+    loader.load_league_year_stats(config.team_years[AWAY_TEAM]);
+
+    Series series(home_team, away_team, config.games_in_series, config.num_sims);
+
+    float load_duration = (std::chrono::steady_clock::now() - load_start).count()/(1e+9);
+    std::cout << "Data loaded in " << load_duration << " seconds\n\n";
+    return series;
+}
+
+
+void play_season(const Simulation_Config& config, const Run_Options& options) {
+    Stat_Loader loader;
+    Season season = load_season(loader, config.season_year);
+
+    if (!options.resume_filename.empty()) {
+        merge_checkpoint(options.resume_filename, season);
+        std::cout << season.sims_completed << " of " << config.num_sims << " simulations were already completed\n";
+    }
+    Checkpointer checkpointer(options.checkpoint_filename, config, options.checkpoint_interval);
+
+    std::unique_ptr<Event_Log> event_log;
+    if (!options.event_log_filename.empty()) {
+        event_log = std::make_unique<Event_Log>(options.event_log_filename, season.teams);
+        season.event_sink = event_log.get();
+    }
 
     std::chrono::steady_clock::time_point sim_start = std::chrono::steady_clock::now();
 
-    std::cout << "Simulating " << season_year << " season " << season_sims << " times...";
-    std::vector<Team*> final_standings = season.run_games(season_sims);
+    std::cout << "Simulating " << config.season_year << " season " << config.num_sims << " times..." << std::flush;
+    season.run_games(config.num_sims, config.seed, config.first_sim, &checkpointer);
+    if (event_log) event_log->close();
 
     float sim_duration = (std::chrono::steady_clock::now() - sim_start).count()/(1e+9);
     std::cout << " Completed in " << sim_duration << " seconds\n\n";
+    if (simulation_interrupted()) {
+        std::cout << "Interrupted after " << season.sims_completed << " simulations, run with --resume " << options.checkpoint_filename << " to continue.\n";
+        std::cout << "PARTIAL RESULTS:\n";
+    }
+
+    print_season_results(season);
+}
+
+
+void print_season_results(Season& season) {
+    std::vector<uint> final_standings = season.get_standings();
+    const uint season_sims = season.sims_completed ? season.sims_completed : 1;
 
     std::cout << "FINAL STANDINGS:\n";
     std::cout << "RANK\tTEAM\tW-L\t\tR-RA\n";
     float total_runs = 0;
     for (size_t i = 0; i < final_standings.size(); i++) {
-        float wins = (float)final_standings[i]->running_stats.wins / season_sims;
-        float losses = (float)final_standings[i]->running_stats.losses / season_sims;
-        float runs_scored = (float)final_standings[i]->running_stats.runs_scored / (season_sims*final_standings[i]->team_stats[TEAM_SCHEDULE].size());
-        float runs_allowed = (float)final_standings[i]->running_stats.runs_allowed / (season_sims*final_standings[i]->team_stats[TEAM_SCHEDULE].size());
+        const Team_Definition* team = season.teams[final_standings[i]];
+        const Team_Running_Stat_Container& results = season.team_results[final_standings[i]];
+        float wins = (float)results.wins / season_sims;
+        float losses = (float)results.losses / season_sims;
+        float runs_scored = (float)results.runs_scored / (season_sims*team->team_stats[TEAM_SCHEDULE].size());
+        float runs_allowed = (float)results.runs_allowed / (season_sims*team->team_stats[TEAM_SCHEDULE].size());
         total_runs += runs_scored;
 
-        std::cout << "    " << i+1 << ":\t" << final_standings[i]->team_stats.year_specific_abbreviation << "\t";
+        std::cout << "    " << i+1 << ":\t" << team->team_stats.year_specific_abbreviation << "\t";
         std::cout << std::fixed << std::setprecision(1) << wins << "-" << losses << "\t";
         std::cout << runs_scored << "-" << runs_allowed << "\n";
     }
     std::cout << "AVG:\t\t\t\t" << total_runs/final_standings.size() << "-" << total_runs/final_standings.size() << "\n\n";
-    global_stats.print(season_sims);
+    sim_counters.print(season_sims);
+
+    const Recorded_Game& game = season.most_lopsided_game;
+    print_recorded_game("MOST LOPSIDED GAME", game, season.teams[game.home_index], season.teams[game.away_index]);
 }
 
 
-void play_series() {
+void play_series(const Simulation_Config& config, const Run_Options& options) {
     Stat_Loader loader;
+    Series series = load_series(loader, config);
+
+    if (!options.resume_filename.empty()) {
+        merge_checkpoint(options.resume_filename, series);
+        std::cout << series.sims_completed << " of " << config.num_sims << " simulations were already completed\n";
+    }
+    Checkpointer checkpointer(options.checkpoint_filename, config, options.checkpoint_interval);
+
+    std::unique_ptr<Event_Log> event_log;
+    if (!options.event_log_filename.empty()) {
+        event_log = std::make_unique<Event_Log>(options.event_log_filename, std::vector<const Team_Definition*>{series.get_team(AWAY_TEAM), series.get_team(HOME_TEAM)});
+        series.event_sink = event_log.get();
+    }
+
+    std::cout << "Running ~" << config.games_in_series*config.num_sims << " games... " << std::flush;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    series.play(config.seed, config.first_sim, &checkpointer);
+    if (event_log) event_log->close();
+
+    float duration = (std::chrono::steady_clock::now() - begin).count()/(1e+9);
+    std::cout << "Completed in " << duration << " seconds (" << series.total_games_played/duration << " games/s)\n\n";
+    if (simulation_interrupted()) {
+        std::cout << "Interrupted after " << series.sims_completed << " simulations, run with --resume " << options.checkpoint_filename << " to continue.\n";
+        std::cout << "PARTIAL RESULTS:\n";
+    }
+
+    print_series_results(series);
+}
+
+
+void print_series_results(Series& series) {
+    series.print_results();
+    sim_counters.print(series.sims_completed ? series.sims_completed : 1);
+
+    const Recorded_Game& game = series.most_lopsided_game;
+    print_recorded_game("MOST LOPSIDED GAME", game, series.get_team((eTeam)game.home_index), series.get_team((eTeam)game.away_index));
+}
+
+
+// Along with the command that replays the game
+void print_recorded_game(const std::string& title, const Recorded_Game& game, const Team_Definition* home_team, const Team_Definition* away_team) {
+    if (!game.played) return;
+    const Team_Stats& home_stats = home_team->team_stats;
+    const Team_Stats& away_stats = away_team->team_stats;
+    std::cout << "\n" << title << ": " << away_stats.year_specific_abbreviation << " " << game.score[AWAY_TEAM] << " @ "
+              << home_stats.year_specific_abbreviation << " " << game.score[HOME_TEAM] << " (simulation " << game.identity.sim_index
+              << ", game " << game.identity.game_index << ", day " << game.identity.day_of_year << ")\n";
+    std::cout << "Replay it with: simulation.exe replay " << home_stats.main_team_abbreviation << " " << home_stats.year << " "
+              << away_stats.main_team_abbreviation << " " << away_stats.year << " " << game.identity.to_code() << "\n";
+}
 
-    std::string home_team_name = get_user_input<std::string>("Input Home Team Abbreviation (Ex: NYY or LAD): ");
-    uint home_team_year = get_user_input<uint>("Input Home Team Year (Ex: 1924 or 2024): ");
-    std::string away_team_name = get_user_input<std::string>("Input Away Team Abbreviation (Ex: NYY or LAD): ");
-    uint away_team_year = get_user_input<uint>("Input Away Team Year (Ex: 1924 or 2024): ");
-    uint num_games = get_user_input<uint>("Input number of games in the series (ex: the world series is a 7 game series): ");
-    uint num_sims = get_user_input<uint>("Input number of times to simulate series: ");
+
+// Combines the shard files written by processes that each ran part of the same season/series (see --first-sim and --seed),
+// and prints the same report a single process running every simulation would have printed.
+void merge_shards(const std::vector<std::string>& shard_filenames) {
+    Simulation_Config config = check_shards_can_merge(shard_filenames);
+    Stat_Loader loader;
+
+    if (config.sim_type == SIM_SEASON) {
+        Season season = load_season(loader, config.season_year);
+        for (const std::string& filename : shard_filenames) merge_checkpoint(filename, season);
+
+        std::cout << "Merged " << season.sims_completed << " simulations from " << shard_filenames.size() << " shards\n\n";
+        print_season_results(season);
+    }
+    else {
+        Series series = load_series(loader, config);
+        for (const std::string& filename : shard_filenames) merge_checkpoint(filename, series);
+
+        std::cout << "Merged " << series.sims_completed << " simulations from " << shard_filenames.size() << " shards\n\n";
+        print_series_results(series);
+    }
+}
+
+
+// Plays every pair of the listed team-seasons against each other, loading each team and league year only once
+void play_tournament(const Run_Options& options) {
+    const std::vector<std::string>& args = options.command_args;
+    if ((args.size() < 6) || (args.size() % 2 != 0)) {
+        std::cerr << "Usage: simulation.exe tournament GAMES SIMS TEAM YEAR TEAM YEAR [TEAM YEAR]... [--workers N]\n";
+        throw std::exception();
+    }
+    uint games_in_series = std::stoul(args[0]);
+    uint sims_per_series = std::stoul(args[1]);
+    uint64_t seed = options.has_seed ? options.seed : time(NULL);
+    uint num_workers = options.num_workers ? options.num_workers : std::thread::hardware_concurrency();
 
     std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
-    Team* home_team = loader.load_team(home_team_name, home_team_year);
-    Team* away_team = loader.load_team(away_team_name, away_team_year);
+    Stat_Loader loader;
+    std::vector<std::pair<std::string, uint>> team_years;
+    for (size_t i = 2; i < args.size(); i += 2) {
+        team_years.push_back({args[i], std::stoul(args[i + 1])});
+    }
+    loader.check_team_files(team_years);
+
+    std::vector<const Team_Definition*> teams;
+    for (auto const& [team_abbr, year] : team_years) {
+        loader.load_league_year_stats(year);
+        teams.push_back(loader.load_team(team_abbr, year));
+    }
+    float load_duration = (std::chrono::steady_clock::now() - load_start).count()/(1e+9);
+    std::cout << "Data loaded in " << load_duration << " seconds\n\n";
+
+    Tournament tournament(teams, games_in_series, sims_per_series);
+    uint num_pairings = teams.size()*(teams.size() - 1)/2;
+    std::cout << "Simulating " << num_pairings << " pairings " << sims_per_series << " times on " << num_workers << " threads..." << std::flush;
 
-    loader.load_league_year_stats(home_team_year);
-    loader.load_league_year_stats(away_team_year);
+    std::chrono::steady_clock::time_point sim_start = std::chrono::steady_clock::now();
+    tournament.play(seed, num_workers);
+    float sim_duration = (std::chrono::steady_clock::now() - sim_start).count()/(1e+9);
+    std::cout << " Completed in " << sim_duration << " seconds\n\n";
+
+    tournament.print_results();
+}
+
+
+// Simulates a league year's season many times to build its win expectancy and run expectancy tables (see Expectancy_Generator)
+void generate_expectancy_tables(const Run_Options& options) {
+    const std::vector<std::string>& args = options.command_args;
+    if ((args.size() < 2) || (args.size() > 3)) {
+        std::cerr << "Usage: simulation.exe expectancy YEAR SIMS [OUTPUT_DIR] [--workers N]\n";
+        throw std::exception();
+    }
+    uint season_year = std::stoul(args[0]);
+    uint num_sims = std::stoul(args[1]);
+    std::string output_dir = (args.size() == 3) ? args[2] : "expectancy";
+    uint64_t seed = options.has_seed ? options.seed : time(NULL);
+    uint num_workers = options.num_workers ? options.num_workers : std::thread::hardware_concurrency();
+
+    Stat_Loader loader;
+    Season season = load_season(loader, season_year);
+    std::unique_ptr<Expectancy_Generator> generator = std::make_unique<Expectancy_Generator>(season);
+    std::cout << "Simulating the " << season_year << " season " << num_sims << " times on " << num_workers << " threads..." << std::flush;
+
+    std::chrono::steady_clock::time_point sim_start = std::chrono::steady_clock::now();
+    generator->run(num_sims, seed, num_workers);
+    float sim_duration = (std::chrono::steady_clock::now() - sim_start).count()/(1e+9);
+    std::cout << " Completed in " << sim_duration << " seconds\n\n";
 
-    Series series(home_team, away_team, num_games, num_sims);
+    generator->print_summary();
+    generator->write_csv_files(output_dir);
+}
+
+
+/* Plays out the rest of a game from the given inning, outs, bases (ex: 1_3 for runners on first and third) and score, with each team's
+lineup and starting pitcher as they would be at the start of the game. The team at bat has the top of its order up, and its runners
+are the batters right before. */
+void play_rollouts(const Run_Options& options) {
+    const std::vector<std::string>& args = options.command_args;
+    if ((args.size() < 10) || (args.size() > 11) || ((args[5] != "top") && (args[5] != "bottom")) || (args[7].size() != 3)) {
+        std::cerr << "Usage: simulation.exe rollout HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR INNING top|bottom OUTS BASES AWAY_SCORE HOME_SCORE [ROLLOUTS] [--workers N]\n";
+        throw std::exception();
+    }
+    std::string team_abbrs[2];
+    uint team_years[2];
+    team_abbrs[HOME_TEAM] = args[0];
+    team_years[HOME_TEAM] = std::stoul(args[1]);
+    team_abbrs[AWAY_TEAM] = args[2];
+    team_years[AWAY_TEAM] = std::stoul(args[3]);
 
+    int inning = std::stoi(args[4]);
+    if ((inning < 1) || (inning > (int)MAX_SNAPSHOT_HALF_INNINGS/2)) {
+        std::cerr << "The inning has to be from 1 to " << MAX_SNAPSHOT_HALF_INNINGS/2 << "\n";
+        throw std::exception();
+    }
+    Game_Situation situation;
+    situation.half_inning_count = 2*(inning - 1) + ((args[5] == "bottom") ? 1 : 0);
+    situation.half_inning.outs = std::stoul(args[6]);
+    uint8_t runner_slot = 9;
+    for (int base = THIRD_BASE; base >= FIRST_BASE; base--) {
+        if (args[7][base] == '_') continue;
+        situation.half_inning.occupied_bases |= 1 << base;
+        situation.half_inning.runner_batting_slots[base] = --runner_slot;
+    }
+    situation.score[AWAY_TEAM] = std::stoi(args[8]);
+    situation.score[HOME_TEAM] = std::stoi(args[9]);
+    uint num_rollouts = (args.size() == 11) ? std::stoul(args[10]) : 100000;
+    uint64_t seed = options.has_seed ? options.seed : time(NULL);
+    uint num_workers = options.num_workers ? options.num_workers : std::thread::hardware_concurrency();
+
+    std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+    Stat_Loader loader;
+    loader.check_team_files({{team_abbrs[HOME_TEAM], team_years[HOME_TEAM]}, {team_abbrs[AWAY_TEAM], team_years[AWAY_TEAM]}});
+    const Team_Definition* home_team = loader.load_team(team_abbrs[HOME_TEAM], team_years[HOME_TEAM]);
+    const Team_Definition* away_team = loader.load_team(team_abbrs[AWAY_TEAM], team_years[AWAY_TEAM]);
+    loader.load_league_year_stats(team_years[HOME_TEAM]);
+    loader.load_league_year_stats(team_years[AWAY_TEAM]);
     float load_duration = (std::chrono::steady_clock::now() - load_start).count()/(1e+9);
     std::cout << "Data loaded in " << load_duration << " seconds\n\n";
 
-    std::cout << "Running ~" << num_games*num_sims << " games... ";
+    Game_Snapshot snapshot = make_game_snapshot(home_team, away_team, 0, situation, Team_Situation(), Team_Situation());
+    Rollout_Runner rollout_runner(num_workers);
 
-    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point rollout_start = std::chrono::steady_clock::now();
+    Rollout_Result result = rollout_runner.run(snapshot, num_rollouts, seed);
+    float rollout_duration = (std::chrono::steady_clock::now() - rollout_start).count()/(1e+6);
 
-    series.play();
+    std::cout << "Played " << result.num_rollouts << " rollouts on " << num_workers << " threads in " << rollout_duration << " ms\n";
+    std::cout << home_team->team_name << " win probability: " << result.get_home_win_probability() << " (+-" << result.get_standard_error() << ")\n";
+    std::cout << "Average final score: " << away_team->team_name << " " << result.get_average_score(AWAY_TEAM)
+              << " - " << home_team->team_name << " " << result.get_average_score(HOME_TEAM) << "\n";
+}
 
-    float duration = (std::chrono::steady_clock::now() - begin).count()/(1e+9);
-    std::cout << "Completed in " << duration << " seconds (" << series.total_games_played/duration << " games/s)\n\n";
 
-    series.print_results();
-    global_stats.print(num_sims);
-}
\ No newline at end of file
+// Values every player on a team by simulating its season with each of them swapped out for a replacement level player (see Player_Value_Evaluator)
+void evaluate_player_values(const Run_Options& options) {
+    const std::vector<std::string>& args = options.command_args;
+    if (args.size() != 3) {
+        std::cerr << "Usage: simulation.exe player-value TEAM YEAR SIMS [--workers N]\n";
+        throw std::exception();
+    }
+    uint season_year = std::stoul(args[1]);
+    uint num_sims = std::stoul(args[2]);
+    uint64_t seed = options.has_seed ? options.seed : time(NULL);
+    uint num_workers = options.num_workers ? options.num_workers : std::thread::hardware_concurrency();
+
+    Stat_Loader loader;
+    Season season = load_season(loader, season_year);
+    Player_Value_Evaluator evaluator(season, loader.load_team(args[0], season_year));
+    std::cout << "Simulating the " << season_year << " season " << num_sims << " times for every player swap on " << num_workers << " threads..." << std::flush;
+
+    std::chrono::steady_clock::time_point sim_start = std::chrono::steady_clock::now();
+    evaluator.run(num_sims, seed, num_workers);
+    float sim_duration = (std::chrono::steady_clock::now() - sim_start).count()/(1e+9);
+    std::cout << " Completed in " << sim_duration << " seconds\n\n";
+
+    evaluator.print_results();
+}
+
+
+// Plays one game of an earlier run again exactly as it was played, and prints its play by play. The game is picked by its two teams
+// and the code printed with it (see Game_Identity), so only those two teams are loaded. A view build (make view) also shows the game
+// in the game viewer.
+void replay_game(const Run_Options& options) {
+    const std::vector<std::string>& args = options.command_args;
+    if (args.size() != 5) {
+        std::cerr << "Usage: simulation.exe replay HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAME_CODE\n";
+        throw std::exception();
+    }
+    Game_Identity identity = Game_Identity::from_code(args[4]);
+
+    Simulation_Config config;
+    config.team_abbrs[HOME_TEAM] = args[0];
+    config.team_years[HOME_TEAM] = std::stoul(args[1]);
+    config.team_abbrs[AWAY_TEAM] = args[2];
+    config.team_years[AWAY_TEAM] = std::stoul(args[3]);
+    config.games_in_series = 1;
+    config.num_sims = 1;
+
+    Stat_Loader loader;
+    Series series = load_series(loader, config);
+    Game_Printer printer({series.get_team(AWAY_TEAM), series.get_team(HOME_TEAM)});
+    replay_game(identity, series.get_team(HOME_TEAM), series.get_team(AWAY_TEAM), &printer);
+}
+
+
+// Prints the replay command of any game of an earlier run, picked by the arguments that set up the run (without the number of
+// simulations), the simulation's index and the game's index in it, along with the run's seed. A season's teams all have to be
+// loaded for this, since every earlier game of the simulation decides who is rested.
+void find_game(const Run_Options& options) {
+    const std::vector<std::string>& args = options.command_args;
+    bool is_season = !args.empty() && (args[0] == "season") && (args.size() == 4);
+    bool is_series = !args.empty() && (args[0] == "series") && (args.size() == 8);
+    if (!options.has_seed || (!is_season && !is_series)) {
+        std::cerr << "Usage: simulation.exe find-game season YEAR SIM GAME --seed N\n"
+                  << "       simulation.exe find-game series HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAMES SIM GAME --seed N\n";
+        throw std::exception();
+    }
+    uint sim_index = std::stoul(args[args.size() - 2]);
+    uint game_index = std::stoul(args[args.size() - 1]);
+
+    // Set up the run as if it had played up to the game's simulation
+    Run_Options run_options = options;
+    run_options.command = args[0];
+    run_options.command_args.assign(args.begin() + 1, args.end() - 2);
+    run_options.command_args.push_back(std::to_string(sim_index + 1));
+    Simulation_Config config = get_config_from_command(run_options);
+
+    Stat_Loader loader;
+    if (config.sim_type == SIM_SEASON) {
+        Season season = load_season(loader, config.season_year);
+        Recorded_Game game = season.record_game(options.seed, sim_index, game_index);
+        print_recorded_game("GAME", game, season.teams[game.home_index], season.teams[game.away_index]);
+    }
+    else {
+        Series series = load_series(loader, config);
+        Recorded_Game game = series.record_game(options.seed, sim_index, game_index);
+        print_recorded_game("GAME", game, series.get_team((eTeam)game.home_index), series.get_team((eTeam)game.away_index));
+    }
+}
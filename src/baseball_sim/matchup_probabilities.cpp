@@ -0,0 +1,616 @@
+#include "matchup_probabilities.hpp"
+
+#include "includes.hpp"
+#include "probability.hpp"
+#include "statistics.hpp"
+#include "serialization.hpp"
+#include "stat_database.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+//https://sabr.org/journal/article/matchup-probabilities-in-major-league-baseball/
+
+using namespace std;
+
+
+Probability_Store probability_store;
+
+
+// Bump this whenever the file layout or the way any probability is derived changes, so files from older versions get rebuilt
+const uint32_t COMPILED_FILE_VERSION = 2;
+const char COMPILED_FILE_MAGIC[8] = {'B', 'B', 'P', 'R', 'O', 'B', 'S', '\0'};
+const size_t MAX_CACHE_ID_LENGTH = 32;
+
+// Replacement level players (the ones a team can always call up) are modeled as league average players who are this much worse
+// at everything: fewer walks, hits and extra base hits and more strikeouts as batters, and the other way around as pitchers.
+const float REPLACEMENT_LEVEL_FACTOR = .85f;
+
+/* Compiled file layout: the header, one entry per team, one entry per matchup table, then the tables themselves.
+Offsets are from the start of the file. Every section is a multiple of 4 bytes long, so the tables can be read in place. */
+struct Compiled_File_Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_teams;
+    uint64_t content_hash;
+    uint64_t num_matchup_tables;
+};
+
+struct Compiled_Team_Entry {
+    char cache_id[MAX_CACHE_ID_LENGTH];
+    uint32_t num_players;
+    uint32_t num_pitchers;
+    uint32_t num_matchup_rows;
+    uint32_t padding;
+    uint64_t runner_probabilities_offset;
+    uint64_t pitcher_usage_offset;
+};
+
+struct Compiled_Matchup_Entry {
+    uint32_t batting_team; // Index of the team entry
+    uint32_t pitching_team;
+    uint64_t entries_offset;
+};
+
+
+// One player's half of each matchup, in the same shape as Matchup_Probabilities
+struct Player_Rates {
+    float at_bat[NUM_AB_OUTCOMES];
+    float hit_or_out[2];
+    float hit_type[4];
+    bool has_hit_types = true;
+};
+
+
+// Pitchers who bat don't always have batting stats, they are treated like batters without any plate appearances
+static float get_batting_stat(const Player* batter, const string& stat_name, float default_val) {
+    if (!batter->stats.has_stats(PLAYER_BATTING)) return default_val;
+    return batter->stats.get_stat(PLAYER_BATTING, stat_name, default_val);
+}
+
+
+static Player_Rates get_batter_rates(const Player* batter) {
+    Player_Rates rates;
+
+    int batter_plate_appearances = get_batting_stat(batter, "b_pa", .0f);
+    if (batter_plate_appearances == 0) {
+        debug_print(batter->name + " has no batting plate appearances, defaulting to 0...\n");
+        rates.at_bat[OUTCOME_STRIKEOUT] = 1;
+        rates.at_bat[OUTCOME_WALK] = 0;
+    }
+    else {
+        rates.at_bat[OUTCOME_STRIKEOUT] = get_batting_stat(batter, "b_so", .0f)/batter_plate_appearances;
+        rates.at_bat[OUTCOME_WALK] = (get_batting_stat(batter, "b_bb", .0f) + get_batting_stat(batter, "b_hbp", .0f))/batter_plate_appearances;
+    }
+    rates.at_bat[OUTCOME_BALL_IN_PLAY] = 1 - rates.at_bat[OUTCOME_STRIKEOUT] - rates.at_bat[OUTCOME_WALK];
+
+    float batter_balls_in_play = get_batting_stat(batter, "b_pa", .0f) - get_batting_stat(batter, "b_bb", .0f)
+                               - get_batting_stat(batter, "b_hbp", .0f) - get_batting_stat(batter, "b_so", .0f);
+    float batter_hits = get_batting_stat(batter, "b_h", .0f);
+    if (batter_balls_in_play == 0)
+        rates.hit_or_out[0] = 0; // If we have no data for batter, we just assume that the batter is always out so that batters with no baserunning file never get on base
+    else
+        rates.hit_or_out[0] = batter_hits/batter_balls_in_play;
+    rates.hit_or_out[1] = 1 - rates.hit_or_out[0];
+
+    const int batter_total_hits = get_batting_stat(batter, "b_h", 1.f);
+    rates.hit_type[1] = get_batting_stat(batter, "b_doubles", .0f)/batter_total_hits;
+    rates.hit_type[2] = get_batting_stat(batter, "b_triples", .0f)/batter_total_hits;
+    rates.hit_type[3] = get_batting_stat(batter, "b_hr", .0f)/batter_total_hits;
+    rates.hit_type[0] = 1 - rates.hit_type[1] - rates.hit_type[2] - rates.hit_type[3];
+    return rates;
+}
+
+
+// Pitchers without enough data get the league averages of the batting team's league
+static Player_Rates get_pitcher_rates(const Player* pitcher, const League_Constants* league) {
+    Player_Rates rates;
+
+    int pitcher_plate_appearances = pitcher->stats.get_stat(PLAYER_PITCHING, "p_bfp", .0f);
+    if (pitcher_plate_appearances == 0) {
+        debug_print(pitcher->name + " has no pitching plate appearances, defaulting to league avg...\n");
+        rates.at_bat[OUTCOME_STRIKEOUT] = league->at_bat_probs[OUTCOME_STRIKEOUT];
+        rates.at_bat[OUTCOME_WALK] = league->at_bat_probs[OUTCOME_WALK];
+    }
+    else {
+        rates.at_bat[OUTCOME_STRIKEOUT] = pitcher->stats.get_stat(PLAYER_PITCHING, "p_so", .0f)/pitcher_plate_appearances;
+        rates.at_bat[OUTCOME_WALK] = (pitcher->stats.get_stat(PLAYER_PITCHING, "p_bb", .0f) + pitcher->stats.get_stat(PLAYER_PITCHING, "p_hbp", .0f))/pitcher_plate_appearances;
+    }
+    rates.at_bat[OUTCOME_BALL_IN_PLAY] = 1 - rates.at_bat[OUTCOME_STRIKEOUT] - rates.at_bat[OUTCOME_WALK];
+
+    int pitcher_balls_in_play = pitcher->stats.get_stat(PLAYER_PITCHING, "p_bfp", .0f) - pitcher->stats.get_stat(PLAYER_PITCHING, "p_bb", .0f)
+                              - pitcher->stats.get_stat(PLAYER_PITCHING, "p_hbp", .0f) - pitcher->stats.get_stat(PLAYER_PITCHING, "p_so", .0f);
+    float pitcher_hits = pitcher->stats.get_stat(PLAYER_PITCHING, "p_h", .0f);
+    if ((pitcher_balls_in_play == 0) || (pitcher_hits == 0))
+        rates.hit_or_out[0] = league->hit_or_out_probs[0]; // If we have no data for pitcher, we just give them the league avg stats
+    else
+        rates.hit_or_out[0] = pitcher_hits/pitcher_balls_in_play;
+    rates.hit_or_out[1] = 1 - rates.hit_or_out[0];
+
+    // Without batting against stats only the batter decides what kind of hit it is
+    rates.has_hit_types = pitcher->stats.has_stats(PLAYER_BATTING_AGAINST);
+    if (!rates.has_hit_types) {
+        debug_print("No batting_against file available for " + pitcher->name + ", using batter probs only for batter bases advanced...\n");
+        return rates;
+    }
+    const int pitcher_total_hits = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "H", .0f);
+    if (pitcher_total_hits == 0)
+        for (int i = 0; i < 4; i++)
+            rates.hit_type[i] = league->hit_type_probs[i];
+    else {
+        rates.hit_type[1] = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "2B", .0f)/pitcher_total_hits;
+        rates.hit_type[2] = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "3B", .0f)/pitcher_total_hits;
+        rates.hit_type[3] = pitcher->stats.get_stat(PLAYER_BATTING_AGAINST, "HR", .0f)/pitcher_total_hits;
+        rates.hit_type[0] = 1 - rates.hit_type[1] - rates.hit_type[2] - rates.hit_type[3];
+    }
+    return rates;
+}
+
+
+static Player_Rates get_replacement_batter_rates(const League_Constants* league) {
+    Player_Rates rates;
+    rates.at_bat[OUTCOME_STRIKEOUT] = league->at_bat_probs[OUTCOME_STRIKEOUT]/REPLACEMENT_LEVEL_FACTOR;
+    rates.at_bat[OUTCOME_WALK] = league->at_bat_probs[OUTCOME_WALK]*REPLACEMENT_LEVEL_FACTOR;
+    rates.at_bat[OUTCOME_BALL_IN_PLAY] = 1 - rates.at_bat[OUTCOME_STRIKEOUT] - rates.at_bat[OUTCOME_WALK];
+    rates.hit_or_out[0] = league->hit_or_out_probs[0]*REPLACEMENT_LEVEL_FACTOR;
+    rates.hit_or_out[1] = 1 - rates.hit_or_out[0];
+    for (int i = 1; i < 4; i++) rates.hit_type[i] = league->hit_type_probs[i]*REPLACEMENT_LEVEL_FACTOR;
+    rates.hit_type[0] = 1 - rates.hit_type[1] - rates.hit_type[2] - rates.hit_type[3];
+    return rates;
+}
+
+
+static Player_Rates get_replacement_pitcher_rates(const League_Constants* league) {
+    Player_Rates rates;
+    rates.at_bat[OUTCOME_STRIKEOUT] = league->at_bat_probs[OUTCOME_STRIKEOUT]*REPLACEMENT_LEVEL_FACTOR;
+    rates.at_bat[OUTCOME_WALK] = league->at_bat_probs[OUTCOME_WALK]/REPLACEMENT_LEVEL_FACTOR;
+    rates.at_bat[OUTCOME_BALL_IN_PLAY] = 1 - rates.at_bat[OUTCOME_STRIKEOUT] - rates.at_bat[OUTCOME_WALK];
+    rates.hit_or_out[0] = league->hit_or_out_probs[0]/REPLACEMENT_LEVEL_FACTOR;
+    rates.hit_or_out[1] = 1 - rates.hit_or_out[0];
+    for (int i = 1; i < 4; i++) rates.hit_type[i] = league->hit_type_probs[i]/REPLACEMENT_LEVEL_FACTOR;
+    rates.hit_type[0] = 1 - rates.hit_type[1] - rates.hit_type[2] - rates.hit_type[3];
+    return rates;
+}
+
+
+static Matchup_Probabilities combine_rates(const Player_Rates& batter, const Player_Rates& pitcher, const League_Constants* league) {
+    float at_bat[NUM_AB_OUTCOMES];
+    float hit_or_out[2];
+    float hit_type[4];
+    calculate_event_probabilities(batter.at_bat, pitcher.at_bat, league->at_bat_probs, at_bat, NUM_AB_OUTCOMES);
+    calculate_event_probabilities(batter.hit_or_out, pitcher.hit_or_out, league->hit_or_out_probs, hit_or_out, 2);
+    if (pitcher.has_hit_types)
+        calculate_event_probabilities(batter.hit_type, pitcher.hit_type, league->hit_type_probs, hit_type, 4);
+    else
+        copy(batter.hit_type, batter.hit_type + 4, hit_type);
+
+    Matchup_Probabilities result;
+    result.at_bat = Event_Thresholds<NUM_AB_OUTCOMES>(at_bat);
+    result.hit_or_out = Event_Thresholds<2>(hit_or_out);
+    result.hit_type = Event_Thresholds<4>(hit_type);
+    return result;
+}
+
+
+// The runner's half of every base running decision, these only depend on the runner's own stats
+static vector<Runner_Probabilities> derive_runner_probabilities(const Team_Definition* team, const League_Constants* league) {
+    vector<Runner_Probabilities> result(team->all_players.size());
+    if (!team->has_baserunning_stats()) return result;
+
+    for (size_t player_index = 0; player_index < team->all_players.size(); player_index++) {
+        const Player* runner = team->all_players[player_index];
+        Runner_Probabilities& probabilities = result[player_index];
+        if (!runner->stats.has_stats(PLAYER_BASERUNNING)) continue; // These runners never steal or take extra bases
+
+        for (int base = FIRST_BASE; base <= SECOND_BASE; base++) {
+            float sbo_multiplier = league->sbo_on_first_percent;
+            if (base == SECOND_BASE) sbo_multiplier = 1 - sbo_multiplier;
+
+            float runner_sbo = runner->stats.get_stat(PLAYER_BASERUNNING, "SB_opp", .0f)*sbo_multiplier;
+            float runner_steals = runner->stats.get_stat(PLAYER_BASERUNNING, BASE_STEALING_STAT_STRINGS[base][0], .0f);
+            float runner_caught = runner->stats.get_stat(PLAYER_BASERUNNING, BASE_STEALING_STAT_STRINGS[base][1], .0f);
+            if (runner_sbo != 0)
+                probabilities.steal_attempt[base] = (runner_steals + runner_caught)/runner_sbo;
+
+            if (runner_steals + runner_caught == 0)
+                probabilities.steal_success[base] = runner->stats.get_stat(PLAYER_BASERUNNING, "stolen_base_perc", .0f)/100;
+            else
+                probabilities.steal_success[base] = runner_steals/(runner_steals + runner_caught);
+        }
+
+        // Runners on second always score on a double, so they never decide whether to take an extra base
+        for (auto [base, hit_type] : {pair{FIRST_BASE, 0}, pair{FIRST_BASE, 1}, pair{SECOND_BASE, 0}}) {
+            const int times_in_situation = runner->stats.get_stat(PLAYER_BASERUNNING, BASERUNNING_STAT_STRINGS[base][hit_type][0], .0f);
+            if (times_in_situation == 0)
+                probabilities.extra_base[base][hit_type] = runner->stats.get_stat(PLAYER_BASERUNNING, "extra_bases_taken_perc", .0f)/100;
+            else
+                probabilities.extra_base[base][hit_type] = runner->stats.get_stat(PLAYER_BASERUNNING, BASERUNNING_STAT_STRINGS[base][hit_type][1], .0f)/times_in_situation;
+        }
+    }
+    return result;
+}
+
+
+static vector<Pitcher_Usage> derive_pitcher_usage(const Team_Definition* team) {
+    vector<Pitcher_Usage> result(team->pitchers.size());
+    for (size_t i = 0; i < team->pitchers.size(); i++) {
+        const Player* pitcher = team->pitchers[i];
+        if (!pitcher->stats.has_stats(PLAYER_PITCHING)) continue; // Never picked as a starter or a reliever
+        result[i].games_started = pitcher->stats.get_stat(PLAYER_PITCHING, "p_gs", .0f);
+        result[i].games = pitcher->stats.get_stat(PLAYER_PITCHING, "p_g", .0f);
+        result[i].innings_pitched = pitcher->stats.get_stat(PLAYER_PITCHING, "p_ip", .0f);
+    }
+    return result;
+}
+
+
+// Same thresholds should_swap_pitcher used to compare against on every plate appearance. A whole number of runs (or innings) is more
+// than a threshold exactly when it is more than the threshold rounded down.
+static vector<Pitcher_Hook> derive_pitcher_hooks(const Team_Definition* team, const Pitcher_Usage* pitcher_usage) {
+    const League_Constants* league = ALL_LEAGUE_STATS.get_constants(team->team_stats.year);
+    vector<Pitcher_Hook> result(team->pitchers.size());
+    for (size_t i = 0; i < team->pitchers.size(); i++) {
+        float total_games = pitcher_usage[i].games;
+        if (total_games == 0) total_games = 1;
+        result[i].max_runs = floor(league->earned_run_avg + 1);
+        result[i].max_innings = floor(pitcher_usage[i].innings_pitched/total_games + 1);
+    }
+    return result;
+}
+
+
+static vector<Fielding_Games> derive_fielding_games(const Team_Definition* team) {
+    vector<Fielding_Games> result(team->get_num_matchup_rows());
+    for (uint row = 0; row < result.size(); row++) {
+        const Player* batter = team->get_matchup_row_batter(row);
+        if (batter == NULL) continue; // The pitcher's slot, the pitcher's own row is used instead
+        for (int position = 0; position < NUM_DEFENSIVE_POSITIONS; position++) {
+            result[row].games[position] = batter->games_at_fielding_position((eDefensivePositions)position);
+        }
+    }
+    return result;
+}
+
+
+static vector<Matchup_Probabilities> derive_matchup_entries(const Team_Definition* batting_team, const Team_Definition* pitching_team) {
+    const League_Constants* league = ALL_LEAGUE_STATS.get_constants(batting_team->team_stats.year);
+    const size_t num_pitchers = pitching_team->pitchers.size();
+
+    vector<Player_Rates> pitcher_rates;
+    for (const Player* pitcher : pitching_team->pitchers) {
+        pitcher_rates.push_back(get_pitcher_rates(pitcher, league));
+    }
+
+    vector<Matchup_Probabilities> entries(batting_team->get_num_matchup_rows()*num_pitchers);
+    for (uint row = 0; row < batting_team->get_num_matchup_rows(); row++) {
+        const Player* batter = batting_team->get_matchup_row_batter(row);
+        if (batter == NULL) continue; // The pitcher bats here, that is what the pitcher rows are for
+
+        Player_Rates batter_rates = get_batter_rates(batter);
+        for (size_t pitcher_index = 0; pitcher_index < num_pitchers; pitcher_index++) {
+            entries[row*num_pitchers + pitcher_index] = combine_rates(batter_rates, pitcher_rates[pitcher_index], league);
+        }
+    }
+    return entries;
+}
+
+
+vector<Matchup_Probabilities> derive_replacement_matchup_entries(const Team_Definition* batting_team, const Team_Definition* pitching_team, const Player* replaced_player) {
+    const League_Constants* league = ALL_LEAGUE_STATS.get_constants(batting_team->team_stats.year);
+    const size_t num_pitchers = pitching_team->pitchers.size();
+
+    vector<bool> replaced_rows(batting_team->get_num_matchup_rows(), false);
+    for (uint row = 0; row < 9; row++) replaced_rows[row] = batting_team->get_matchup_row_batter(row) == replaced_player;
+    auto replaced_column = find(pitching_team->pitchers.begin(), pitching_team->pitchers.end(), replaced_player);
+    const bool replaces_pitcher = replaced_column != pitching_team->pitchers.end();
+    if (!replaces_pitcher && (find(replaced_rows.begin(), replaced_rows.end(), true) == replaced_rows.end())) return {};
+
+    const Matchup_Table& table = probability_store.get_matchup_table(batting_team, pitching_team);
+    vector<Matchup_Probabilities> entries(table.entries, table.entries + batting_team->get_num_matchup_rows()*num_pitchers);
+
+    vector<Player_Rates> pitcher_rates;
+    for (const Player* pitcher : pitching_team->pitchers) {
+        if (pitcher == replaced_player) pitcher_rates.push_back(get_replacement_pitcher_rates(ALL_LEAGUE_STATS.get_constants(pitching_team->team_stats.year)));
+        else pitcher_rates.push_back(get_pitcher_rates(pitcher, league));
+    }
+    const Player_Rates replacement_batter_rates = get_replacement_batter_rates(ALL_LEAGUE_STATS.get_constants(batting_team->team_stats.year));
+
+    for (uint row = 0; row < batting_team->get_num_matchup_rows(); row++) {
+        const Player* batter = batting_team->get_matchup_row_batter(row);
+        if ((batter == NULL) || (!replaced_rows[row] && !replaces_pitcher)) continue;
+
+        Player_Rates batter_rates = replaced_rows[row] ? replacement_batter_rates : get_batter_rates(batter);
+        if (replaced_rows[row]) {
+            for (size_t pitcher_index = 0; pitcher_index < num_pitchers; pitcher_index++) {
+                entries[row*num_pitchers + pitcher_index] = combine_rates(batter_rates, pitcher_rates[pitcher_index], league);
+            }
+        }
+        else {
+            size_t pitcher_index = replaced_column - pitching_team->pitchers.begin();
+            entries[row*num_pitchers + pitcher_index] = combine_rates(batter_rates, pitcher_rates[pitcher_index], league);
+        }
+    }
+    return entries;
+}
+
+
+const Team_Probability_Tables& Probability_Store::get_team_tables(const Team_Definition* team) {
+    {
+        shared_lock<shared_mutex> lock(store_mutex);
+        auto it = team_tables.find(team->entity_id);
+        if (it != team_tables.end()) return it->second;
+    }
+    return build_team_tables(team);
+}
+
+
+const Matchup_Table& Probability_Store::get_matchup_table(const Team_Definition* batting_team, const Team_Definition* pitching_team) {
+    {
+        shared_lock<shared_mutex> lock(store_mutex);
+        auto it = matchup_tables.find(get_matchup_key(batting_team, pitching_team));
+        if (it != matchup_tables.end()) return it->second;
+    }
+    return build_matchup_table(batting_team, pitching_team);
+}
+
+
+// If another thread built these first, theirs are kept
+const Team_Probability_Tables& Probability_Store::build_team_tables(const Team_Definition* team) {
+    vector<Runner_Probabilities> runner_probabilities = derive_runner_probabilities(team, ALL_LEAGUE_STATS.get_constants(team->team_stats.year));
+    vector<Pitcher_Usage> pitcher_usage = derive_pitcher_usage(team);
+    vector<Pitcher_Hook> pitcher_hooks = derive_pitcher_hooks(team, pitcher_usage.data());
+    vector<Fielding_Games> fielding_games = derive_fielding_games(team);
+
+    unique_lock<shared_mutex> lock(store_mutex);
+    auto [it, inserted] = team_tables.try_emplace(team->entity_id);
+    if (inserted) {
+        Built_Team_Tables& built_tables = built_team_tables[team->entity_id];
+        built_tables.runner_probabilities = move(runner_probabilities);
+        built_tables.pitcher_usage = move(pitcher_usage);
+        it->second.runner_probabilities = built_tables.runner_probabilities.data();
+        it->second.pitcher_usage = built_tables.pitcher_usage.data();
+        add_decision_tables(team->entity_id, it->second, move(pitcher_hooks), move(fielding_games));
+    }
+    return it->second;
+}
+
+
+// Call with store_mutex locked
+void Probability_Store::add_decision_tables(Entity_Id team_id, Team_Probability_Tables& tables, vector<Pitcher_Hook>&& pitcher_hooks, vector<Fielding_Games>&& fielding_games) {
+    Built_Team_Tables& built_tables = built_team_tables[team_id];
+    built_tables.pitcher_hooks = move(pitcher_hooks);
+    built_tables.fielding_games = move(fielding_games);
+    tables.pitcher_hooks = built_tables.pitcher_hooks.data();
+    tables.fielding_games = built_tables.fielding_games.data();
+}
+
+
+const Matchup_Table& Probability_Store::build_matchup_table(const Team_Definition* batting_team, const Team_Definition* pitching_team) {
+    vector<Matchup_Probabilities> entries = derive_matchup_entries(batting_team, pitching_team);
+
+    unique_lock<shared_mutex> lock(store_mutex);
+    auto [it, inserted] = matchup_tables.try_emplace(get_matchup_key(batting_team, pitching_team));
+    if (inserted) {
+        it->second.entries = (built_matchup_entries[it->first] = move(entries)).data();
+        it->second.num_pitchers = pitching_team->pitchers.size();
+    }
+    return it->second;
+}
+
+
+template <class T>
+static const T* get_compiled_section(const Mapped_File& file, uint64_t offset, size_t count) {
+    if ((offset % alignof(T) != 0) || (offset > file.size()) || (count*sizeof(T) > file.size() - offset)) return NULL;
+    return reinterpret_cast<const T*>(file.data() + offset);
+}
+
+
+bool Probability_Store::attach_compiled_file(const string& filename, uint64_t content_hash, const vector<const Team_Definition*>& teams) {
+    if (!filesystem::exists(filename)) return false;
+    unique_ptr<Mapped_File> file = make_unique<Mapped_File>(filename);
+
+    const Compiled_File_Header* header = get_compiled_section<Compiled_File_Header>(*file, 0, 1);
+    if ((header == NULL) || (memcmp(header->magic, COMPILED_FILE_MAGIC, sizeof(COMPILED_FILE_MAGIC)) != 0) || (header->version != COMPILED_FILE_VERSION)
+            || (header->content_hash != content_hash) || (header->num_teams != teams.size())) {
+        return false;
+    }
+
+    // Check everything before adding anything, so a bad file never leaves half of its tables behind
+    const Compiled_Team_Entry* team_entries = get_compiled_section<Compiled_Team_Entry>(*file, sizeof(Compiled_File_Header), header->num_teams);
+    if (team_entries == NULL) return false;
+    for (uint i = 0; i < teams.size(); i++) {
+        const Compiled_Team_Entry& entry = team_entries[i];
+        if ((string(entry.cache_id, strnlen(entry.cache_id, MAX_CACHE_ID_LENGTH)) != teams[i]->team_stats.team_cache_id)
+                || (entry.num_players != teams[i]->all_players.size()) || (entry.num_pitchers != teams[i]->pitchers.size())
+                || (entry.num_matchup_rows != teams[i]->get_num_matchup_rows())
+                || !get_compiled_section<Runner_Probabilities>(*file, entry.runner_probabilities_offset, entry.num_players)
+                || !get_compiled_section<Pitcher_Usage>(*file, entry.pitcher_usage_offset, entry.num_pitchers)) {
+            return false;
+        }
+    }
+
+    const uint64_t matchup_entries_offset = sizeof(Compiled_File_Header) + header->num_teams*sizeof(Compiled_Team_Entry);
+    const Compiled_Matchup_Entry* matchup_entries = get_compiled_section<Compiled_Matchup_Entry>(*file, matchup_entries_offset, header->num_matchup_tables);
+    if (matchup_entries == NULL) return false;
+    for (uint64_t i = 0; i < header->num_matchup_tables; i++) {
+        const Compiled_Matchup_Entry& entry = matchup_entries[i];
+        if ((entry.batting_team >= teams.size()) || (entry.pitching_team >= teams.size())) return false;
+        size_t num_entries = (size_t)team_entries[entry.batting_team].num_matchup_rows*team_entries[entry.pitching_team].num_pitchers;
+        if (!get_compiled_section<Matchup_Probabilities>(*file, entry.entries_offset, num_entries)) return false;
+    }
+
+    vector<vector<Pitcher_Hook>> pitcher_hooks;
+    vector<vector<Fielding_Games>> fielding_games;
+    for (uint i = 0; i < teams.size(); i++) {
+        pitcher_hooks.push_back(derive_pitcher_hooks(teams[i], get_compiled_section<Pitcher_Usage>(*file, team_entries[i].pitcher_usage_offset, team_entries[i].num_pitchers)));
+        fielding_games.push_back(derive_fielding_games(teams[i]));
+    }
+
+    unique_lock<shared_mutex> lock(store_mutex);
+    for (uint i = 0; i < teams.size(); i++) {
+        Team_Probability_Tables tables;
+        tables.runner_probabilities = get_compiled_section<Runner_Probabilities>(*file, team_entries[i].runner_probabilities_offset, team_entries[i].num_players);
+        tables.pitcher_usage = get_compiled_section<Pitcher_Usage>(*file, team_entries[i].pitcher_usage_offset, team_entries[i].num_pitchers);
+        auto [it, inserted] = team_tables.try_emplace(teams[i]->entity_id, tables);
+        if (inserted) add_decision_tables(teams[i]->entity_id, it->second, move(pitcher_hooks[i]), move(fielding_games[i]));
+    }
+    for (uint64_t i = 0; i < header->num_matchup_tables; i++) {
+        const Compiled_Matchup_Entry& entry = matchup_entries[i];
+        Matchup_Table table;
+        table.entries = reinterpret_cast<const Matchup_Probabilities*>(file->data() + entry.entries_offset);
+        table.num_pitchers = team_entries[entry.pitching_team].num_pitchers;
+        matchup_tables.try_emplace(get_matchup_key(teams[entry.batting_team], teams[entry.pitching_team]), table);
+    }
+    Attached_File& attached_file = attached_files.emplace_back();
+    attached_file.file = move(file);
+    for (const Team_Definition* team : teams) attached_file.team_ids.push_back(team->entity_id);
+    return true;
+}
+
+
+void Probability_Store::release_teams(const vector<Entity_Id>& team_ids) {
+    unordered_set<Entity_Id> released_ids(team_ids.begin(), team_ids.end());
+    auto is_released = [&released_ids](Entity_Id id) { return released_ids.count(id) > 0; };
+
+    unique_lock<shared_mutex> lock(store_mutex);
+    for (Entity_Id id : team_ids) {
+        team_tables.erase(id);
+        built_team_tables.erase(id);
+    }
+    for (auto it = matchup_tables.begin(); it != matchup_tables.end();) {
+        if (is_released(it->first >> 32) || is_released((Entity_Id)it->first)) {
+            built_matchup_entries.erase(it->first);
+            it = matchup_tables.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+    attached_files.erase(remove_if(attached_files.begin(), attached_files.end(), [&is_released](const Attached_File& attached_file) {
+        return all_of(attached_file.team_ids.begin(), attached_file.team_ids.end(), is_released);
+    }), attached_files.end());
+}
+
+
+// Tables that are not in the store yet are built first. The file is written next to its final name and then moved
+// into place, so a run that stops halfway never leaves a broken file behind.
+void Probability_Store::write_compiled_file(const string& filename, uint64_t content_hash, const vector<const Team_Definition*>& teams,
+                                            const vector<pair<uint, uint>>& matchup_pairs) {
+    vector<const Team_Probability_Tables*> tables;
+    for (const Team_Definition* team : teams) {
+        if (team->team_stats.team_cache_id.size() > MAX_CACHE_ID_LENGTH) {
+            cerr << "Team cache id " << team->team_stats.team_cache_id << " is too long to be compiled\n";
+            throw exception();
+        }
+        tables.push_back(&get_team_tables(team));
+    }
+    vector<const Matchup_Table*> matchups;
+    for (auto [batting_index, pitching_index] : matchup_pairs) {
+        matchups.push_back(&get_matchup_table(teams[batting_index], teams[pitching_index]));
+    }
+
+    Compiled_File_Header header{};
+    memcpy(header.magic, COMPILED_FILE_MAGIC, sizeof(COMPILED_FILE_MAGIC));
+    header.version = COMPILED_FILE_VERSION;
+    header.num_teams = teams.size();
+    header.content_hash = content_hash;
+    header.num_matchup_tables = matchup_pairs.size();
+
+    uint64_t offset = sizeof(Compiled_File_Header) + teams.size()*sizeof(Compiled_Team_Entry) + matchup_pairs.size()*sizeof(Compiled_Matchup_Entry);
+    vector<Compiled_Team_Entry> team_entries(teams.size());
+    for (uint i = 0; i < teams.size(); i++) {
+        Compiled_Team_Entry& entry = team_entries[i];
+        teams[i]->team_stats.team_cache_id.copy(entry.cache_id, MAX_CACHE_ID_LENGTH);
+        entry.num_players = teams[i]->all_players.size();
+        entry.num_pitchers = teams[i]->pitchers.size();
+        entry.num_matchup_rows = teams[i]->get_num_matchup_rows();
+        entry.runner_probabilities_offset = offset;
+        offset += entry.num_players*sizeof(Runner_Probabilities);
+        entry.pitcher_usage_offset = offset;
+        offset += entry.num_pitchers*sizeof(Pitcher_Usage);
+    }
+    vector<Compiled_Matchup_Entry> matchup_entries(matchup_pairs.size());
+    for (uint i = 0; i < matchup_pairs.size(); i++) {
+        matchup_entries[i].batting_team = matchup_pairs[i].first;
+        matchup_entries[i].pitching_team = matchup_pairs[i].second;
+        matchup_entries[i].entries_offset = offset;
+        offset += (uint64_t)team_entries[matchup_pairs[i].first].num_matchup_rows*team_entries[matchup_pairs[i].second].num_pitchers*sizeof(Matchup_Probabilities);
+    }
+
+    filesystem::create_directories(filesystem::path(filename).parent_path());
+    const string temp_filename = filename + ".tmp";
+    Binary_Writer writer(temp_filename);
+    writer.write(header);
+    writer.write_array(team_entries.data(), team_entries.size());
+    writer.write_array(matchup_entries.data(), matchup_entries.size());
+    for (uint i = 0; i < teams.size(); i++) {
+        writer.write_array(tables[i]->runner_probabilities, team_entries[i].num_players);
+        writer.write_array(tables[i]->pitcher_usage, team_entries[i].num_pitchers);
+    }
+    for (uint i = 0; i < matchups.size(); i++) {
+        writer.write_array(matchups[i]->entries, (size_t)team_entries[matchup_pairs[i].first].num_matchup_rows*matchups[i]->num_pitchers);
+    }
+    writer.close();
+    filesystem::rename(temp_filename, filename);
+}
+
+
+// 64 bit FNV-1a
+static uint64_t hash_bytes(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i])*0x100000001B3ull;
+    }
+    return hash;
+}
+
+
+/* Tables read out of the compiled stat database are hashed by the size and modification time of the CSV file they were compiled
+from, which the database already checked against the file, so only tables that were parsed from their CSV file get read again */
+uint64_t hash_source_files(const vector<const Team_Definition*>& teams) {
+    vector<const Stat_Table*> tables;
+    for (const Team_Definition* team : teams) {
+        for (int i = 0; i < NUM_TEAM_STAT_TYPES; i++) {
+            tables.push_back(&team->team_stats[(eTeam_Stat_Types)i]);
+        }
+        for (const Player* player : team->all_players) {
+            for (int i = 0; i < NUM_PLAYER_STAT_TYPES; i++) {
+                if (player->stats.has_stats((ePlayer_Stat_Types)i)) tables.push_back(&player->stats[(ePlayer_Stat_Types)i]);
+            }
+        }
+        for (int i = 0; i < NUM_LEAGUE_STAT_TYPES; i++) {
+            tables.push_back(&ALL_LEAGUE_STATS[team->team_stats.year][(eLeague_Stat_Types)i]);
+        }
+    }
+    // Stat tables are named after the file they were read from
+    sort(tables.begin(), tables.end(), [](const Stat_Table* a, const Stat_Table* b){return a->stat_table_id < b->stat_table_id;});
+    tables.erase(unique(tables.begin(), tables.end(), [](const Stat_Table* a, const Stat_Table* b){return a->stat_table_id == b->stat_table_id;}), tables.end());
+
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (const Stat_Table* table : tables) {
+        const string& filename = table->stat_table_id;
+        if (filename.empty()) continue; // Stat types that don't exist yet in this year
+        hash = hash_bytes(hash, filename.data(), filename.size() + 1);
+
+        uint64_t source_size;
+        int64_t source_modified_time;
+        if (table->is_compiled() && stat_database.get_source_info(filename, source_size, source_modified_time)) {
+            hash = hash_bytes(hash, reinterpret_cast<const char*>(&source_size), sizeof(source_size));
+            hash = hash_bytes(hash, reinterpret_cast<const char*>(&source_modified_time), sizeof(source_modified_time));
+            continue;
+        }
+        ifstream file(filename, ios::binary);
+        string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        hash = hash_bytes(hash, contents.data(), contents.size());
+    }
+    return hash;
+}
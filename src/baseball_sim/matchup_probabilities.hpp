@@ -0,0 +1,108 @@
+#pragma once
+
+#include "includes.hpp"
+#include "team.hpp"
+#include "registry.hpp"
+#include "serialization.hpp"
+#include "probability.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+
+// The normalized outcome tables of one batter facing one pitcher, which is everything needed to draw a plate appearance
+struct Matchup_Probabilities {
+    Event_Thresholds<NUM_AB_OUTCOMES> at_bat;
+    Event_Thresholds<2> hit_or_out; // Event 0 is hit, event 1 is out
+    Event_Thresholds<4> hit_type; // Single, double, triple, home run
+};
+
+// Every batter of one team (rows, see Team_Definition::get_num_matchup_rows) against every pitcher of another (columns, indexed like team->pitchers)
+struct Matchup_Table {
+    const Matchup_Probabilities* entries = NULL;
+    uint num_pitchers = 0;
+
+    const Matchup_Probabilities& get(uint batter_row, uint pitcher_index) const {
+        return entries[batter_row*num_pitchers + pitcher_index];
+    }
+};
+
+struct Team_Probability_Tables {
+    const Runner_Probabilities* runner_probabilities = NULL; // Indexed like team->all_players
+    const Pitcher_Usage* pitcher_usage = NULL; // Indexed like team->pitchers
+
+    // Derived again in every process, even when the tables above come from a compiled file
+    const Pitcher_Hook* pitcher_hooks = NULL; // Indexed like team->pitchers
+    const Fielding_Games* fielding_games = NULL; // Indexed by matchup row (see Team_Definition::get_num_matchup_rows)
+};
+
+
+/* Every probability that only depends on which players are involved, derived from their stats once per process instead of
+on every plate appearance. A team's (or a pair of teams') tables are built the first time they are asked for, unless they
+were read in place from a compiled file written by an earlier run (see attach_compiled_file).
+Tables are never changed once they are added, so the references handed out stay valid until their teams are released.
+Thread safe. */
+class Probability_Store {
+    public:
+        const Team_Probability_Tables& get_team_tables(const Team_Definition* team);
+        const Matchup_Table& get_matchup_table(const Team_Definition* batting_team, const Team_Definition* pitching_team);
+
+        /* Compiled files hold the tables of a list of teams and of the given (batting, pitching) pairs of them, along with a
+        hash of the source files they were derived from (see hash_source_files). Attaching returns false and adds nothing if
+        the file is missing, or was compiled for other teams, from other data or by another version of the simulator. */
+        bool attach_compiled_file(const std::string& filename, uint64_t content_hash, const std::vector<const Team_Definition*>& teams);
+        void write_compiled_file(const std::string& filename, uint64_t content_hash, const std::vector<const Team_Definition*>& teams,
+                                 const std::vector<std::pair<uint, uint>>& matchup_pairs);
+
+        // Drops the tables of the teams and of every matchup they are in, along with compiled files that only held released
+        // teams (see Stat_Loader::release_year). Nothing may still be using them.
+        void release_teams(const std::vector<Entity_Id>& team_ids);
+
+    private:
+        // What this process derived for a team, the other tables of a team from a compiled file point into its mapping
+        struct Built_Team_Tables {
+            std::vector<Runner_Probabilities> runner_probabilities;
+            std::vector<Pitcher_Usage> pitcher_usage;
+            std::vector<Pitcher_Hook> pitcher_hooks;
+            std::vector<Fielding_Games> fielding_games;
+        };
+
+        struct Attached_File {
+            std::unique_ptr<Mapped_File> file;
+            std::vector<Entity_Id> team_ids;
+        };
+
+        std::unordered_map<Entity_Id, Team_Probability_Tables> team_tables;
+        std::unordered_map<uint64_t, Matchup_Table> matchup_tables; // Keyed by get_matchup_key
+
+        // Tables built by this process live in here (map values never move), tables from compiled files point into their mapping
+        std::unordered_map<Entity_Id, Built_Team_Tables> built_team_tables;
+        std::unordered_map<uint64_t, std::vector<Matchup_Probabilities>> built_matchup_entries; // Keyed by get_matchup_key
+        std::vector<Attached_File> attached_files;
+
+        mutable std::shared_mutex store_mutex;
+
+        const Team_Probability_Tables& build_team_tables(const Team_Definition* team);
+        void add_decision_tables(Entity_Id team_id, Team_Probability_Tables& tables, std::vector<Pitcher_Hook>&& pitcher_hooks, std::vector<Fielding_Games>&& fielding_games);
+        const Matchup_Table& build_matchup_table(const Team_Definition* batting_team, const Team_Definition* pitching_team);
+
+        static uint64_t get_matchup_key(const Team_Definition* batting_team, const Team_Definition* pitching_team) {
+            return ((uint64_t)batting_team->entity_id << 32) | pitching_team->entity_id;
+        }
+};
+
+
+/* Copy of the store's table of batting_team against pitching_team where every entry of the replaced player (the rows they bat in,
+or their column as a pitcher) is derived again from replacement level rates, the rest are copied as they are. Pitchers keep batting
+like themselves in the rows for pitchers who bat. Returns an empty vector if the player doesn't bat or pitch in the table. */
+std::vector<Matchup_Probabilities> derive_replacement_matchup_entries(const Team_Definition* batting_team, const Team_Definition* pitching_team, const Player* replaced_player);
+
+// Hashes every stat file the teams were loaded from (including their league years), by contents or by what the compiled stat database knows about it
+uint64_t hash_source_files(const std::vector<const Team_Definition*>& teams);
+
+extern Probability_Store probability_store;
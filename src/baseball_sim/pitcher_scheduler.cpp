@@ -0,0 +1,152 @@
+#include "pitcher_scheduler.hpp"
+
+#include "includes.hpp"
+#include "team.hpp"
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+
+// The rested heap keeps the highest weight on top, and the lowest index among equal weights
+bool Pitcher_Scheduler::rested_entry_less(const Queue_Entry& a, const Queue_Entry& b) {
+    if (a.key != b.key) return a.key < b.key;
+    return a.role_index > b.role_index;
+}
+
+
+// The resting heap keeps the earliest day on top
+bool Pitcher_Scheduler::resting_entry_less(const Queue_Entry& a, const Queue_Entry& b) {
+    return a.key > b.key;
+}
+
+
+Pitcher_Scheduler::Pitcher_Scheduler(const Pitcher_Usage* pitcher_usage, uint num_pitchers, uint days_in_schedule) :
+    day_of_last_game_pitched(num_pitchers, NEVER_PITCHED),
+    rest_version(num_pitchers, 0)
+{
+    for (int role = 0; role < NUM_PITCHER_ROLES; role++) role_indices[role].assign(num_pitchers, -1);
+
+    for (uint i = 0; i < num_pitchers; i++) {
+        // Usage is truncated to whole games, like it always has been
+        int games_started = pitcher_usage[i].games_started;
+        int games_total = pitcher_usage[i].games;
+        int relief_games = games_total - games_started;
+
+        if (games_started > 0) { // Pitchers who never started are never picked to start
+            role_indices[ROLE_STARTER][i] = roles[ROLE_STARTER].pitchers.size();
+            roles[ROLE_STARTER].pitchers.push_back({i, games_started, min(days_in_schedule/games_started, MAX_PITCHER_COOLDOWN)});
+        }
+        if (relief_games > 0) { // Pitchers who only ever started are saved for starting
+            role_indices[ROLE_RELIEVER][i] = roles[ROLE_RELIEVER].pitchers.size();
+            roles[ROLE_RELIEVER].pitchers.push_back({i, relief_games, min(days_in_schedule/games_total, MAX_PITCHER_COOLDOWN)});
+        }
+    }
+    rebuild_queues(0);
+}
+
+
+// Days of rest wrap around for pitchers who haven't pitched yet (see NEVER_PITCHED), which makes them rested
+bool Pitcher_Scheduler::is_rested(const Role_Pitcher& role_pitcher, uint current_day_of_year) const {
+    return current_day_of_year - day_of_last_game_pitched[role_pitcher.pitcher] >= role_pitcher.cooldown;
+}
+
+
+bool Pitcher_Scheduler::is_stale(const Role_Queues& queues, const Queue_Entry& entry) const {
+    return entry.rest_version != rest_version[queues.pitchers[entry.role_index].pitcher];
+}
+
+
+void Pitcher_Scheduler::queue_pitcher(Role_Queues& queues, uint role_index, uint current_day_of_year) {
+    const Role_Pitcher& role_pitcher = queues.pitchers[role_index];
+    if (is_rested(role_pitcher, current_day_of_year)) {
+        queues.rested.push_back({(uint)role_pitcher.weight, role_index, rest_version[role_pitcher.pitcher]});
+        push_heap(queues.rested.begin(), queues.rested.end(), rested_entry_less);
+    }
+    else {
+        queues.resting.push_back({day_of_last_game_pitched[role_pitcher.pitcher] + role_pitcher.cooldown, role_index, rest_version[role_pitcher.pitcher]});
+        push_heap(queues.resting.begin(), queues.resting.end(), resting_entry_less);
+    }
+}
+
+
+void Pitcher_Scheduler::rebuild_queues(uint current_day_of_year) {
+    for (Role_Queues& queues : roles) {
+        queues.rested.clear();
+        queues.resting.clear();
+        for (uint i = 0; i < queues.pitchers.size(); i++) queue_pitcher(queues, i, current_day_of_year);
+    }
+    latest_day = current_day_of_year;
+}
+
+
+uint Pitcher_Scheduler::pick_rested(ePitcher_Roles role, uint current_day_of_year, const vector<bool>& pitcher_available) {
+    if (current_day_of_year < latest_day) rebuild_queues(current_day_of_year);
+    latest_day = current_day_of_year;
+
+    Role_Queues& queues = roles[role];
+    while (!queues.resting.empty() && (queues.resting.front().key <= current_day_of_year)) {
+        Queue_Entry entry = queues.resting.front();
+        pop_heap(queues.resting.begin(), queues.resting.end(), resting_entry_less);
+        queues.resting.pop_back();
+        if (is_stale(queues, entry)) continue;
+        queues.rested.push_back({(uint)queues.pitchers[entry.role_index].weight, entry.role_index, entry.rest_version});
+        push_heap(queues.rested.begin(), queues.rested.end(), rested_entry_less);
+    }
+
+    // Pitchers who already pitched in this game are set aside and put back afterwards, they have only pitched once the game is over
+    uint new_pitcher = NO_PITCHER;
+    skipped_entries.clear();
+    while (!queues.rested.empty()) {
+        Queue_Entry entry = queues.rested.front();
+        if (!is_stale(queues, entry) && pitcher_available[queues.pitchers[entry.role_index].pitcher]) {
+            new_pitcher = queues.pitchers[entry.role_index].pitcher;
+            break;
+        }
+        pop_heap(queues.rested.begin(), queues.rested.end(), rested_entry_less);
+        queues.rested.pop_back();
+        if (!is_stale(queues, entry)) skipped_entries.push_back(entry);
+    }
+    for (const Queue_Entry& entry : skipped_entries) {
+        queues.rested.push_back(entry);
+        push_heap(queues.rested.begin(), queues.rested.end(), rested_entry_less);
+    }
+    return new_pitcher;
+}
+
+
+uint Pitcher_Scheduler::pick_most_rested(ePitcher_Roles role, uint current_day_of_year, const vector<bool>& pitcher_available, uint fallback) const {
+    uint new_pitcher = fallback;
+    uint most_days_of_rest = 0;
+    for (const Role_Pitcher& role_pitcher : roles[role].pitchers) {
+        if (!pitcher_available[role_pitcher.pitcher]) continue;
+        uint days_of_rest = current_day_of_year - day_of_last_game_pitched[role_pitcher.pitcher];
+        if (days_of_rest >= most_days_of_rest) {
+            most_days_of_rest = days_of_rest;
+            new_pitcher = role_pitcher.pitcher;
+        }
+    }
+    return new_pitcher;
+}
+
+
+void Pitcher_Scheduler::record_game_pitched(uint pitcher, uint day_of_game) {
+    day_of_last_game_pitched[pitcher] = day_of_game;
+    rest_version[pitcher]++;
+    if (day_of_game < latest_day) {
+        rebuild_queues(day_of_game);
+        return;
+    }
+    latest_day = day_of_game;
+    for (int role = 0; role < NUM_PITCHER_ROLES; role++) {
+        if (role_indices[role][pitcher] >= 0) queue_pitcher(roles[role], role_indices[role][pitcher], day_of_game);
+    }
+}
+
+
+void Pitcher_Scheduler::reset() {
+    fill(day_of_last_game_pitched.begin(), day_of_last_game_pitched.end(), NEVER_PITCHED);
+    rebuild_queues(0);
+}
+
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "includes.hpp"
+
+#include <vector>
+#include <cstdint>
+
+
+struct Pitcher_Usage;
+
+enum ePitcher_Roles {
+    ROLE_STARTER,
+    ROLE_RELIEVER,
+    NUM_PITCHER_ROLES
+};
+
+
+/* Keeps track of how rested a team's pitchers are and picks the best rested pitcher for a role without looking at the whole staff.
+Each pitcher who has ever filled a role gets a weight for it (games started for starters, games in relief for relievers) and a
+cooldown (the days in the schedule divided by the games they pitched in that role), worked out once from their Pitcher_Usage.
+Rested pitchers wait in a heap ordered by weight, and pitchers who are resting wait in a heap ordered by the day they are rested
+again, so a pick or a pitcher's rest starting is O(log n). Entries of pitchers who pitched again since they were queued are
+thrown out when they come up.
+Picks are the same as Team_Game_State's old scans of the staff (which debug builds still check every pick against), as long as
+days never go backwards within a simulation. */
+class Pitcher_Scheduler {
+    public:
+        static const uint MAX_PITCHER_COOLDOWN = 15; // days
+        static const uint NO_PITCHER = UINT32_MAX;
+        static const uint NEVER_PITCHED = 1000; // Day of last game pitched for pitchers who haven't pitched in this simulation yet
+
+        Pitcher_Scheduler(){}
+        Pitcher_Scheduler(const Pitcher_Usage* pitcher_usage, uint num_pitchers, uint days_in_schedule);
+
+        // The available rested pitcher with the highest weight for the role (the lowest index on ties), or NO_PITCHER if none are rested
+        uint pick_rested(ePitcher_Roles role, uint current_day_of_year, const std::vector<bool>& pitcher_available);
+        // The available pitcher for the role with the most days of rest (the highest index on ties), or fallback if nobody can fill it.
+        // Only needed when nobody is rested, so this one just scans the role's pitchers.
+        uint pick_most_rested(ePitcher_Roles role, uint current_day_of_year, const std::vector<bool>& pitcher_available, uint fallback) const;
+
+        void record_game_pitched(uint pitcher, uint day_of_game);
+        void reset(); // Every pitcher is rested again, for the start of a new simulation
+
+        uint get_day_of_last_game_pitched(uint pitcher) const {
+            return day_of_last_game_pitched[pitcher];
+        }
+
+    private:
+        struct Role_Pitcher {
+            uint pitcher; // Index in team->pitchers
+            int weight;
+            uint cooldown;
+        };
+
+        struct Queue_Entry {
+            uint key; // Index into the role's pitchers in the rested heap, the day the pitcher is rested again in the resting heap
+            uint role_index;
+            uint rest_version; // The pitcher's rest_version when it was queued, the entry is stale if they have pitched since
+        };
+
+        struct Role_Queues {
+            std::vector<Role_Pitcher> pitchers; // In the order of team->pitchers
+            std::vector<Queue_Entry> rested; // Heap, the highest weight on top
+            std::vector<Queue_Entry> resting; // Heap, the earliest day on top
+        };
+
+        Role_Queues roles[NUM_PITCHER_ROLES];
+        std::vector<int> role_indices[NUM_PITCHER_ROLES]; // Indexed by pitcher, their index in roles[role].pitchers or -1
+        std::vector<uint> day_of_last_game_pitched; // Indexed by pitcher
+        std::vector<uint> rest_version; // Indexed by pitcher, goes up every time they pitch
+        uint latest_day = 0; // The latest day anything was picked or pitched on
+        std::vector<Queue_Entry> skipped_entries; // Scratch space for pick_rested
+
+        static bool rested_entry_less(const Queue_Entry& a, const Queue_Entry& b);
+        static bool resting_entry_less(const Queue_Entry& a, const Queue_Entry& b);
+        bool is_rested(const Role_Pitcher& role_pitcher, uint current_day_of_year) const;
+        void queue_pitcher(Role_Queues& queues, uint role_index, uint current_day_of_year);
+        void rebuild_queues(uint current_day_of_year);
+        bool is_stale(const Role_Queues& queues, const Queue_Entry& entry) const;
+};
@@ -2,33 +2,41 @@
 
 #include "statistics.hpp"
 #include "includes.hpp"
+#include "registry.hpp"
 
 #include <string>
 #include <map>
-#include <unordered_map>
-#include <memory>
 
 
 const std::map<std::string, std::string> POSITION_TO_APPEARANCE_KEY = {{"pitcher", "games_at_p"}, {"catcher", "games_at_c"}, {"1B", "games_at_1b"}, {"2B", "games_at_2b"}, {"3B", "games_at_3b"}, {"SS", "games_at_ss"}, {"LF", "games_at_lf"}, {"CF", "games_at_cf"}, {"RF", "games_at_rf"}, {"DH", "games_at_dh"}};
 
 
+// Player ids (ex: "ruthba01"), interned so that every player gets the same id number no matter which team/year they were loaded for
+extern Entity_Registry<std::string> player_id_registry;
+
+inline Entity_Id intern_player_id(const std::string& player_id) {
+    return player_id_registry.find_or_add(player_id, [&player_id](Entity_Id){return player_id;});
+}
+
+
 class Player {
     
     public:
         std::string name, id;
+        Entity_Id id_number = NO_ENTITY; // Same for this player on every team and in every year
+        Entity_Id entity_id = NO_ENTITY; // This player on this team in this year
         Player_Stats stats;
-        uint day_of_last_game_played;
 
         Player() {}
 
         Player(const std::string& name, const Player_Stats& stats) : stats(stats) {
             this->name = name;
             id = stats.player_id;
-            day_of_last_game_played = 1000;
+            id_number = intern_player_id(id);
         }
 
         int games_at_fielding_position(eDefensivePositions position) const {
-            std::string stat_string = POSITION_TO_APPEARANCE_KEY.at(DEFENSIVE_POSITIONS[position]);
+            const std::string& stat_string = POSITION_TO_APPEARANCE_KEY.at(DEFENSIVE_POSITIONS[position]);
             return stats.get_stat(PLAYER_APPEARANCES, stat_string, .0f);
         }
 
@@ -37,9 +45,19 @@ class Player {
         }
 
         bool operator==(const Player& other) const {
-            return id == other.id;
+            return id_number == other.id_number;
         }
 };
 
 
-extern std::unordered_map<std::string, std::unique_ptr<Player>> player_cache;
\ No newline at end of file
+// Orders player pointers by player id, so that containers of players iterate in the same order on every run.
+// (We compare the id strings rather than the id numbers, which depend on the order that players were loaded in.)
+struct Player_Ptr_Less {
+    bool operator()(const Player* a, const Player* b) const {
+        return *a < *b;
+    }
+};
+
+
+// Every loaded player, keyed by get_player_cache_id. Players and their ids stay valid until their team's year is released.
+extern Entity_Registry<Player> player_registry;
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "player_value.hpp"
+
+#include "includes.hpp"
+#include "probability.hpp"
+#include "baseball_game.hpp"
+#include "worker_pool.hpp"
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+
+Player_Value_Evaluator::Player_Value_Evaluator(const Season& season, const Team_Definition* team) : season(season), team(team) {
+    auto team_it = find(season.teams.begin(), season.teams.end(), team);
+    if (team_it == season.teams.end()) {
+        cerr << team->team_name << " did not play in the " << season.year << " season\n";
+        throw exception();
+    }
+    team_index = team_it - season.teams.begin();
+
+    vector<const Player*> players;
+    for (const Player* batter : team->most_common_batting_order) {
+        if ((batter != NULL) && (find(players.begin(), players.end(), batter) == players.end())) players.push_back(batter);
+    }
+    for (const Player* pitcher : team->pitchers) {
+        // Pitchers without pitching stats are never picked to pitch, so replacing them never changes anything
+        if (pitcher->stats.has_stats(PLAYER_PITCHING) && (find(players.begin(), players.end(), pitcher) == players.end())) players.push_back(pitcher);
+    }
+
+    vector<bool> is_opponent(season.teams.size(), false);
+    for (const Matchup& matchup : season.matchups) {
+        if (matchup.home_index == team_index) is_opponent[matchup.away_index] = true;
+        if (matchup.away_index == team_index) is_opponent[matchup.home_index] = true;
+    }
+
+    players.insert(players.begin(), NULL); // The baseline
+    for (const Player* player : players) {
+        Substitution& substitution = substitutions.emplace_back();
+        substitution.replaced_player = player;
+        substitution.batting_tables.resize(season.teams.size(), NULL);
+        substitution.pitching_tables.resize(season.teams.size(), NULL);
+        for (uint opponent = 0; opponent < season.teams.size(); opponent++) {
+            if (!is_opponent[opponent]) continue;
+            substitution.batting_tables[opponent] = get_substitution_table(team, season.teams[opponent], player);
+            substitution.pitching_tables[opponent] = get_substitution_table(season.teams[opponent], team, player);
+        }
+    }
+}
+
+
+// The store's table, unless the replaced player is in it
+const Matchup_Table* Player_Value_Evaluator::get_substitution_table(const Team_Definition* batting_team, const Team_Definition* pitching_team, const Player* replaced_player) {
+    if (replaced_player == NULL) return &probability_store.get_matchup_table(batting_team, pitching_team);
+    vector<Matchup_Probabilities> entries = derive_replacement_matchup_entries(batting_team, pitching_team, replaced_player);
+    if (entries.empty()) return &probability_store.get_matchup_table(batting_team, pitching_team);
+
+    Matchup_Table& table = replacement_tables.emplace_back();
+    table.entries = replacement_entries.emplace_back(move(entries)).data();
+    table.num_pitchers = pitching_team->pitchers.size();
+    return &table;
+}
+
+
+// The baseline is played first, so every substitution can be compared with it season by season
+void Player_Value_Evaluator::run(uint num_sims, uint64_t seed, uint num_workers) {
+    const vector<Sim_Chunk> chunks = split_into_chunks(num_sims, season.matchups.size());
+    baseline_wins.assign(num_sims, 0);
+    baseline_run_differentials.assign(num_sims, 0);
+    {
+        Worker_Pool worker_pool(num_workers);
+        for (const Sim_Chunk& chunk : chunks) {
+            worker_pool.submit([this, chunk, seed]() {
+                play_seasons(substitutions[0], chunk.first_sim, chunk.num_sims, seed, &baseline_wins[chunk.first_sim], &baseline_run_differentials[chunk.first_sim]);
+            });
+        }
+    }
+
+    Worker_Pool worker_pool(num_workers);
+    for (size_t i = 1; i < substitutions.size(); i++) {
+        for (const Sim_Chunk& chunk : chunks) {
+            worker_pool.submit([this, i, chunk, seed]() {
+                play_substitution(substitutions[i], chunk.first_sim, chunk.num_sims, seed);
+            });
+        }
+    }
+    sims_completed = num_sims;
+}
+
+
+void Player_Value_Evaluator::play_substitution(Substitution& substitution, uint first_sim, uint num_sims, uint64_t seed) {
+    vector<int> wins(num_sims), run_differentials(num_sims);
+    play_seasons(substitution, first_sim, num_sims, seed, wins.data(), run_differentials.data());
+
+    Sample_Sums win_differences, run_differences;
+    for (uint sim = 0; sim < num_sims; sim++) {
+        win_differences.add(baseline_wins[first_sim + sim] - wins[sim]);
+        run_differences.add(baseline_run_differentials[first_sim + sim] - run_differentials[sim]);
+    }
+
+    lock_guard<mutex> lock(results_mutex);
+    substitution.win_differences.merge(win_differences);
+    substitution.run_differences.merge(run_differences);
+}
+
+
+// Plays the whole schedule (the other teams' games decide how rested the team's opponents are), and fills in the team's wins
+// and run differential for every season
+void Player_Value_Evaluator::play_seasons(const Substitution& substitution, uint first_sim, uint num_sims, uint64_t seed, int* wins, int* run_differentials) const {
+    vector<Team_Game_State> team_states = season.team_states;
+    for (uint sim = 0; sim < num_sims; sim++) {
+        for (Team_Game_State& team_state : team_states) team_state.reset_player_tracking_data();
+        wins[sim] = 0;
+        run_differentials[sim] = 0;
+
+        for (uint game = 0; game < season.matchups.size(); game++) {
+            const Matchup& matchup = season.matchups[game];
+            seed_rand_for_game(seed, first_sim + sim, game);
+            Team_Game_State& home_state = team_states[matchup.home_index];
+            Team_Game_State& away_state = team_states[matchup.away_index];
+            home_state.prepare_for_game(matchup.day_of_year, true);
+            away_state.prepare_for_game(matchup.day_of_year, true);
+
+            if ((matchup.home_index != team_index) && (matchup.away_index != team_index)) {
+                Baseball_Game(&home_state, &away_state, matchup.day_of_year).play_game();
+            }
+            else {
+                eTeam team_side = (matchup.home_index == team_index) ? HOME_TEAM : AWAY_TEAM;
+                uint opponent = (team_side == HOME_TEAM) ? matchup.away_index : matchup.home_index;
+                const Matchup_Table* batting_tables[2];
+                batting_tables[team_side] = substitution.batting_tables[opponent];
+                batting_tables[!team_side] = substitution.pitching_tables[opponent];
+
+                Game_Result result = Baseball_Game(&home_state, &away_state, matchup.day_of_year, *batting_tables[HOME_TEAM], *batting_tables[AWAY_TEAM]).play_game();
+                wins[sim] += result.winner == team_side;
+                run_differentials[sim] += result.final_score[team_side] - result.final_score[!team_side];
+            }
+
+            home_state.rest_pitchers_used(matchup.day_of_year);
+            away_state.rest_pitchers_used(matchup.day_of_year);
+        }
+    }
+}
+
+
+vector<Player_Value> Player_Value_Evaluator::get_values() const {
+    vector<Player_Value> values;
+    for (size_t i = 1; i < substitutions.size(); i++) {
+        const Substitution& substitution = substitutions[i];
+        Player_Value& value = values.emplace_back();
+        value.player = substitution.replaced_player;
+        value.bats = find(begin(team->most_common_batting_order), end(team->most_common_batting_order), value.player) != end(team->most_common_batting_order);
+        value.pitches = find(team->pitchers.begin(), team->pitchers.end(), value.player) != team->pitchers.end();
+        if (sims_completed == 0) continue;
+        value.wins = substitution.win_differences.get_mean();
+        value.wins_standard_error = substitution.win_differences.get_standard_error();
+        value.runs = substitution.run_differences.get_mean();
+        value.runs_standard_error = substitution.run_differences.get_standard_error();
+    }
+    stable_sort(values.begin(), values.end(), [](const Player_Value& a, const Player_Value& b){return a.wins > b.wins;});
+    return values;
+}
+
+
+static string format_value(double value, double standard_error) {
+    ostringstream text;
+    text << std::fixed << std::setprecision(2) << value << " +-" << standard_error;
+    return text.str();
+}
+
+
+void Player_Value_Evaluator::print_results() const {
+    double baseline_average_wins = 0;
+    for (int wins : baseline_wins) baseline_average_wins += wins;
+    baseline_average_wins /= max(sims_completed, 1u);
+
+    cout << "PLAYER VALUE FOR " << team->team_name << " (" << sims_completed << " simulated seasons, " << baseline_average_wins << " wins per season):\n";
+    cout << "Runs and wins per season above a replacement level player, +- one standard error\n";
+    cout << left << setw(28) << "Player" << setw(8) << "Role" << setw(20) << "Runs" << "Wins\n";
+    for (const Player_Value& value : get_values()) {
+        string role = value.bats ? (value.pitches ? "B/P" : "B") : "P";
+        cout << setw(28) << value.player->name << setw(8) << role << setw(20) << format_value(value.runs, value.runs_standard_error)
+             << format_value(value.wins, value.wins_standard_error) << "\n";
+    }
+    cout << right << "\n";
+}
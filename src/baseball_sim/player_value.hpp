@@ -0,0 +1,70 @@
+#pragma once
+
+#include "includes.hpp"
+#include "season.hpp"
+#include "matchup_probabilities.hpp"
+#include "sample_sums.hpp"
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+
+// What a player is worth to their team over a season, compared to a replacement level player
+struct Player_Value {
+    const Player* player = NULL;
+    bool bats = false;
+    bool pitches = false;
+    double runs = 0; // Run differential per season
+    double runs_standard_error = 0;
+    double wins = 0; // Wins per season
+    double wins_standard_error = 0;
+};
+
+
+/* Values every player in one team's lineup and pitching staff by simulating the season as it is and once more for each of them
+swapped out for a replacement level player. A swap only derives the swapped player's matchup entries again (see
+derive_replacement_matchup_entries), every other table is shared with the baseline.
+
+Every game of every simulated season gets its own random stream, seeded by the season's and the game's index, so each swap
+plays exactly the same games as the baseline until the swapped player changes something (common random numbers). A player's value
+is the average of the per-season differences with the baseline, and its standard error is that of those differences, which is
+far smaller than the error of comparing two independent runs. Swaps and chunks of seasons all run in parallel. */
+class Player_Value_Evaluator {
+    public:
+        Player_Value_Evaluator(const Season& season, const Team_Definition* team);
+
+        void run(uint num_sims, uint64_t seed, uint num_workers);
+        std::vector<Player_Value> get_values() const; // Best first
+        void print_results() const;
+
+    private:
+        // The team with one player swapped out (or nobody, for the baseline). Tables are indexed like season.teams, and only
+        // set for the teams the team plays.
+        struct Substitution {
+            const Player* replaced_player = NULL;
+            std::vector<const Matchup_Table*> batting_tables; // The team batting against each other team
+            std::vector<const Matchup_Table*> pitching_tables; // Each other team batting against the team
+
+            // Summed over every simulated season, of the baseline's result minus this substitution's
+            Sample_Sums win_differences;
+            Sample_Sums run_differences;
+        };
+
+        const Season& season;
+        const Team_Definition* team;
+        uint team_index;
+        std::vector<Substitution> substitutions; // The baseline comes first
+        std::deque<std::vector<Matchup_Probabilities>> replacement_entries;
+        std::deque<Matchup_Table> replacement_tables;
+
+        std::vector<int> baseline_wins; // Indexed by simulation
+        std::vector<int> baseline_run_differentials;
+        uint sims_completed = 0;
+        std::mutex results_mutex;
+
+        const Matchup_Table* get_substitution_table(const Team_Definition* batting_team, const Team_Definition* pitching_team, const Player* replaced_player);
+        void play_seasons(const Substitution& substitution, uint first_sim, uint num_sims, uint64_t seed, int* wins, int* run_differentials) const;
+        void play_substitution(Substitution& substitution, uint first_sim, uint num_sims, uint64_t seed);
+};
@@ -5,11 +5,32 @@
 #include <random>
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
 
-std::mt19937 rand_gen;
+thread_local Random_Word_Buffer random_words;
 
 void set_up_rand() {
-    rand_gen = std::mt19937(time(NULL));
+    std::seed_seq seed_sequence{(uint32_t)time(NULL)};
+    random_words.seed(seed_sequence);
+}
+
+
+// Every game of a season or series run gets its own random stream (see Season::run_games), so any one game can be replayed on its own
+void seed_rand_for_game(uint64_t seed, uint sim_index, uint game_index) {
+    std::seed_seq seed_sequence{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)sim_index, (uint32_t)game_index};
+    random_words.seed(seed_sequence);
+}
+
+
+// A random stream derived from the run's seed and a simulation's index (ex: a chunk of rollouts), reproducible no matter which
+// thread, process or machine ran the ones before it
+void seed_rand_for_sim(uint64_t seed, uint sim_index) {
+    std::seed_seq seed_sequence{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)sim_index};
+    random_words.seed(seed_sequence);
 }
 
 
@@ -35,7 +56,8 @@ void calculate_event_probabilities(const float x[], const float y[], const float
 }
 
 
-int get_random_event(const float event_probs[], uint num_events) {
+// The original sampler, simulations draw through Event_Thresholds instead. Only run_sampling_check still uses it, to compare against.
+int get_random_event(const float event_probs[], uint num_events, std::mt19937& generator) {
     debug_line(
         float sum = 0;
         for (uint i = 0; i < num_events; sum+=event_probs[i], i++);
@@ -48,5 +70,112 @@ int get_random_event(const float event_probs[], uint num_events) {
     )
 
     std::discrete_distribution<> dist(event_probs, event_probs + num_events);
-    return dist(rand_gen);
-}
\ No newline at end of file
+    return dist(generator);
+}
+
+
+// A lane whose state is all zeros would only ever produce zeros
+void Random_Word_Buffer::seed(std::seed_seq& seed_sequence) {
+    uint32_t seeds[4*NUM_RANDOM_LANES];
+    seed_sequence.generate(seeds, seeds + 4*NUM_RANDOM_LANES);
+    for (uint lane = 0; lane < NUM_RANDOM_LANES; lane++) {
+        for (uint i = 0; i < 4; i++) state[i][lane] = seeds[i*NUM_RANDOM_LANES + lane];
+        if (!(state[0][lane] | state[1][lane] | state[2][lane] | state[3][lane])) state[0][lane] = 1;
+    }
+    position = RANDOM_BUFFER_SIZE;
+}
+
+
+static inline Random_Lanes rotate_left(Random_Lanes x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+
+// One xoshiro128++ step for every lane at once
+void Random_Word_Buffer::refill() {
+    for (uint i = 0; i < RANDOM_BUFFER_SIZE; i += NUM_RANDOM_LANES) {
+        Random_Lanes result = rotate_left(state[0] + state[3], 7) + state[0];
+        Random_Lanes t = state[1] << 9;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotate_left(state[3], 11);
+
+        memcpy(words + i, &result, sizeof(result));
+    }
+    position = 0;
+}
+
+
+// Fills in the num_events - 1 thresholds of an Event_Thresholds
+void make_event_thresholds(const float event_probs[], uint32_t thresholds[], uint num_events) {
+    double total = 0;
+    for (uint i = 0; i < num_events; i++) total += event_probs[i];
+
+    double cumulative = 0;
+    for (uint i = 0; i + 1 < num_events; i++) {
+        cumulative += event_probs[i];
+        double scaled = cumulative/total*4294967296.0;
+        if (!(scaled < 4294967295.0)) thresholds[i] = UINT32_MAX; // Also catches NaN, from tables that are never drawn from
+        else if (scaled <= 0) thresholds[i] = 0;
+        else thresholds[i] = (uint32_t)scaled;
+    }
+}
+
+
+template <uint num_events>
+static bool check_sampling_paths(const float (&event_probs)[num_events], uint64_t num_draws, std::mt19937& generator) {
+    uint64_t float_counts[num_events] = {0};
+    uint64_t threshold_counts[num_events] = {0};
+    Event_Thresholds<num_events> thresholds(event_probs);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < num_draws; i++) float_counts[get_random_event(event_probs, num_events, generator)]++;
+    float float_seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < num_draws; i++) threshold_counts[thresholds.draw()]++;
+    float threshold_seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+    // Both paths have to match the probabilities to within sampling error, and events that can't happen never can
+    bool passed = true;
+    float max_z_score = 0;
+    for (uint i = 0; i < num_events; i++) {
+        double p = event_probs[i];
+        double standard_error = std::sqrt(std::max(p*(1 - p), 1e-12)/num_draws);
+        for (uint64_t count : {float_counts[i], threshold_counts[i]}) {
+            float z_score = std::fabs((double)count/num_draws - p)/standard_error;
+            max_z_score = std::max(max_z_score, z_score);
+            if ((z_score > 5) || ((p == 0) && (count > 0))) passed = false;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(4) << (passed ? "PASS" : "FAIL") << "  probs:";
+    for (uint i = 0; i < num_events; i++) std::cout << " " << event_probs[i];
+    std::cout << "\n      float path:    ";
+    for (uint i = 0; i < num_events; i++) std::cout << " " << (double)float_counts[i]/num_draws;
+    std::cout << std::setprecision(2) << "  (" << float_seconds*1e9/num_draws << " ns/draw)\n" << std::setprecision(4);
+    std::cout << "      threshold path:";
+    for (uint i = 0; i < num_events; i++) std::cout << " " << (double)threshold_counts[i]/num_draws;
+    std::cout << std::setprecision(2) << "  (" << threshold_seconds*1e9/num_draws << " ns/draw)  max z: " << max_z_score << "\n";
+    return passed;
+}
+
+
+bool run_sampling_check(uint64_t num_draws) {
+    std::seed_seq seed_sequence{0u};
+    std::mt19937 generator(seed_sequence);
+    random_words.seed(seed_sequence);
+
+    bool passed = true;
+    passed &= check_sampling_paths({.68f, .09f, .23f}, num_draws, generator); // A typical plate appearance
+    passed &= check_sampling_paths({.3f, .7f}, num_draws, generator);
+    passed &= check_sampling_paths({.65f, .2f, .02f, .13f}, num_draws, generator); // Hit types
+    passed &= check_sampling_paths({1.f, 0.f, 0.f}, num_draws, generator);
+    passed &= check_sampling_paths({0.f, .25f, 0.f, .75f}, num_draws, generator);
+    passed &= check_sampling_paths({.999f, .001f}, num_draws, generator);
+    return passed;
+}
@@ -3,9 +3,66 @@
 #include "includes.hpp"
 
 #include <random>
-
-extern std::mt19937 rand_gen;
+#include <vector>
+#include <cstdint>
 
 void set_up_rand();
+void seed_rand_for_sim(uint64_t seed, uint sim_index);
+void seed_rand_for_game(uint64_t seed, uint sim_index, uint game_index);
 void calculate_event_probabilities(const float x[], const float y[], const float z[], float output[], uint num_events);
-int get_random_event(const float event_probs[], uint num_events);
\ No newline at end of file
+int get_random_event(const float event_probs[], uint num_events, std::mt19937& generator);
+
+
+const uint NUM_RANDOM_LANES = 8;
+const uint RANDOM_BUFFER_SIZE = 512;
+typedef uint32_t Random_Lanes __attribute__((vector_size(NUM_RANDOM_LANES*sizeof(uint32_t))));
+
+/* Per thread supply of raw 32 bit random words for the simulation. Runs NUM_RANDOM_LANES xoshiro128++ generators side by side
+as one SIMD vector and refills the whole buffer at once, so getting a word is almost always just a load.
+Each thread gets its own, so simulations on different threads never share a random stream. Seeding it (see seed_rand_for_game)
+throws away any words left over from before. */
+class Random_Word_Buffer {
+    public:
+        void seed(std::seed_seq& seed_sequence);
+
+        inline uint32_t next() {
+            if (position == RANDOM_BUFFER_SIZE) refill();
+            return words[position++];
+        }
+
+    private:
+        Random_Lanes state[4];
+        uint32_t words[RANDOM_BUFFER_SIZE];
+        uint position = RANDOM_BUFFER_SIZE;
+
+        void refill();
+};
+
+extern thread_local Random_Word_Buffer random_words;
+
+
+void make_event_thresholds(const float event_probs[], uint32_t thresholds[], uint num_events);
+
+/* Probabilities of num_events outcomes, stored as cumulative thresholds on a raw 32 bit random word: event i is drawn when the
+word is not below thresholds[0..i-1] but is below thresholds[i], and the last event gets every word above the final threshold.
+Drawing never converts anything to floating point. Probabilities are normalized like get_random_event does, to within 2^-32. */
+template <uint num_events>
+struct Event_Thresholds {
+    uint32_t thresholds[num_events - 1] = {0};
+
+    Event_Thresholds() {}
+    Event_Thresholds(const float event_probs[num_events]) {
+        make_event_thresholds(event_probs, thresholds, num_events);
+    }
+
+    // Thresholds never decrease, so the event is just the number of thresholds the word is not below
+    inline int draw() const {
+        uint32_t word = random_words.next();
+        int event = 0;
+        for (uint i = 0; i < num_events - 1; i++) event += (word >= thresholds[i]);
+        return event;
+    }
+};
+
+// Draws from both sampling paths and compares them to the probabilities they were given, and to each other's speed
+bool run_sampling_check(uint64_t num_draws);
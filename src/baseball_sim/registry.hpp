@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <cstdint>
+
+
+typedef uint32_t Entity_Id;
+const Entity_Id NO_ENTITY = UINT32_MAX;
+
+
+/* Interns entities under a string key, giving each one a dense integer id (0, 1, 2, ... in the order they were added).
+Keys are only needed at load time, after that entities are referred to by id or by pointer.
+A deque never moves its elements when it grows, so ids and pointers stay valid while other threads keep adding entities.
+Entities are only taken out by remove_if, which frees what they hold but never hands their ids out again, so an id that
+outlives its entity can't end up referring to a different one. All methods are thread safe. */
+template <class Entity>
+class Entity_Registry {
+    public:
+        // Returns NO_ENTITY if nothing was added under this key
+        Entity_Id find_id(const std::string& key) const {
+            std::shared_lock<std::shared_mutex> lock(registry_mutex);
+            auto it = ids.find(key);
+            return (it == ids.end()) ? NO_ENTITY : it->second;
+        }
+
+        // Returns NULL if nothing was added under this key
+        Entity* find(const std::string& key) {
+            std::shared_lock<std::shared_mutex> lock(registry_mutex);
+            auto it = ids.find(key);
+            return (it == ids.end()) ? NULL : &entities[it->second];
+        }
+
+        // If the key is new, make_entity(id) is called to build the entity that gets stored under it.
+        // Otherwise (ex: another thread added it first) the existing entity is kept. Returns the id stored under the key.
+        template <class Entity_Factory>
+        Entity_Id find_or_add(const std::string& key, Entity_Factory make_entity) {
+            std::unique_lock<std::shared_mutex> lock(registry_mutex);
+            auto [it, inserted] = ids.try_emplace(key, (Entity_Id)entities.size());
+            if (inserted) entities.push_back(make_entity(it->second));
+            return it->second;
+        }
+
+        Entity& get(Entity_Id id) {
+            std::shared_lock<std::shared_mutex> lock(registry_mutex);
+            return entities[id];
+        }
+
+        /* Forgets every entity that remove(entity) returns true for: it is reset to an empty Entity and its key can be added
+        again, under a new id. Nothing may still be using the removed entities. */
+        template <class Predicate>
+        void remove_if(Predicate remove) {
+            std::unique_lock<std::shared_mutex> lock(registry_mutex);
+            for (auto it = ids.begin(); it != ids.end();) {
+                if (remove(entities[it->second])) {
+                    entities[it->second] = Entity();
+                    it = ids.erase(it);
+                }
+                else {
+                    it++;
+                }
+            }
+        }
+
+        size_t size() const {
+            std::shared_lock<std::shared_mutex> lock(registry_mutex);
+            return entities.size();
+        }
+
+    private:
+        std::unordered_map<std::string, Entity_Id> ids;
+        std::deque<Entity> entities;
+        mutable std::shared_mutex registry_mutex;
+};
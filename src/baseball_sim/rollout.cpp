@@ -0,0 +1,150 @@
+#include "rollout.hpp"
+
+#include "includes.hpp"
+#include "probability.hpp"
+#include "game_states.hpp"
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+
+const uint ROLLOUTS_PER_CHUNK = 1000;
+
+
+static void check_game_situation(const Game_Situation& situation, const Team_Situation* team_situations[2]) {
+    const Half_Inning_Situation& half_inning = situation.half_inning;
+    if ((half_inning.outs >= 3) || (half_inning.occupied_bases >= NUM_BASE_MASKS)) {
+        cerr << "A half inning in progress needs fewer than 3 outs and a base mask from 0 to " << NUM_BASE_MASKS - 1 << "\n";
+        throw exception();
+    }
+    for (int base = FIRST_BASE; base <= THIRD_BASE; base++) {
+        if ((half_inning.occupied_bases & (1 << base)) && (half_inning.runner_batting_slots[base] >= 9)) {
+            cerr << "The runner on base " << base + 1 << " has batting order slot " << (int)half_inning.runner_batting_slots[base] << ", slots go from 0 to 8\n";
+            throw exception();
+        }
+    }
+    if ((situation.score[HOME_TEAM] < 0) || (situation.score[AWAY_TEAM] < 0)) {
+        cerr << "Scores can't be negative\n";
+        throw exception();
+    }
+    if (situation.half_inning_count >= MAX_SNAPSHOT_HALF_INNINGS) {
+        cerr << "Games can only be picked up before the " << MAX_SNAPSHOT_HALF_INNINGS/2 + 1 << "th inning\n";
+        throw exception();
+    }
+    // The home team never bats (or takes the field for another inning) with the lead once the 9th inning comes around
+    if ((situation.half_inning_count >= MAX_HALF_INNINGS-1) && (situation.score[HOME_TEAM] > situation.score[AWAY_TEAM])) {
+        cerr << "The game would already be over, the home team is ahead in inning " << situation.half_inning_count/2 + 1 << "\n";
+        throw exception();
+    }
+    for (int team = AWAY_TEAM; team <= HOME_TEAM; team++) {
+        if (team_situations[team]->pitcher_starting_half_inning > situation.half_inning_count) {
+            cerr << "A pitcher can't have started pitching after the current half inning\n";
+            throw exception();
+        }
+    }
+}
+
+
+Game_Snapshot make_game_snapshot(const Team_Definition* home_team, const Team_Definition* away_team, uint day_of_year, const Game_Situation& situation,
+                                 const Team_Situation& home_situation, const Team_Situation& away_situation) {
+    const Team_Situation* team_situations[2];
+    team_situations[HOME_TEAM] = &home_situation;
+    team_situations[AWAY_TEAM] = &away_situation;
+    check_game_situation(situation, team_situations);
+
+    Game_Snapshot snapshot;
+    snapshot.day_of_year = day_of_year;
+    snapshot.situation = situation;
+    snapshot.team_states[HOME_TEAM] = Team_Game_State(home_team);
+    snapshot.team_states[AWAY_TEAM] = Team_Game_State(away_team);
+    for (int team = AWAY_TEAM; team <= HOME_TEAM; team++) {
+        Team_Game_State& team_state = snapshot.team_states[team];
+        const Team_Situation& team_situation = *team_situations[team];
+        team_state.prepare_for_game(day_of_year, true);
+
+        vector<uint> pitchers_used = team_situation.pitchers_used;
+        if (pitchers_used.empty()) pitchers_used.push_back(team_state.get_pitcher_index());
+        team_state.resume_game(team_situation.position_in_batting_order, pitchers_used, team_situation.runs_allowed_by_pitcher, team_situation.pitcher_starting_half_inning);
+    }
+    return snapshot;
+}
+
+
+double Rollout_Result::get_home_win_probability() const {
+    return num_rollouts ? (double)home_wins/num_rollouts : 0;
+}
+
+
+double Rollout_Result::get_standard_error() const {
+    double p = get_home_win_probability();
+    return num_rollouts ? sqrt(p*(1 - p)/num_rollouts) : INFINITY;
+}
+
+
+double Rollout_Result::get_average_score(eTeam team) const {
+    return num_rollouts ? (double)runs_scored[team]/num_rollouts : 0;
+}
+
+
+void Rollout_Result::merge(const Rollout_Result& other) {
+    num_rollouts += other.num_rollouts;
+    home_wins += other.home_wins;
+    runs_scored[HOME_TEAM] += other.runs_scored[HOME_TEAM];
+    runs_scored[AWAY_TEAM] += other.runs_scored[AWAY_TEAM];
+}
+
+
+Rollout_Runner::Rollout_Runner(uint num_workers) : worker_pool(num_workers) {}
+
+
+Rollout_Result Rollout_Runner::run(const Game_Snapshot& snapshot, uint num_rollouts, uint64_t seed) {
+    const uint num_chunks = (num_rollouts + ROLLOUTS_PER_CHUNK - 1)/ROLLOUTS_PER_CHUNK;
+    vector<Rollout_Result> chunk_results(num_chunks);
+    uint chunks_left = num_chunks;
+    mutex chunks_mutex;
+    condition_variable chunk_finished;
+
+    for (uint chunk = 0; chunk < num_chunks; chunk++) {
+        uint chunk_rollouts = min(ROLLOUTS_PER_CHUNK, num_rollouts - chunk*ROLLOUTS_PER_CHUNK);
+        worker_pool.submit([&, chunk, chunk_rollouts]() {
+            chunk_results[chunk] = run_chunk(snapshot, chunk_rollouts, seed, chunk);
+            lock_guard<mutex> lock(chunks_mutex);
+            if (--chunks_left == 0) chunk_finished.notify_one();
+        });
+    }
+
+    unique_lock<mutex> lock(chunks_mutex);
+    chunk_finished.wait(lock, [&]{return chunks_left == 0;});
+
+    Rollout_Result result;
+    for (const Rollout_Result& chunk_result : chunk_results) result.merge(chunk_result);
+    return result;
+}
+
+
+Rollout_Result Rollout_Runner::run_chunk(const Game_Snapshot& snapshot, uint num_rollouts, uint64_t seed, uint chunk_index) {
+    seed_rand_for_sim(seed, chunk_index);
+    Team_Game_State team_states[2] = {snapshot.team_states[0], snapshot.team_states[1]};
+    const Baseball_Game chunk_game(&team_states[HOME_TEAM], &team_states[AWAY_TEAM], snapshot.day_of_year, snapshot.situation);
+
+    Rollout_Result result;
+    for (uint i = 0; i < num_rollouts; i++) {
+        // Copy assignment reuses the game states' pitcher vectors, so a rollout never allocates
+        team_states[HOME_TEAM] = snapshot.team_states[HOME_TEAM];
+        team_states[AWAY_TEAM] = snapshot.team_states[AWAY_TEAM];
+        Baseball_Game game = chunk_game; // Already knows its half inning players and matchup tables
+        Game_Result game_result = game.play_game();
+
+        result.num_rollouts++;
+        result.home_wins += game_result.winner == HOME_TEAM;
+        result.runs_scored[HOME_TEAM] += game_result.final_score[HOME_TEAM];
+        result.runs_scored[AWAY_TEAM] += game_result.final_score[AWAY_TEAM];
+    }
+    return result;
+}
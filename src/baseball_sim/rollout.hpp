@@ -0,0 +1,63 @@
+#pragma once
+
+#include "includes.hpp"
+#include "team.hpp"
+#include "baseball_game.hpp"
+#include "worker_pool.hpp"
+
+#include <vector>
+#include <cstdint>
+
+
+// How one team stands in a game in progress
+struct Team_Situation {
+    uint8_t position_in_batting_order = 0; // The slot that is up (for the team at bat) or will lead off its next half inning
+    std::vector<uint> pitchers_used; // Indices in team->pitchers in the order they pitched, the last one is pitching now. Empty keeps the starter the team would pick.
+    uint8_t runs_allowed_by_pitcher = 0;
+    uint8_t pitcher_starting_half_inning = 0;
+};
+
+
+// Snapshots start before this half inning (the 65th inning), so the game's uint8_t half inning count has room to go on through extra innings
+const uint MAX_SNAPSHOT_HALF_INNINGS = 128;
+
+
+// Everything needed to play out the rest of a game, built once by make_game_snapshot and copied for every rollout
+struct Game_Snapshot {
+    uint day_of_year = 0;
+    Game_Situation situation;
+    Team_Game_State team_states[2]; // Indexed by eTeam
+};
+
+// Throws if the situation can't happen (ex: the bottom of the 9th with the home team ahead)
+Game_Snapshot make_game_snapshot(const Team_Definition* home_team, const Team_Definition* away_team, uint day_of_year, const Game_Situation& situation,
+                                 const Team_Situation& home_situation, const Team_Situation& away_situation);
+
+
+struct Rollout_Result {
+    uint num_rollouts = 0;
+    uint home_wins = 0;
+    uint64_t runs_scored[2] = {0, 0}; // Final scores summed over every rollout, indexed by eTeam
+
+    double get_home_win_probability() const;
+    double get_standard_error() const;
+    double get_average_score(eTeam team) const;
+    void merge(const Rollout_Result& other);
+};
+
+
+/* Plays the rest of a game from a snapshot many times over, for in-game decisions (ex: win probability with and without a pitching change).
+Rollouts run in fixed size chunks on the runner's worker pool, which is kept between calls so a request never waits on threads starting.
+Each chunk copies the snapshot's team states into game states it reuses for every rollout, and seeds the random streams by its index, so a
+result only depends on the snapshot, the number of rollouts and the seed. Any number of threads can call run at the same time. */
+class Rollout_Runner {
+    public:
+        Rollout_Runner(uint num_workers);
+
+        Rollout_Result run(const Game_Snapshot& snapshot, uint num_rollouts, uint64_t seed);
+
+    private:
+        Worker_Pool worker_pool;
+
+        static Rollout_Result run_chunk(const Game_Snapshot& snapshot, uint num_rollouts, uint64_t seed, uint chunk_index);
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "includes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+// Running sums of integer samples, for their mean and its standard error. Sums are kept as integers, so sums that are
+// merged in any order (ex: from chunks on a worker pool) add up to exactly the same numbers.
+struct Sample_Sums {
+    uint64_t count = 0;
+    int64_t sum = 0;
+    int64_t squared_sum = 0;
+
+    void add(int64_t sample) {
+        count++;
+        sum += sample;
+        squared_sum += sample*sample;
+    }
+
+    void merge(const Sample_Sums& other) {
+        count += other.count;
+        sum += other.sum;
+        squared_sum += other.squared_sum;
+    }
+
+    double get_mean() const {
+        return count ? (double)sum/count : 0;
+    }
+
+    // Of the mean, shrinks with the square root of the number of samples
+    double get_standard_error() const {
+        if (count < 2) return INFINITY;
+        double mean = get_mean();
+        double variance = std::max(((double)squared_sum - count*mean*mean)/(count - 1), 0.0);
+        return std::sqrt(variance/count);
+    }
+};
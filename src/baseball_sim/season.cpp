@@ -6,88 +6,241 @@
 #include "player.hpp"
 #include "team.hpp"
 #include "baseball_game.hpp"
+#include "checkpoint.hpp"
+#include "serialization.hpp"
+#include "probability.hpp"
+#include "sim_counters.hpp"
 
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <set>
+#include <utility>
+#include <sstream>
+#include <iomanip>
 
 using namespace std;
 
 
-Season::Season(const vector<Team*>& teams, uint year) {
+Season::Season(const vector<const Team_Definition*>& teams, uint year) {
     this->teams = teams;
     this->year = year;
+    for (const Team_Definition* team : teams) team_states.push_back(Team_Game_State(team));
+    team_results.resize(teams.size());
 
     populate_matchups();
 }
 
 
 void Season::populate_matchups() {
-    vector<Team*> loaded_teams;
-    for (Team* team : teams) {
-        const Stat_Table& schedule_table = team->team_stats[TEAM_SCHEDULE];
+    for (uint team_index = 0; team_index < teams.size(); team_index++) {
+        const Stat_Table& schedule_table = teams[team_index]->team_stats[TEAM_SCHEDULE];
         for (size_t i = 0; i < schedule_table.size(); i++) {
             const std::string opponent_abbr = schedule_table.get_stat<string>("opp_ID", i, "");
-            Team* opponent_team = team_cache.at(get_team_cache_id(opponent_abbr, year)).get();
+            const Team_Definition* opponent_team = team_registry.find(get_team_cache_id(opponent_abbr, year));
 
-            if (find(loaded_teams.begin(), loaded_teams.end(), opponent_team) != loaded_teams.end()) {
+            // Each game is in both teams' schedules, so only add it from the team that comes later in the list
+            uint opponent_index = find(teams.begin(), teams.begin() + team_index, opponent_team) - teams.begin();
+            if (opponent_index < team_index) {
                 uint day_of_year = get_day_of_year(schedule_table.get_stat<string>("date_game", i, ""), year);
                 bool is_home_game = schedule_table.get_stat<string>("homeORvis", i, "") == "";
-                Team* home_team = is_home_game? team : opponent_team;
-                Team* away_team = is_home_game? opponent_team : team;
-                matchups.push_back(Matchup(home_team, away_team, day_of_year));
+                uint home_index = is_home_game? team_index : opponent_index;
+                uint away_index = is_home_game? opponent_index : team_index;
+                matchups.push_back(Matchup(teams[home_index], home_index, teams[away_index], away_index, day_of_year));
             }
         }
-        loaded_teams.push_back(team);
     }
 
     sort(matchups.begin(), matchups.end(), [](const Matchup& a, const Matchup& b){return a.day_of_year < b.day_of_year;});
 }
 
 
+// Every (batting, pitching) pair of team indices that face each other at some point in the schedule
+vector<pair<uint, uint>> Season::get_matchup_pairs() const {
+    set<pair<uint, uint>> matchup_pairs;
+    for (const Matchup& matchup : matchups) {
+        matchup_pairs.insert({matchup.home_index, matchup.away_index});
+        matchup_pairs.insert({matchup.away_index, matchup.home_index});
+    }
+    return vector<pair<uint, uint>>(matchup_pairs.begin(), matchup_pairs.end());
+}
+
+
 // Return the teams in order of win %
-vector<Team*> Season::run_games(uint num_season_sims) {
-    for (uint i = 0; i < num_season_sims; i++){
-        for (Matchup& matchup : matchups) {
-            eTeam winner = simulate_matchup(matchup);
-            if (winner == HOME_TEAM) {
-                matchup.home_team->running_stats.wins++;
-                matchup.away_team->running_stats.losses++;
-            }
-            else {
-                matchup.away_team->running_stats.wins++;
-                matchup.home_team->running_stats.losses++;
+// Each game gets its own random stream (seeded by seed, its simulation's index first_sim + i and its index in the schedule), so seasons
+// can be split across any number of processes and merged back together with the same results as one long run, and any one game can be
+// replayed on its own (see replay_game).
+// Picks up from sims_completed, so a season restored from a checkpoint only plays the remaining simulations.
+// If the run is interrupted, the season being played is finished before we stop.
+vector<uint> Season::run_games(uint num_season_sims, uint64_t seed, uint first_sim, Checkpointer* checkpointer) {
+    while ((sims_completed < num_season_sims) && !simulation_interrupted()) {
+        uint sim_index = first_sim + sims_completed;
+        for (Team_Game_State& team_state : team_states) team_state.reset_player_tracking_data();
+
+        for (uint game_index = 0; game_index < matchups.size(); game_index++) {
+            Matchup& matchup = matchups[game_index];
+            seed_rand_for_game(seed, sim_index, game_index);
+            Game_Result result = matchup.play(team_states.data(), team_results.data(), event_sink, sim_index);
+            uint winner_index = (result.winner == HOME_TEAM) ? matchup.home_index : matchup.away_index;
+            uint loser_index = (result.winner == HOME_TEAM) ? matchup.away_index : matchup.home_index;
+            team_results[winner_index].wins++;
+            team_results[loser_index].losses++;
+
+            Recorded_Game game({seed, sim_index, game_index, matchup.day_of_year}, matchup.home_index, matchup.away_index, result);
+            if (game.is_more_lopsided_than(most_lopsided_game)) {
+                game.record_pitcher_rest(team_states[matchup.home_index], team_states[matchup.away_index]);
+                most_lopsided_game = game;
             }
+            matchup.rest_pitchers_used(team_states.data());
 
             game_viewer_line(wait_for_user_input("Press enter to continue to the next game"))
         }
+        sims_completed++;
+        if (checkpointer && checkpointer->is_due()) checkpointer->save(*this);
     }
 
-    vector<Team*> final_standings(teams);
-    sort(final_standings.begin(), final_standings.end(), [](const Team* a, const Team* b){return a->running_stats.wins > b->running_stats.wins;});
+    if (checkpointer) checkpointer->save(*this);
+    return get_standings();
+}
+
+
+// Plays simulation sim_index up to the game, the way run_games played it, to record any game of a run so it can be replayed
+// (run_games only records the most lopsided one). Nothing is added to the season's results.
+Recorded_Game Season::record_game(uint64_t seed, uint sim_index, uint game_index) const {
+    if (game_index >= matchups.size()) {
+        cerr << "The " << year << " season only has " << matchups.size() << " games, there is no game " << game_index << "\n";
+        throw exception();
+    }
+#if BASEBALL_VIEW
+    game_viewer_enabled = false;
+#endif
+    vector<Team_Game_State> sim_team_states = team_states;
+    vector<Team_Running_Stat_Container> sim_team_results(teams.size());
+    for (Team_Game_State& team_state : sim_team_states) team_state.reset_player_tracking_data();
+
+    for (uint i = 0; ; i++) {
+        Matchup matchup = matchups[i];
+        seed_rand_for_game(seed, sim_index, i);
+        Game_Result result = matchup.play(sim_team_states.data(), sim_team_results.data());
+        if (i == game_index) {
+            Recorded_Game game({seed, sim_index, game_index, matchup.day_of_year}, matchup.home_index, matchup.away_index, result);
+            game.record_pitcher_rest(sim_team_states[matchup.home_index], sim_team_states[matchup.away_index]);
+            return game;
+        }
+        matchup.rest_pitchers_used(sim_team_states.data());
+    }
+}
+
+
+// Returns indices into teams (and team_results)
+vector<uint> Season::get_standings() const {
+    vector<uint> final_standings(teams.size());
+    for (uint i = 0; i < teams.size(); i++) final_standings[i] = i;
+    sort(final_standings.begin(), final_standings.end(), [this](uint a, uint b){return team_results[a].wins > team_results[b].wins;});
     return final_standings;
 }
 
 
-eTeam Season::simulate_matchup(Matchup& matchup) {
-    matchup.home_team->prepare_for_game(matchup.day_of_year, true);
-    matchup.away_team->prepare_for_game(matchup.day_of_year, true);
+// Same numbers as the standings printed by play_season, as JSON
+void Season::write_results(Json_Writer& writer) const {
+    const uint season_sims = sims_completed ? sims_completed : 1;
+    writer.begin_array("standings");
+    for (uint team_index : get_standings()) {
+        const Team_Running_Stat_Container& results = team_results[team_index];
+        const float games_per_season = season_sims*teams[team_index]->team_stats[TEAM_SCHEDULE].size();
+        writer.begin_object();
+        writer.add("team", teams[team_index]->team_stats.year_specific_abbreviation);
+        writer.add("wins", (float)results.wins/season_sims);
+        writer.add("losses", (float)results.losses/season_sims);
+        writer.add("runs_scored_per_game", results.runs_scored/games_per_season);
+        writer.add("runs_allowed_per_game", results.runs_allowed/games_per_season);
+        writer.end_object();
+    }
+    writer.end_array();
+}
+
+
+void Season::save_state(Binary_Writer& writer) const {
+    writer.write(sim_counters.get_totals());
+    writer.write(most_lopsided_game);
+    writer.write<uint32_t>(teams.size());
+    for (const Team_Running_Stat_Container& results : team_results) {
+        writer.write(results);
+    }
+    writer.write<uint32_t>(matchups.size());
+    for (const Matchup& matchup : matchups) {
+        matchup.save_state(writer);
+    }
+}
+
+
+// Adds the accumulated results saved by save_state to this season, used both for resuming from checkpoints and merging shards
+void Season::merge_state(Binary_Reader& reader, uint sims_completed) {
+    sim_counters.add_totals(reader.read<Sim_Counter_Totals>());
+    Recorded_Game saved_game = reader.read<Recorded_Game>();
+    if (saved_game.is_more_lopsided_than(most_lopsided_game)) most_lopsided_game = saved_game;
+    if (reader.read<uint32_t>() != teams.size()) {
+        cerr << "Checkpoint does not match the teams loaded for the " << year << " season\n";
+        throw exception();
+    }
+    for (Team_Running_Stat_Container& results : team_results) {
+        results += reader.read<Team_Running_Stat_Container>();
+    }
+    if (reader.read<uint32_t>() != matchups.size()) {
+        cerr << "Checkpoint does not match the schedule loaded for the " << year << " season\n";
+        throw exception();
+    }
+    for (Matchup& matchup : matchups) {
+        matchup.merge_state(reader);
+    }
+    this->sims_completed += sims_completed;
+}
+
+
+Recorded_Game::Recorded_Game(const Game_Identity& identity, uint home_index, uint away_index, const Game_Result& result) {
+    this->identity = identity;
+    played = 1;
+    this->home_index = home_index;
+    this->away_index = away_index;
+    score[HOME_TEAM] = result.final_score[HOME_TEAM];
+    score[AWAY_TEAM] = result.final_score[AWAY_TEAM];
+}
+
 
-    Game_Result result = matchup.play();
-    return result.winner;
+void Recorded_Game::record_pitcher_rest(const Team_Game_State& home_state, const Team_Game_State& away_state) {
+    identity.pitcher_rest[HOME_TEAM] = home_state.get_pitcher_rest(identity.day_of_year);
+    identity.pitcher_rest[AWAY_TEAM] = away_state.get_pitcher_rest(identity.day_of_year);
 }
 
 
-Matchup::Matchup(Team* home_team, Team* away_team, uint day_of_year) {
+uint Recorded_Game::get_margin() const {
+    return (score[HOME_TEAM] > score[AWAY_TEAM]) ? score[HOME_TEAM] - score[AWAY_TEAM] : score[AWAY_TEAM] - score[HOME_TEAM];
+}
+
+
+bool Recorded_Game::is_more_lopsided_than(const Recorded_Game& other) const {
+    if (!played) return false;
+    if (!other.played) return true;
+    if (get_margin() != other.get_margin()) return get_margin() > other.get_margin();
+    if (identity.sim_index != other.identity.sim_index) return identity.sim_index < other.identity.sim_index;
+    return identity.game_index < other.identity.game_index;
+}
+
+
+Matchup::Matchup(const Team_Definition* home_team, uint home_index, const Team_Definition* away_team, uint away_index, uint day_of_year) {
     this->home_team = home_team;
     this->away_team = away_team;
+    this->home_index = home_index;
+    this->away_index = away_index;
     this->day_of_year = day_of_year;
 }
 
 
-Series::Series(Team* home_team, Team* away_team, uint games_in_series, uint num_simulations) {
+Series::Series(const Team_Definition* home_team, const Team_Definition* away_team, uint games_in_series, uint num_simulations) {
     teams[HOME_TEAM] = home_team;
     teams[AWAY_TEAM] = away_team;
+    team_states[HOME_TEAM] = Team_Game_State(home_team);
+    team_states[AWAY_TEAM] = Team_Game_State(away_team);
     this->games_in_series = games_in_series;
     this->num_simulations = num_simulations;
     games_to_clinch = games_in_series/2 + 1;
@@ -109,37 +262,58 @@ void Series::populate_matchups() {
 
 Matchup Series::get_series_matchup(uint current_matchup_index) {
     if (games_in_series < 5) {
-        return Matchup(teams[HOME_TEAM], teams[AWAY_TEAM], current_matchup_index);
+        return Matchup(teams[HOME_TEAM], HOME_TEAM, teams[AWAY_TEAM], AWAY_TEAM, current_matchup_index);
     }
     bool is_home_advantage = (current_matchup_index < 2) || (current_matchup_index >= 2 + games_in_series/2);
-    Team* home_team = is_home_advantage ? teams[HOME_TEAM] : teams[AWAY_TEAM];
-    Team* away_team = is_home_advantage ? teams[AWAY_TEAM] : teams[HOME_TEAM];
+    uint home_index = is_home_advantage ? HOME_TEAM : AWAY_TEAM;
+    uint away_index = is_home_advantage ? AWAY_TEAM : HOME_TEAM;
     uint day = current_matchup_index + ((current_matchup_index >= 2) ? 1 : 0) + ((current_matchup_index >= 2 + games_in_series/2) ? 1 : 0);
-    return Matchup(home_team, away_team, day);
+    return Matchup(teams[home_index], home_index, teams[away_index], away_index, day);
 }
 
 
 // Returns the team that won the series the most often
-eTeam Series::play() {
-    for (uint i = 0; i < num_simulations; i++) {
-        eTeam winner = play_series_once();
+// Like Season::run_games, each game gets its own seeded random stream, and we pick up from sims_completed and stop early (between series) if the run is interrupted.
+eTeam Series::play(uint64_t seed, uint first_sim, Checkpointer* checkpointer) {
+    play_until(num_simulations, seed, first_sim, checkpointer);
+    return (series_won[HOME_TEAM] >= series_won[AWAY_TEAM]) ? HOME_TEAM : AWAY_TEAM; 
+}
+
+
+// Plays simulations until target_sims of them are completed, so a series can be played in chunks (ex: to report progress between them)
+void Series::play_until(uint target_sims, uint64_t seed, uint first_sim, Checkpointer* checkpointer) {
+    target_sims = min(target_sims, num_simulations);
+    while ((sims_completed < target_sims) && !simulation_interrupted()) {
+        team_states[HOME_TEAM].reset_player_tracking_data();
+        team_states[AWAY_TEAM].reset_player_tracking_data();
+        eTeam winner = play_series_once(seed, first_sim + sims_completed);
         series_won[winner]++;
-        teams[HOME_TEAM]->reset_player_tracking_data();
-        teams[AWAY_TEAM]->reset_player_tracking_data();
+
+        sims_completed++;
+        if (checkpointer && checkpointer->is_due()) checkpointer->save(*this);
     }
-    return (series_won[HOME_TEAM] >= series_won[AWAY_TEAM]) ? HOME_TEAM : AWAY_TEAM; 
+
+    if (checkpointer) checkpointer->save(*this);
 }
 
 
-eTeam Series::play_series_once() {
+eTeam Series::play_series_once(uint64_t seed, uint sim_index) {
     uint games_won[2] = {0, 0};
     uint games_played = 0;
 
-    for (Matchup& matchup : matchups) {
-        Game_Result result = matchup.play();
-        Team* winning_team = (result.winner == HOME_TEAM) ? result.home_team : result.away_team;
-        eTeam winner = (winning_team == teams[HOME_TEAM]) ? HOME_TEAM : AWAY_TEAM;
-        
+    for (uint game_index = 0; game_index < matchups.size(); game_index++) {
+        Matchup& matchup = matchups[game_index];
+        seed_rand_for_game(seed, sim_index, game_index);
+        Game_Result result = matchup.play(team_states, team_results, event_sink, sim_index);
+        eTeam winner = (eTeam)((result.winner == HOME_TEAM) ? matchup.home_index : matchup.away_index);
+
+        Recorded_Game game({seed, sim_index, game_index, matchup.day_of_year}, matchup.home_index, matchup.away_index, result);
+        if (game.is_more_lopsided_than(most_lopsided_game)) {
+            game.record_pitcher_rest(team_states[matchup.home_index], team_states[matchup.away_index]);
+            most_lopsided_game = game;
+        }
+        matchup.rest_pitchers_used(team_states);
+
         games_played++;
         games_won[winner]++;
 
@@ -153,7 +327,39 @@ eTeam Series::play_series_once() {
 }
 
 
+// Like Season::record_game. Throws if the series was clinched before the game.
+Recorded_Game Series::record_game(uint64_t seed, uint sim_index, uint game_index) const {
+#if BASEBALL_VIEW
+    game_viewer_enabled = false;
+#endif
+    Team_Game_State sim_team_states[2] = {team_states[AWAY_TEAM], team_states[HOME_TEAM]};
+    Team_Running_Stat_Container sim_team_results[2];
+    sim_team_states[HOME_TEAM].reset_player_tracking_data();
+    sim_team_states[AWAY_TEAM].reset_player_tracking_data();
+
+    uint games_won[2] = {0, 0};
+    for (uint i = 0; i < matchups.size(); i++) {
+        if ((games_won[HOME_TEAM] >= games_to_clinch) || (games_won[AWAY_TEAM] >= games_to_clinch)) break;
+
+        Matchup matchup = matchups[i];
+        seed_rand_for_game(seed, sim_index, i);
+        Game_Result result = matchup.play(sim_team_states, sim_team_results);
+        if (i == game_index) {
+            Recorded_Game game({seed, sim_index, game_index, matchup.day_of_year}, matchup.home_index, matchup.away_index, result);
+            game.record_pitcher_rest(sim_team_states[matchup.home_index], sim_team_states[matchup.away_index]);
+            return game;
+        }
+        matchup.rest_pitchers_used(sim_team_states);
+        games_won[(result.winner == HOME_TEAM) ? matchup.home_index : matchup.away_index]++;
+    }
+
+    cerr << "Series " << sim_index << " was over before game " << game_index << "\n";
+    throw exception();
+}
+
+
 void Series::print_results() {
+    const uint num_simulations = sims_completed ? sims_completed : 1; // Only count simulations that actually finished (the run may have been interrupted)
     for (uint i = 0; i < games_in_series; i++) {
         cout << std::fixed << std::setprecision(1);
         cout << "GAME " << i+1 << " (" << 100.f*matchups[i].times_played/num_simulations << "% played):\n";
@@ -166,10 +372,177 @@ void Series::print_results() {
 }
 
 
+// Same numbers as print_results, as JSON
+void Series::write_results(Json_Writer& writer) const {
+    const uint num_simulations = sims_completed ? sims_completed : 1;
+    writer.begin_array("games");
+    for (const Matchup& matchup : matchups) {
+        writer.begin_object();
+        writer.add("played_percent", 100.f*matchup.times_played/num_simulations);
+        matchup.write_results(writer);
+        writer.end_object();
+    }
+    writer.end_array();
+
+    writer.begin_object("series");
+    for (int i : {HOME_TEAM, AWAY_TEAM}) {
+        writer.begin_object(i == HOME_TEAM ? "home" : "away");
+        writer.add("team", teams[i]->team_name);
+        writer.add("win_percent", (float)series_won[i]/num_simulations);
+        writer.add("games_per_series_won", (float)games_played_in_series_won[i]/(series_won[i] ? series_won[i] : 1));
+        writer.end_object();
+    }
+    writer.end_object();
+}
+
+
+void Series::save_state(Binary_Writer& writer) const {
+    writer.write(sim_counters.get_totals());
+    writer.write(most_lopsided_game);
+    writer.write<uint32_t>(total_games_played);
+    for (int i = 0; i < 2; i++) {
+        writer.write<uint32_t>(series_won[i]);
+        writer.write<uint32_t>(games_played_in_series_won[i]);
+        writer.write(team_results[i]);
+    }
+    for (const Matchup& matchup : matchups) {
+        matchup.save_state(writer);
+    }
+}
+
+
+void Series::merge_state(Binary_Reader& reader, uint sims_completed) {
+    sim_counters.add_totals(reader.read<Sim_Counter_Totals>());
+    Recorded_Game saved_game = reader.read<Recorded_Game>();
+    if (saved_game.is_more_lopsided_than(most_lopsided_game)) most_lopsided_game = saved_game;
+    total_games_played += reader.read<uint32_t>();
+    for (int i = 0; i < 2; i++) {
+        series_won[i] += reader.read<uint32_t>();
+        games_played_in_series_won[i] += reader.read<uint32_t>();
+        team_results[i] += reader.read<Team_Running_Stat_Container>();
+    }
+    for (Matchup& matchup : matchups) {
+        matchup.merge_state(reader);
+    }
+    this->sims_completed += sims_completed;
+}
+
+
+void Matchup::write_results(Json_Writer& writer) const {
+    const uint games = times_played ? times_played : 1;
+    for (int i : {AWAY_TEAM, HOME_TEAM}) {
+        writer.begin_object(i == HOME_TEAM ? "home" : "away");
+        writer.add("team", (i == HOME_TEAM) ? home_team->team_name : away_team->team_name);
+        writer.add("win_percent", (float)games_won[i]/games);
+        writer.add("runs", (float)runs_scored[i]/games);
+        writer.end_object();
+    }
+}
+
+
+void Matchup::save_state(Binary_Writer& writer) const {
+    writer.write<uint32_t>(times_played);
+    for (int i = 0; i < 2; i++) {
+        writer.write<uint32_t>(runs_scored[i]);
+        writer.write<uint32_t>(games_won[i]);
+    }
+}
+
+
+void Matchup::merge_state(Binary_Reader& reader) {
+    times_played += reader.read<uint32_t>();
+    for (int i = 0; i < 2; i++) {
+        runs_scored[i] += reader.read<uint32_t>();
+        games_won[i] += reader.read<uint32_t>();
+    }
+}
+
+
 void Matchup::print_results() {
     cout << std::fixed << std::setprecision(3);
     cout << "\t" << away_team->team_name << "  @\t" << home_team->team_name << "\n";
     cout << "Win%  " << (float)games_won[AWAY_TEAM]/times_played << "\t" << (float)games_won[HOME_TEAM]/times_played << "\n";
     cout << "Runs  " << (float)runs_scored[AWAY_TEAM]/times_played << "\t" << (float)runs_scored[HOME_TEAM]/times_played << "\n";
     cout << "\n";
-}
\ No newline at end of file
+}
+
+
+// A game's random stream only depends on its identity, and pitcher rest is everything the teams carry over from the games before,
+// so the game plays out the same without them
+Game_Result replay_game(const Game_Identity& identity, const Team_Definition* home_team, const Team_Definition* away_team, Game_Event_Sink* replay_sink) {
+    Team_Game_State team_states[2] = {Team_Game_State(away_team), Team_Game_State(home_team)};
+    Team_Running_Stat_Container team_results[2];
+    for (int i : {AWAY_TEAM, HOME_TEAM}) team_states[i].set_pitcher_rest(identity.pitcher_rest[i], identity.day_of_year);
+
+    seed_rand_for_game(identity.seed, identity.sim_index, identity.game_index);
+    Matchup matchup(home_team, HOME_TEAM, away_team, AWAY_TEAM, identity.day_of_year);
+    return matchup.play(team_states, team_results, replay_sink, identity.sim_index);
+}
+
+
+// SEED.SIM.GAME.DAY.HOME_REST.AWAY_REST, where a team's rest is two hex bytes (pitcher, days of rest) per resting pitcher,
+// or "x" if it wasn't recorded
+string Game_Identity::to_code() const {
+    ostringstream code;
+    code << seed << "." << sim_index << "." << game_index << "." << day_of_year;
+    for (int i : {HOME_TEAM, AWAY_TEAM}) {
+        code << ".";
+        const Pitcher_Rest& rest = pitcher_rest[i];
+        if (rest.num_resting == PITCHER_REST_NOT_RECORDED) {
+            code << "x";
+            continue;
+        }
+        code << hex << setfill('0');
+        for (uint j = 0; j < rest.num_resting; j++) code << setw(2) << (int)rest.pitchers[j] << setw(2) << (int)rest.days_of_rest[j];
+        code << dec;
+    }
+    return code.str();
+}
+
+
+static Pitcher_Rest parse_pitcher_rest(const string& rest_code, const string& code) {
+    Pitcher_Rest rest;
+    if (rest_code == "x") {
+        rest.num_resting = PITCHER_REST_NOT_RECORDED;
+        return rest;
+    }
+    if ((rest_code.size() % 4 != 0) || (rest_code.size()/4 > MAX_RESTING_PITCHERS) || (rest_code.find_first_not_of("0123456789abcdef") != string::npos)) {
+        cerr << "Game code " << code << " has a bad pitcher rest: " << rest_code << "\n";
+        throw exception();
+    }
+    for (size_t i = 0; i < rest_code.size(); i += 4) {
+        rest.pitchers[rest.num_resting] = stoul(rest_code.substr(i, 2), NULL, 16);
+        rest.days_of_rest[rest.num_resting] = stoul(rest_code.substr(i + 2, 2), NULL, 16);
+        rest.num_resting++;
+    }
+    return rest;
+}
+
+
+Game_Identity Game_Identity::from_code(const string& code) {
+    vector<string> parts;
+    size_t part_start = 0;
+    while (true) {
+        size_t part_end = code.find('.', part_start);
+        parts.push_back(code.substr(part_start, part_end - part_start));
+        if (part_end == string::npos) break;
+        part_start = part_end + 1;
+    }
+    bool has_numbers = parts.size() == 6;
+    for (size_t i = 0; has_numbers && (i < 4); i++) {
+        has_numbers = (parts[i].size() <= 20) && !parts[i].empty() && (parts[i].find_first_not_of("0123456789") == string::npos);
+    }
+    if (!has_numbers) {
+        cerr << "Bad game code " << code << ", it should look like SEED.SIM.GAME.DAY.HOME_REST.AWAY_REST\n";
+        throw exception();
+    }
+
+    Game_Identity identity;
+    identity.seed = stoull(parts[0]);
+    identity.sim_index = stoul(parts[1]);
+    identity.game_index = stoul(parts[2]);
+    identity.day_of_year = stoul(parts[3]);
+    identity.pitcher_rest[HOME_TEAM] = parse_pitcher_rest(parts[4], code);
+    identity.pitcher_rest[AWAY_TEAM] = parse_pitcher_rest(parts[5], code);
+    return identity;
+}
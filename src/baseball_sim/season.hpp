@@ -3,15 +3,56 @@
 #include "player.hpp"
 #include "team.hpp"
 #include "baseball_game.hpp"
+#include "serialization.hpp"
+#include "json.hpp"
+#include "event_log.hpp"
 
 #include <vector>
 #include <string>
+#include <utility>
+#include <cstdint>
+
+
+/* Where a game falls in a run: the run's seed, the simulation it was played in and its index in that simulation's games (the
+season's or series' matchups), which together seed the game's own random stream (see seed_rand_for_game). With how rested both
+teams' pitchers were coming into it, this is all replay_game needs to play the game again exactly, without the games before it. */
+struct Game_Identity {
+    uint64_t seed = 0;
+    uint32_t sim_index = 0;
+    uint32_t game_index = 0;
+    uint32_t day_of_year = 0;
+    Pitcher_Rest pitcher_rest[2]; // Indexed by eTeam
+
+    // All of the above as one short string (ex: to print a command that replays the game), and back
+    std::string to_code() const;
+    static Game_Identity from_code(const std::string& code);
+};
+
+
+// A game worth looking at again with the replay command, kept with the results and in checkpoints
+struct Recorded_Game {
+    Game_Identity identity;
+    uint32_t played = 0; // 0 until a game is recorded
+    uint32_t home_index = 0, away_index = 0; // Indices into the season's (or series') teams
+    uint32_t score[2] = {0, 0}; // Indexed by eTeam
+
+    Recorded_Game(){}
+    Recorded_Game(const Game_Identity& identity, uint home_index, uint away_index, const Game_Result& result);
+
+    // Call before the game's pitchers are rested, while the game states still hold how rested they were coming into it
+    void record_pitcher_rest(const Team_Game_State& home_state, const Team_Game_State& away_state);
+
+    uint get_margin() const;
+    // Ties go to the earlier game, so shards merge to the same game whatever order they are merged in
+    bool is_more_lopsided_than(const Recorded_Game& other) const;
+};
 
 
 class Matchup {
     public:
-        Team* home_team;
-        Team* away_team;
+        const Team_Definition* home_team;
+        const Team_Definition* away_team;
+        uint home_index, away_index; // Where the season/series playing this matchup keeps each team's game state and results
         uint day_of_year;
 
         uint times_played = 0;
@@ -19,45 +60,70 @@ class Matchup {
         uint games_won[2]{0};
 
         Matchup(){}
-        Matchup(Team* home_team, Team* away_team, uint day_of_year);
-
-        Game_Result play() {
-            home_team->prepare_for_game(day_of_year, true);
-            away_team->prepare_for_game(day_of_year, true);
-            Game_Result result = Baseball_Game(home_team, away_team, day_of_year).play_game();
+        Matchup(const Team_Definition* home_team, uint home_index, const Team_Definition* away_team, uint away_index, uint day_of_year);
+
+        // If there is an event sink, the game's events are sent to it as part of simulation sim_index
+        Game_Result play(Team_Game_State* team_states, Team_Running_Stat_Container* team_results, Game_Event_Sink* event_sink = NULL, uint sim_index = 0) {
+            Team_Game_State& home_state = team_states[home_index];
+            Team_Game_State& away_state = team_states[away_index];
+            home_state.prepare_for_game(day_of_year, true);
+            away_state.prepare_for_game(day_of_year, true);
+            Game_Event_Recorder* event_recorder = event_sink ? event_sink->begin_game(sim_index, day_of_year, home_index, home_state, away_index, away_state) : NULL;
+            Game_Result result = Baseball_Game(&home_state, &away_state, day_of_year, event_recorder).play_game();
+            if (event_sink) event_sink->end_game();
 
             times_played++;
             games_won[result.winner]++;
             for (uint i = 0; i < 2; i++) runs_scored[i] += result.final_score[i];
 
-            for (Player* player : result.home_team->pitchers_used) {
-                player->day_of_last_game_played = day_of_year;
-            }
-            for (Player* player : result.away_team->pitchers_used) {
-                player->day_of_last_game_played = day_of_year;
-            }
-
+            team_results[home_index].runs_scored += result.final_score[HOME_TEAM];
+            team_results[home_index].runs_allowed += result.final_score[AWAY_TEAM];
+            team_results[away_index].runs_scored += result.final_score[AWAY_TEAM];
+            team_results[away_index].runs_allowed += result.final_score[HOME_TEAM];
             return result;
         }
 
+        // Call after play once the game is recorded, the pitchers who played in it only start resting now
+        void rest_pitchers_used(Team_Game_State* team_states) const {
+            team_states[home_index].rest_pitchers_used(day_of_year);
+            team_states[away_index].rest_pitchers_used(day_of_year);
+        }
+
         void print_results();
+        void write_results(Json_Writer& writer) const;
+
+        void save_state(Binary_Writer& writer) const;
+        void merge_state(Binary_Reader& reader);
 };
 
 
+class Checkpointer;
+
 class Season {
     public:
         uint year;
         std::vector<Matchup> matchups;
-        std::vector<Team*> teams;
+        std::vector<const Team_Definition*> teams;
+        std::vector<Team_Game_State> team_states; // Indexed like teams
+        std::vector<Team_Running_Stat_Container> team_results; // Indexed like teams
+        uint sims_completed = 0;
+        Recorded_Game most_lopsided_game;
+        Game_Event_Sink* event_sink = NULL; // Gets every game's events if it is set (ex: an Event_Log of these teams)
 
         Season(){}
-        Season(const std::vector<Team*>& teams, uint year);
+        Season(const std::vector<const Team_Definition*>& teams, uint year);
 
-        std::vector<Team*> run_games(uint sims_per_matchup);
+        std::vector<uint> run_games(uint sims_per_matchup, uint64_t seed, uint first_sim = 0, Checkpointer* checkpointer = NULL);
+        Recorded_Game record_game(uint64_t seed, uint sim_index, uint game_index) const;
+        std::vector<uint> get_standings() const;
+        std::vector<std::pair<uint, uint>> get_matchup_pairs() const;
+        void write_results(Json_Writer& writer) const;
+
+        void save_state(Binary_Writer& writer) const;
+        void merge_state(Binary_Reader& reader, uint sims_completed);
 
     private:
         void populate_matchups();
-        eTeam simulate_matchup(Matchup& matchup);
 };
 
 /* What data do I want to have on the series?
@@ -69,14 +135,37 @@ This will do for now
 class Series {
     public:
         uint total_games_played = 0;
-
-        Series(Team* home_team, Team* away_team, uint games_in_series, uint num_simulations);
-        eTeam play();
+        uint sims_completed = 0;
+        Recorded_Game most_lopsided_game; // Team indices are eTeams
+        Game_Event_Sink* event_sink = NULL; // Gets every game's events if it is set, the series' teams are indexed by eTeam
+
+        Series(const Team_Definition* home_team, const Team_Definition* away_team, uint games_in_series, uint num_simulations);
+        eTeam play(uint64_t seed, uint first_sim = 0, Checkpointer* checkpointer = NULL);
+        void play_until(uint target_sims, uint64_t seed, uint first_sim = 0, Checkpointer* checkpointer = NULL);
+        Recorded_Game record_game(uint64_t seed, uint sim_index, uint game_index) const;
         void print_results();
+        void write_results(Json_Writer& writer) const;
+
+        uint get_series_won(eTeam team) const {
+            return series_won[team];
+        }
+
+        const Team_Definition* get_team(eTeam team) const {
+            return teams[team];
+        }
+
+        uint get_games_in_series() const {
+            return games_in_series;
+        }
+
+        void save_state(Binary_Writer& writer) const;
+        void merge_state(Binary_Reader& reader, uint sims_completed);
 
     private:
         std::vector<Matchup> matchups;
-        Team* teams[2];
+        const Team_Definition* teams[2];
+        Team_Game_State team_states[2];
+        Team_Running_Stat_Container team_results[2];
         uint series_won[2]{0};   // Keeps track of how many times each team has won the series
         uint games_played_in_series_won[2]{0}; // Accumulates how many games were played in series where each team won
         uint games_in_series; // Number of games in the series (Ex: For a world series, this would be 7)
@@ -85,5 +174,10 @@ class Series {
 
         void populate_matchups();
         Matchup get_series_matchup(uint current_matchup_index);
-        eTeam play_series_once();
-};
\ No newline at end of file
+        eTeam play_series_once(uint64_t seed, uint sim_index);
+};
+
+
+// Plays a recorded game again exactly as it was played, from its two teams alone. Only its events are sent to replay_sink,
+// with the teams indexed by eTeam.
+Game_Result replay_game(const Game_Identity& identity, const Team_Definition* home_team, const Team_Definition* away_team, Game_Event_Sink* replay_sink);
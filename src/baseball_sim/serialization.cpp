@@ -0,0 +1,109 @@
+#include "serialization.hpp"
+
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+Binary_Writer::Binary_Writer(const string& filename) : filename(filename), file(filename, ios::binary | ios::trunc) {
+    if (!file.is_open()) {
+        throw runtime_error("Could not open file " + filename + " for writing");
+    }
+}
+
+
+void Binary_Writer::write_string(const string& str) {
+    write<uint32_t>(str.size());
+    file.write(str.data(), str.size());
+}
+
+
+void Binary_Writer::close() {
+    file.close();
+    if (file.fail()) {
+        throw runtime_error("There was an issue writing file " + filename);
+    }
+}
+
+
+Binary_Reader::Binary_Reader(const string& filename) : filename(filename), file(filename, ios::binary) {
+    if (!file.is_open()) {
+        throw runtime_error("Could not open file " + filename);
+    }
+    file_size = filesystem::file_size(filename);
+}
+
+
+string Binary_Reader::read_string() {
+    uint32_t length = read<uint32_t>();
+    if (length > bytes_left()) file.setstate(ios::failbit);
+    check_stream();
+    string result(length, '\0');
+    file.read(result.data(), result.size());
+    check_stream();
+    return result;
+}
+
+
+uint64_t Binary_Reader::bytes_left() {
+    streamoff position = file.tellg();
+    return ((position < 0) || ((uint64_t)position > file_size)) ? 0 : file_size - position;
+}
+
+
+void Binary_Reader::check_stream() {
+    if (!file.good()) {
+        throw runtime_error("Unexpected end of file while reading " + filename);
+    }
+}
+
+
+#ifndef _WIN32
+
+Mapped_File::Mapped_File(const string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Could not open file " + filename);
+    }
+    file_size = filesystem::file_size(filename);
+    if (file_size > 0) {
+        void* mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Could not memory map file " + filename);
+        }
+        file_data = (const char*)mapping;
+    }
+    close(fd); // The mapping keeps the file alive on its own
+}
+
+
+Mapped_File::~Mapped_File() {
+    if (file_size > 0) munmap((void*)file_data, file_size);
+}
+
+#else
+
+Mapped_File::Mapped_File(const string& filename) {
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        throw runtime_error("Could not open file " + filename);
+    }
+    read_buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    file_data = read_buffer.data();
+    file_size = read_buffer.size();
+}
+
+
+Mapped_File::~Mapped_File() {}
+
+#endif
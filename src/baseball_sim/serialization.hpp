@@ -0,0 +1,102 @@
+#pragma once
+
+#include "includes.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+
+
+// Thin wrappers around binary file streams, used for checkpoints and any other compact on-disk simulation state.
+// Values are written in native byte order, so these files are meant to be read back on the same kind of machine that wrote them.
+class Binary_Writer {
+    public:
+        Binary_Writer(const std::string& filename);
+
+        template <class T>
+        void write(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "Binary_Writer can only write trivially copyable types");
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <class T>
+        void write_vector(const std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable_v<T>, "Binary_Writer can only write trivially copyable types");
+            write<uint64_t>(values.size());
+            file.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(T));
+        }
+
+        template <class T>
+        void write_array(const T* values, size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>, "Binary_Writer can only write trivially copyable types");
+            file.write(reinterpret_cast<const char*>(values), count*sizeof(T));
+        }
+
+        void write_string(const std::string& str);
+        void close();
+
+    private:
+        std::string filename;
+        std::ofstream file;
+};
+
+
+class Binary_Reader {
+    public:
+        Binary_Reader(const std::string& filename);
+
+        template <class T>
+        T read() {
+            static_assert(std::is_trivially_copyable_v<T>, "Binary_Reader can only read trivially copyable types");
+            T value;
+            file.read(reinterpret_cast<char*>(&value), sizeof(T));
+            check_stream();
+            return value;
+        }
+
+        template <class T>
+        std::vector<T> read_vector() {
+            static_assert(std::is_trivially_copyable_v<T>, "Binary_Reader can only read trivially copyable types");
+            uint64_t count = read<uint64_t>();
+            if (count > bytes_left()/sizeof(T)) file.setstate(std::ios::failbit); // A damaged file can't make us allocate more than it holds
+            check_stream();
+            std::vector<T> values(count);
+            file.read(reinterpret_cast<char*>(values.data()), values.size()*sizeof(T));
+            check_stream();
+            return values;
+        }
+
+        std::string read_string();
+
+    private:
+        std::string filename;
+        std::ifstream file;
+        uint64_t file_size = 0;
+
+        uint64_t bytes_left();
+        void check_stream();
+};
+
+
+/* Read-only view of a whole file, used for compiled files that are read in place instead of being parsed.
+The file is memory mapped where the platform supports it (and read into memory otherwise), so opening it costs nothing
+until its pages are touched. Pointers into data() stay valid for as long as the Mapped_File lives. */
+class Mapped_File {
+    public:
+        Mapped_File(const std::string& filename);
+        ~Mapped_File();
+
+        Mapped_File(const Mapped_File&) = delete;
+        Mapped_File& operator=(const Mapped_File&) = delete;
+
+        const char* data() const { return file_data; }
+        size_t size() const { return file_size; }
+
+    private:
+        const char* file_data = NULL;
+        size_t file_size = 0;
+        std::vector<char> read_buffer; // Only used where files can't be memory mapped
+};
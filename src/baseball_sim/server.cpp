@@ -0,0 +1,316 @@
+#include "server.hpp"
+
+#include "includes.hpp"
+#include "load_stats.hpp"
+#include "season.hpp"
+#include "statistics.hpp"
+#include "json.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+const uint NUM_PROGRESS_UPDATES = 10; // How many times we report partial results while running a request
+
+
+#ifndef _WIN32
+
+Client_Connection::~Client_Connection() {
+    close(socket_fd);
+}
+
+
+// If the client went away we just drop the line, the request still finishes so its data stays warm in the caches
+void Client_Connection::send_line(const string& line) {
+    lock_guard<mutex> lock(write_mutex);
+    string data = line + "\n";
+    size_t bytes_sent = 0;
+    while (bytes_sent < data.size()) {
+        ssize_t result = send(socket_fd, data.data() + bytes_sent, data.size() - bytes_sent, MSG_NOSIGNAL);
+        if (result <= 0) return;
+        bytes_sent += result;
+    }
+}
+
+
+static string make_status_line(const string& request_id, const string& status) {
+    Json_Writer writer;
+    writer.begin_object();
+    writer.add("id", request_id);
+    writer.add("status", status);
+    writer.end_object();
+    return writer.str();
+}
+
+
+static string make_error_line(const string& request_id, const string& message) {
+    Json_Writer writer;
+    writer.begin_object();
+    writer.add("id", request_id);
+    writer.add("status", "error");
+    writer.add("message", message);
+    writer.end_object();
+    return writer.str();
+}
+
+
+template <class Simulation>
+static string make_results_line(const string& request_id, const Simulation& simulation, uint num_sims, float elapsed_seconds) {
+    bool done = simulation.sims_completed >= num_sims;
+    Json_Writer writer;
+    writer.begin_object();
+    writer.add("id", request_id);
+    writer.add("status", done ? "done" : "progress");
+    writer.add("sims_completed", simulation.sims_completed);
+    writer.add("num_sims", num_sims);
+    writer.add("elapsed_seconds", elapsed_seconds);
+    writer.begin_object("result");
+    simulation.write_results(writer);
+    writer.end_object();
+    writer.end_object();
+    return writer.str();
+}
+
+
+static uint64_t get_request_seed(const Json_Object& request) {
+    if (request.has("seed")) return request.get_number("seed", 0);
+    static random_device seed_source;
+    return ((uint64_t)seed_source() << 32) | seed_source();
+}
+
+
+static uint get_positive_uint(const Json_Object& request, const string& key) {
+    double value = request.get_number(key, 0);
+    if (value < 1) {
+        throw runtime_error("\"" + key + "\" must be a positive number");
+    }
+    return value;
+}
+
+
+Simulation_Server::Simulation_Server(const string& socket_path, uint num_workers) : socket_path(socket_path), worker_pool(num_workers) {}
+
+
+void Simulation_Server::run() {
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        throw runtime_error("Could not create server socket");
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("Socket path is too long: " + socket_path);
+    }
+    socket_path.copy(address.sun_path, socket_path.size());
+    unlink(socket_path.c_str()); // Clean up after a previous server that did not shut down cleanly
+
+    if ((bind(server_fd, (sockaddr*)&address, sizeof(address)) < 0) || (listen(server_fd, 64) < 0)) {
+        close(server_fd);
+        throw runtime_error("Could not listen on " + socket_path);
+    }
+    cout << "Simulation server listening on " << socket_path << "\n";
+
+    while (true) {
+        int client_fd = accept(server_fd, NULL, NULL);
+        if (client_fd < 0) continue;
+
+        shared_ptr<Client_Connection> connection = make_shared<Client_Connection>(client_fd);
+        thread(&Simulation_Server::handle_connection, this, connection).detach();
+    }
+}
+
+
+// Reads requests off of the connection until the client closes it. Requests are only queued here, they run on the worker pool.
+void Simulation_Server::handle_connection(shared_ptr<Client_Connection> connection) {
+    string buffered_data;
+    char read_buffer[4096];
+
+    while (true) {
+        ssize_t bytes_read = recv(connection->get_socket_fd(), read_buffer, sizeof(read_buffer), 0);
+        if (bytes_read <= 0) return;
+        buffered_data.append(read_buffer, bytes_read);
+
+        size_t line_end;
+        while ((line_end = buffered_data.find('\n')) != string::npos) {
+            string line = buffered_data.substr(0, line_end);
+            buffered_data.erase(0, line_end + 1);
+            if (line.find_first_not_of(" \t\r") != string::npos) {
+                handle_request(connection, line);
+            }
+        }
+    }
+}
+
+
+void Simulation_Server::handle_request(shared_ptr<Client_Connection> connection, const string& request_line) {
+    Json_Object request;
+    string request_id;
+    try {
+        request = Json_Object::parse(request_line);
+        request_id = request.get_string("id", "");
+    }
+    catch (const exception& e) {
+        connection->send_line(make_error_line("", e.what()));
+        return;
+    }
+
+    string request_type = request.get_string("type", "");
+    if ((request_type != "series") && (request_type != "season") && (request_type != "release")) {
+        connection->send_line(make_error_line(request_id, "\"type\" must be \"series\", \"season\" or \"release\""));
+        return;
+    }
+
+    connection->send_line(make_status_line(request_id, "queued"));
+    worker_pool.submit([this, connection, request_id, request, request_type]() {
+        try {
+            if (request_type == "series") run_series_request(*connection, request_id, request);
+            else if (request_type == "season") run_season_request(*connection, request_id, request);
+            else run_release_request(*connection, request_id, request);
+        }
+        catch (const exception& e) { // Loading errors are also printed to the server's stderr with more details
+            connection->send_line(make_error_line(request_id, e.what()));
+        }
+    });
+}
+
+
+void Simulation_Server::run_series_request(Client_Connection& connection, const string& request_id, const Json_Object& request) {
+    string team_abbrs[2] = {request.get_string("home_team", ""), request.get_string("away_team", "")};
+    uint team_years[2] = {get_positive_uint(request, "home_year"), get_positive_uint(request, "away_year")};
+    uint games_in_series = get_positive_uint(request, "games");
+    uint num_sims = get_positive_uint(request, "sims");
+    uint64_t seed = get_request_seed(request);
+
+    vector<shared_lock<shared_mutex>> year_locks = lock_years_in_use({team_years[HOME_TEAM], team_years[AWAY_TEAM]});
+    Stat_Loader loader;
+    loader.check_team_files({{team_abbrs[HOME_TEAM], team_years[HOME_TEAM]}, {team_abbrs[AWAY_TEAM], team_years[AWAY_TEAM]}});
+    const Team_Definition* teams[2];
+    for (int i : {HOME_TEAM, AWAY_TEAM}) {
+        lock_guard<mutex> load_lock(get_load_lock("league_" + to_string(team_years[i])));
+        loader.load_league_year_stats(team_years[i]);
+    }
+    for (int i : {HOME_TEAM, AWAY_TEAM}) {
+        lock_guard<mutex> load_lock(get_load_lock("team_" + team_abbrs[i] + "_" + to_string(team_years[i])));
+        teams[i] = loader.load_team(team_abbrs[i], team_years[i]);
+    }
+
+    connection.send_line(make_status_line(request_id, "running"));
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    Series series(teams[HOME_TEAM], teams[AWAY_TEAM], games_in_series, num_sims);
+    for (uint update = 1; update <= NUM_PROGRESS_UPDATES; update++) {
+        series.play_until((uint64_t)num_sims*update/NUM_PROGRESS_UPDATES, seed);
+        if ((series.sims_completed == 0) && (update < NUM_PROGRESS_UPDATES)) continue;
+
+        float elapsed_seconds = chrono::duration<float>(chrono::steady_clock::now() - start).count();
+        connection.send_line(make_results_line(request_id, series, num_sims, elapsed_seconds));
+        if (series.sims_completed >= num_sims) break;
+    }
+}
+
+
+void Simulation_Server::run_season_request(Client_Connection& connection, const string& request_id, const Json_Object& request) {
+    uint year = get_positive_uint(request, "year");
+    uint num_sims = get_positive_uint(request, "sims");
+    uint64_t seed = get_request_seed(request);
+
+    vector<shared_lock<shared_mutex>> year_locks = lock_years_in_use({year});
+    Stat_Loader loader;
+    Season season;
+    {
+        lock_guard<mutex> load_lock(get_load_lock("season_" + to_string(year)));
+        season = loader.load_season(year);
+    }
+
+    connection.send_line(make_status_line(request_id, "running"));
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (uint update = 1; update <= NUM_PROGRESS_UPDATES; update++) {
+        season.run_games((uint64_t)num_sims*update/NUM_PROGRESS_UPDATES, seed);
+        if ((season.sims_completed == 0) && (update < NUM_PROGRESS_UPDATES)) continue;
+
+        float elapsed_seconds = chrono::duration<float>(chrono::steady_clock::now() - start).count();
+        connection.send_line(make_results_line(request_id, season, num_sims, elapsed_seconds));
+        if (season.sims_completed >= num_sims) break;
+    }
+}
+
+
+// Waits for every request that is using the year to finish, and keeps new ones from starting until the year is released
+void Simulation_Server::run_release_request(Client_Connection& connection, const string& request_id, const Json_Object& request) {
+    uint year = get_positive_uint(request, "year");
+    unique_lock<shared_mutex> year_lock(get_year_lock(year));
+    Stat_Loader().release_year(year);
+    connection.send_line(make_status_line(request_id, "done"));
+}
+
+
+// Makes sure only one request at a time loads a given team/league year/season, the others wait and then find it in the cache
+mutex& Simulation_Server::get_load_lock(const string& load_key) {
+    lock_guard<mutex> lock(lock_table_mutex);
+    unique_ptr<mutex>& load_lock = load_locks[load_key];
+    if (!load_lock) load_lock = make_unique<mutex>();
+    return *load_lock;
+}
+
+
+shared_mutex& Simulation_Server::get_year_lock(uint year) {
+    lock_guard<mutex> lock(lock_table_mutex);
+    unique_ptr<shared_mutex>& year_lock = year_locks[year];
+    if (!year_lock) year_lock = make_unique<shared_mutex>();
+    return *year_lock;
+}
+
+
+// Years are always locked in increasing order, so requests using two years never wait on each other while a release is waiting.
+// Requests take these before creating their loader, so the loader and every team, player and table they get from it (along with
+// their ids) are gone before the years are unlocked and can be released.
+vector<shared_lock<shared_mutex>> Simulation_Server::lock_years_in_use(vector<uint> years) {
+    sort(years.begin(), years.end());
+    years.erase(unique(years.begin(), years.end()), years.end());
+    vector<shared_lock<shared_mutex>> locks;
+    for (uint year : years) locks.emplace_back(get_year_lock(year));
+    return locks;
+}
+
+
+void run_simulation_server(const string& socket_path, uint num_workers) {
+    Simulation_Server server(socket_path, num_workers);
+    server.run();
+}
+
+#else
+
+Client_Connection::~Client_Connection() {}
+
+
+void Client_Connection::send_line(const string& line) {}
+
+
+void run_simulation_server(const string& socket_path, uint num_workers) {
+    cerr << "The simulation server uses Unix domain sockets, which are not supported on this platform.\n";
+    throw exception();
+}
+
+#endif
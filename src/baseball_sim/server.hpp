@@ -0,0 +1,69 @@
+#pragma once
+
+#include "includes.hpp"
+#include "team.hpp"
+#include "json.hpp"
+#include "worker_pool.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+
+// One client of the server. Responses from different jobs can be sent at the same time, so writes are serialized.
+class Client_Connection {
+    public:
+        Client_Connection(int socket_fd) : socket_fd(socket_fd) {}
+        ~Client_Connection();
+
+        void send_line(const std::string& line);
+        int get_socket_fd() const { return socket_fd; }
+
+    private:
+        int socket_fd;
+        std::mutex write_mutex;
+};
+
+
+/* Long-running simulation server. Keeps every team, player and league year it has loaded in memory (until the year is released), and answers
+series and season requests sent as newline-delimited JSON over a Unix domain socket. Every request is one line:
+    {"id": "q1", "type": "series", "home_team": "NYY", "home_year": 1927, "away_team": "LAD", "away_year": 2024, "games": 7, "sims": 1000}
+    {"id": "q2", "type": "season", "year": 2024, "sims": 10}
+("seed" is optional). The server answers each request with a "queued" line, "progress" lines holding the results so far,
+and a final "done" (or "error") line, all tagged with the request's id.
+    {"id": "r1", "type": "release", "year": 2024}
+frees everything loaded for a year (see Stat_Loader::release_year) once the requests using it are done, and answers with "done".
+
+Requests run on a worker pool. Loaded teams never change, every request plays its games on its own game states, so any
+requests (even ones for the same team-years) run at the same time. Only loading a given team/league year/season is
+serialized, so loading a new year never blocks requests that are already running. */
+class Simulation_Server {
+    public:
+        Simulation_Server(const std::string& socket_path, uint num_workers);
+        void run();
+
+    private:
+        std::string socket_path;
+        Worker_Pool worker_pool;
+
+        std::mutex lock_table_mutex;
+        std::map<std::string, std::unique_ptr<std::mutex>> load_locks;
+        std::map<uint, std::unique_ptr<std::shared_mutex>> year_locks; // Held shared by requests using the year (for as long as they hold anything loaded for it), and exclusively to release it
+
+        void handle_connection(std::shared_ptr<Client_Connection> connection);
+        void handle_request(std::shared_ptr<Client_Connection> connection, const std::string& request_line);
+        void run_series_request(Client_Connection& connection, const std::string& request_id, const Json_Object& request);
+        void run_season_request(Client_Connection& connection, const std::string& request_id, const Json_Object& request);
+        void run_release_request(Client_Connection& connection, const std::string& request_id, const Json_Object& request);
+
+        std::mutex& get_load_lock(const std::string& load_key);
+        std::shared_mutex& get_year_lock(uint year);
+        std::vector<std::shared_lock<std::shared_mutex>> lock_years_in_use(std::vector<uint> years);
+};
+
+
+void run_simulation_server(const std::string& socket_path, uint num_workers);
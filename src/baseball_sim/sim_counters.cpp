@@ -0,0 +1,81 @@
+#include "sim_counters.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+// Defined before the counters, so it is constructed before they register
+Sim_Counter_Registry sim_counters;
+
+const Sim_Counter COUNTER_PLATE_APPEARANCES = sim_counters.register_counter("plate_appearances");
+const Sim_Counter COUNTER_BALLS_IN_PLAY = sim_counters.register_counter("balls_in_play");
+const Sim_Counter COUNTER_HITS = sim_counters.register_counter("hits");
+const Sim_Counter COUNTER_STEAL_ATTEMPTS = sim_counters.register_counter("steal_attempts");
+const Sim_Counter COUNTER_STOLEN_BASES = sim_counters.register_counter("stolen_bases");
+const Sim_Counter COUNTER_PITCHING_CHANGES = sim_counters.register_counter("pitching_changes");
+
+
+Sim_Counter Sim_Counter_Registry::register_counter(const string& name) {
+    lock_guard<mutex> lock(shards_mutex);
+    if (names.size() >= MAX_SIM_COUNTERS) {
+        cerr << "Can't register simulation counter " << name << ", there can only be " << MAX_SIM_COUNTERS << "\n";
+        throw exception();
+    }
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+
+Sim_Counter_Registry::Shard& Sim_Counter_Registry::add_shard() {
+    lock_guard<mutex> lock(shards_mutex);
+    return shards.emplace_back();
+}
+
+
+uint64_t Sim_Counter_Registry::get(Sim_Counter counter) const {
+    lock_guard<mutex> lock(shards_mutex);
+    uint64_t total = 0;
+    for (const Shard& shard : shards) total += shard.counts[counter].load(memory_order_relaxed);
+    return total;
+}
+
+
+Sim_Counter_Totals Sim_Counter_Registry::get_totals() const {
+    lock_guard<mutex> lock(shards_mutex);
+    Sim_Counter_Totals totals;
+    for (const Shard& shard : shards) {
+        for (uint i = 0; i < names.size(); i++) totals.counts[i] += shard.counts[i].load(memory_order_relaxed);
+    }
+    return totals;
+}
+
+
+void Sim_Counter_Registry::add_totals(const Sim_Counter_Totals& totals) {
+    for (uint i = 0; i < names.size(); i++) {
+        if (totals.counts[i]) add(i, totals.counts[i]);
+    }
+}
+
+
+const string& Sim_Counter_Registry::get_name(Sim_Counter counter) const {
+    return names[counter];
+}
+
+
+uint Sim_Counter_Registry::get_num_counters() const {
+    return names.size();
+}
+
+
+void Sim_Counter_Registry::print(uint divisor) const {
+    Sim_Counter_Totals totals = get_totals();
+    cout << fixed << setprecision(3);
+    cout << "BALL IN PLAY%: " << ((float)totals[COUNTER_BALLS_IN_PLAY])/(float)totals[COUNTER_PLATE_APPEARANCES] << "\n"
+         << "         HITS: " << totals[COUNTER_HITS]/divisor << "\n"
+         << "          PAs: " << totals[COUNTER_PLATE_APPEARANCES]/divisor << "\n"
+         << "  SB ATTEMPTS: " << totals[COUNTER_STEAL_ATTEMPTS]/divisor << "\n"
+         << " STOLEN BASES: " << totals[COUNTER_STOLEN_BASES]/divisor << "\n"
+         << "PITCH CHANGES: " << totals[COUNTER_PITCHING_CHANGES]/divisor << "\n";
+}
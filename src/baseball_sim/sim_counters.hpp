@@ -0,0 +1,72 @@
+#pragma once
+
+#include "includes.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+const uint MAX_SIM_COUNTERS = 16;
+
+typedef uint8_t Sim_Counter; // Handed out by Sim_Counter_Registry::register_counter
+
+// Built in counters, registered in sim_counters.cpp
+extern const Sim_Counter COUNTER_PLATE_APPEARANCES;
+extern const Sim_Counter COUNTER_BALLS_IN_PLAY;
+extern const Sim_Counter COUNTER_HITS;
+extern const Sim_Counter COUNTER_STEAL_ATTEMPTS;
+extern const Sim_Counter COUNTER_STOLEN_BASES;
+extern const Sim_Counter COUNTER_PITCHING_CHANGES;
+
+
+// Every counter's total at one point in time, indexed by Sim_Counter. Written to checkpoints as is.
+struct Sim_Counter_Totals {
+    uint64_t counts[MAX_SIM_COUNTERS] = {};
+
+    uint64_t operator[](Sim_Counter counter) const {return counts[counter];}
+};
+
+
+/* Counts things that happen in simulated games (not real-life stats) over every thread in the process.
+Each thread only ever increments its own shard, which fills whole cache lines, so counting never takes a lock or makes cores fight over
+a cache line. Reading a counter sums every shard, including the shards of threads that have already exited.
+New counters are added with register_counter during static initialization (see sim_counters.cpp), before any game is played.
+There is only one registry, sim_counters, since threads find their shard through a thread_local. */
+class Sim_Counter_Registry {
+    public:
+        Sim_Counter register_counter(const std::string& name);
+
+        void add(Sim_Counter counter, uint64_t amount = 1) {
+            std::atomic<uint64_t>& count = get_thread_shard().counts[counter];
+            // Only this thread writes to its shard, so there is nothing to lock, readers just need to see whole values
+            count.store(count.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        uint64_t get(Sim_Counter counter) const;
+        Sim_Counter_Totals get_totals() const;
+        void add_totals(const Sim_Counter_Totals& totals); // Used for resuming from checkpoints and merging shards
+        const std::string& get_name(Sim_Counter counter) const;
+        uint get_num_counters() const;
+        void print(uint divisor = 1) const; // Counts per simulation
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> counts[MAX_SIM_COUNTERS] = {};
+        };
+
+        std::vector<std::string> names;
+        std::deque<Shard> shards; // Never moves its shards
+        mutable std::mutex shards_mutex;
+        inline static thread_local Shard* thread_shard = NULL;
+
+        Shard& get_thread_shard() {
+            if (thread_shard == NULL) thread_shard = &add_shard();
+            return *thread_shard;
+        }
+        Shard& add_shard();
+}
+extern sim_counters;
@@ -0,0 +1,358 @@
+#include "stat_database.hpp"
+
+#include "includes.hpp"
+#include "table.hpp"
+#include "utils.hpp"
+#include "serialization.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <cstring>
+#include <iostream>
+#include <cassert>
+
+using namespace std;
+
+
+Stat_Database stat_database;
+
+
+// Bump this whenever the file layout or the way CSV values are converted changes, so older databases get rebuilt
+const uint32_t STAT_DATABASE_VERSION = 1;
+const char STAT_DATABASE_MAGIC[8] = {'B', 'B', 'S', 'T', 'A', 'T', 'S', '\0'};
+const size_t TABLE_ALIGNMENT = 8;
+
+struct Stat_Database_Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_files;
+    uint64_t key_pool_offset;
+    uint64_t key_pool_size;
+};
+
+// The directory follows the header, sorted by key (the file's path relative to the data directory, ex: teams/NYY/2024/NYY_2024_batting.csv)
+struct Stat_Database_Entry {
+    uint64_t table_offset;
+    uint64_t table_size;
+    int64_t source_modified_time;
+    uint64_t source_size;
+    uint32_t key_offset; // Into the key pool
+    uint32_t key_length;
+};
+
+// What we remember about a CSV file, a compiled table is only used while its file still looks the same
+struct Source_File_Info {
+    uint64_t size = 0;
+    int64_t modified_time = 0;
+};
+
+
+static bool get_source_file_info(const string& filename, Source_File_Info& info) {
+    error_code error;
+    info.size = filesystem::file_size(filename, error);
+    if (error) return false;
+    filesystem::file_time_type modified_time = filesystem::last_write_time(filename, error);
+    if (error) return false;
+    info.modified_time = modified_time.time_since_epoch().count();
+    return true;
+}
+
+
+static bool is_in_bounds(uint64_t offset, uint64_t size, uint64_t total_size) {
+    return (offset <= total_size) && (size <= total_size - offset);
+}
+
+
+static bool is_compiled_string_valid(const char* table, uint64_t table_size, uint32_t offset) {
+    if ((offset % sizeof(uint32_t) != 0) || !is_in_bounds(offset, sizeof(uint32_t), table_size)) return false;
+    uint32_t length;
+    memcpy(&length, table + offset, sizeof(length));
+    return is_in_bounds(offset + sizeof(uint32_t), length, table_size);
+}
+
+
+// Makes sure every offset in a table stays inside of it, so a damaged file can never make Stat_Table read out of bounds
+static bool is_compiled_table_valid(const char* table, uint64_t table_size) {
+    if (table_size < sizeof(Compiled_Table_Header)) return false;
+    const Compiled_Table_Header* header = reinterpret_cast<const Compiled_Table_Header*>(table);
+    if (!is_in_bounds(sizeof(Compiled_Table_Header), (uint64_t)header->num_columns*sizeof(Compiled_Column), table_size)) return false;
+
+    const Compiled_Column* columns = reinterpret_cast<const Compiled_Column*>(header + 1);
+    for (uint32_t i = 0; i < header->num_columns; i++) {
+        if (!is_compiled_string_valid(table, table_size, columns[i].name_offset)) return false;
+        if ((columns[i].cells_offset % alignof(Compiled_Cell) != 0)
+                || !is_in_bounds(columns[i].cells_offset, (uint64_t)header->num_rows*sizeof(Compiled_Cell), table_size)) {
+            return false;
+        }
+
+        const Compiled_Cell* cells = reinterpret_cast<const Compiled_Cell*>(table + columns[i].cells_offset);
+        for (uint32_t row = 0; row < header->num_rows; row++) {
+            if (cells[row].type > CELL_STRING) return false;
+            if ((cells[row].type == CELL_STRING) && !is_compiled_string_valid(table, table_size, cells[row].string_offset)) return false;
+        }
+    }
+    return true;
+}
+
+
+// Returns the directory of a database file, or NULL if it is not a database this version can read
+static const Stat_Database_Header* get_database_header(const Mapped_File& file) {
+    if (file.size() < sizeof(Stat_Database_Header)) return NULL;
+    const Stat_Database_Header* header = reinterpret_cast<const Stat_Database_Header*>(file.data());
+    if ((memcmp(header->magic, STAT_DATABASE_MAGIC, sizeof(STAT_DATABASE_MAGIC)) != 0) || (header->version != STAT_DATABASE_VERSION)) return NULL;
+
+    uint64_t directory_size = (uint64_t)header->num_files*sizeof(Stat_Database_Entry);
+    if (!is_in_bounds(sizeof(Stat_Database_Header), directory_size, file.size()) || !is_in_bounds(header->key_pool_offset, header->key_pool_size, file.size())) return NULL;
+
+    const Stat_Database_Entry* entries = reinterpret_cast<const Stat_Database_Entry*>(header + 1);
+    for (uint32_t i = 0; i < header->num_files; i++) {
+        if (!is_in_bounds(entries[i].key_offset, entries[i].key_length, header->key_pool_size)
+                || (entries[i].table_offset % TABLE_ALIGNMENT != 0) || !is_in_bounds(entries[i].table_offset, entries[i].table_size, file.size())) {
+            return NULL;
+        }
+    }
+    return header;
+}
+
+
+static const Stat_Database_Entry* get_database_entries(const Stat_Database_Header* header) {
+    return reinterpret_cast<const Stat_Database_Entry*>(header + 1);
+}
+
+
+static string_view get_entry_key(const Mapped_File& file, const Stat_Database_Header* header, const Stat_Database_Entry& entry) {
+    return string_view(file.data() + header->key_pool_offset + entry.key_offset, entry.key_length);
+}
+
+
+string get_stat_database_file_path(const string& data_path) {
+    return data_path + "/compiled/stat_database.bin";
+}
+
+
+void Stat_Database::open(const string& data_path) {
+    call_once(open_flag, [this, &data_path]() {
+        this->data_path = data_path;
+        const string filename = get_stat_database_file_path(data_path);
+        if (!file_exists(filename)) return;
+
+        unique_ptr<Mapped_File> database_file = make_unique<Mapped_File>(filename);
+        if (get_database_header(*database_file) == NULL) {
+            cerr << "Ignoring " << filename << ", it was compiled by another version of the simulator or is damaged. Run compile-stats to rebuild it.\n";
+            return;
+        }
+        file = move(database_file);
+    });
+}
+
+
+const Stat_Database_Entry* Stat_Database::find_entry(const string& filename) const {
+    if (!file) return NULL;
+    if ((filename.size() <= data_path.size()) || (filename.compare(0, data_path.size(), data_path) != 0) || (filename[data_path.size()] != '/')) return NULL;
+    string_view key = string_view(filename).substr(data_path.size() + 1);
+
+    const Stat_Database_Header* header = reinterpret_cast<const Stat_Database_Header*>(file->data());
+    const Stat_Database_Entry* entries = get_database_entries(header);
+    const Stat_Database_Entry* entries_end = entries + header->num_files;
+    const Stat_Database_Entry* entry = lower_bound(entries, entries_end, key, [this, header](const Stat_Database_Entry& entry, string_view key) {
+        return get_entry_key(*file, header, entry) < key;
+    });
+    if ((entry == entries_end) || (get_entry_key(*file, header, *entry) != key)) return NULL;
+    return entry;
+}
+
+
+const Compiled_Table_Header* Stat_Database::find(const string& filename) const {
+    const Stat_Database_Entry* entry = find_entry(filename);
+    if (entry == NULL) return NULL;
+
+    Source_File_Info source_info;
+    if (!get_source_file_info(filename, source_info) || (source_info.size != entry->source_size) || (source_info.modified_time != entry->source_modified_time)) {
+        return NULL;
+    }
+    debug_line(assert(is_compiled_table_valid(file->data() + entry->table_offset, entry->table_size));)
+    return reinterpret_cast<const Compiled_Table_Header*>(file->data() + entry->table_offset);
+}
+
+
+bool Stat_Database::get_source_info(const string& filename, uint64_t& source_size, int64_t& source_modified_time) const {
+    const Stat_Database_Entry* entry = find_entry(filename);
+    if (entry == NULL) return false;
+    source_size = entry->source_size;
+    source_modified_time = entry->source_modified_time;
+    return true;
+}
+
+
+template <class T>
+static void append_bytes(vector<char>& data, const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+
+// Strings are padded so the next one starts aligned. Returns the offset of the string from the start of the table.
+static uint32_t append_compiled_string(vector<char>& table, const string& str) {
+    uint32_t offset = table.size();
+    append_bytes<uint32_t>(table, str.size());
+    table.insert(table.end(), str.begin(), str.end());
+    table.resize((table.size() + sizeof(uint32_t) - 1)/sizeof(uint32_t)*sizeof(uint32_t), '\0');
+    return offset;
+}
+
+
+// Lays a parsed CSV file out the way Stat_Table reads compiled tables (see Compiled_Table_Header). std::map keeps the columns sorted by name.
+// Returns false if its columns are not all the same length.
+static bool compile_table(const map<string, vector<Table_Entry>>& table_data, vector<char>& table) {
+    uint32_t num_rows = table_data.empty() ? 0 : table_data.begin()->second.size();
+    for (auto const& [column_name, column] : table_data) {
+        if (column.size() != num_rows) return false;
+    }
+
+    const uint32_t columns_offset = sizeof(Compiled_Table_Header);
+    const uint32_t cells_offset = columns_offset + table_data.size()*sizeof(Compiled_Column);
+    table.assign(cells_offset + table_data.size()*num_rows*sizeof(Compiled_Cell), '\0');
+
+    Compiled_Table_Header header{(uint32_t)table_data.size(), num_rows};
+    memcpy(table.data(), &header, sizeof(header));
+
+    uint32_t column_index = 0;
+    for (auto const& [column_name, column] : table_data) {
+        Compiled_Column compiled_column;
+        compiled_column.name_offset = append_compiled_string(table, column_name);
+        compiled_column.cells_offset = cells_offset + column_index*num_rows*sizeof(Compiled_Cell);
+
+        for (uint32_t row = 0; row < num_rows; row++) {
+            Compiled_Cell cell{};
+            if (holds_alternative<float>(column[row])) {
+                cell.type = CELL_FLOAT;
+                cell.number = get<float>(column[row]);
+            }
+            else if (holds_alternative<string>(column[row])) {
+                cell.type = CELL_STRING;
+                cell.string_offset = append_compiled_string(table, get<string>(column[row]));
+            }
+            else {
+                cell.type = CELL_EMPTY;
+            }
+            memcpy(table.data() + compiled_column.cells_offset + row*sizeof(Compiled_Cell), &cell, sizeof(cell));
+        }
+        memcpy(table.data() + columns_offset + column_index*sizeof(Compiled_Column), &compiled_column, sizeof(compiled_column));
+        column_index++;
+    }
+    return true;
+}
+
+
+struct Compiled_Source_File {
+    string key;
+    Source_File_Info source_info;
+    vector<char> table;
+};
+
+
+void compile_stat_database(const string& data_path) {
+    const string database_filename = get_stat_database_file_path(data_path);
+    const filesystem::path compiled_dir = filesystem::path(database_filename).parent_path();
+    if (!file_exists(data_path)) {
+        cerr << "Stat data directory " << data_path << " does not exist\n";
+        throw exception();
+    }
+
+    // Tables of files that did not change are copied out of the previous database
+    unique_ptr<Mapped_File> old_file;
+    const Stat_Database_Header* old_header = NULL;
+    map<string_view, const Stat_Database_Entry*> old_entries;
+    if (file_exists(database_filename)) {
+        old_file = make_unique<Mapped_File>(database_filename);
+        old_header = get_database_header(*old_file);
+        for (uint32_t i = 0; old_header && (i < old_header->num_files); i++) {
+            const Stat_Database_Entry& entry = get_database_entries(old_header)[i];
+            old_entries[get_entry_key(*old_file, old_header, entry)] = &entry;
+        }
+    }
+
+    vector<Compiled_Source_File> compiled_files;
+    uint num_reused = 0, num_parsed = 0;
+    for (const filesystem::directory_entry& dir_entry : filesystem::recursive_directory_iterator(data_path)) {
+        if (!dir_entry.is_regular_file() || (dir_entry.path().extension() != ".csv")) continue;
+        if (dir_entry.path().parent_path() == compiled_dir) continue;
+
+        Compiled_Source_File compiled_file;
+        compiled_file.key = dir_entry.path().lexically_relative(data_path).generic_string();
+        const string filename = dir_entry.path().string();
+        if (!get_source_file_info(filename, compiled_file.source_info)) continue; // Removed while we were compiling
+
+        auto old_entry = old_entries.find(compiled_file.key);
+        if ((old_entry != old_entries.end()) && (old_entry->second->source_size == compiled_file.source_info.size)
+                && (old_entry->second->source_modified_time == compiled_file.source_info.modified_time)
+                && is_compiled_table_valid(old_file->data() + old_entry->second->table_offset, old_entry->second->table_size)) {
+            const char* old_table = old_file->data() + old_entry->second->table_offset;
+            compiled_file.table.assign(old_table, old_table + old_entry->second->table_size);
+            num_reused++;
+        }
+        else {
+            if (!compile_table(read_csv_file(filename), compiled_file.table)) {
+                cerr << "Skipping " << filename << ", its columns are not all the same length\n";
+                continue;
+            }
+            num_parsed++;
+        }
+        compiled_files.push_back(move(compiled_file));
+    }
+    sort(compiled_files.begin(), compiled_files.end(), [](const Compiled_Source_File& a, const Compiled_Source_File& b) {
+        return a.key < b.key;
+    });
+
+    Stat_Database_Header header{};
+    memcpy(header.magic, STAT_DATABASE_MAGIC, sizeof(STAT_DATABASE_MAGIC));
+    header.version = STAT_DATABASE_VERSION;
+    header.num_files = compiled_files.size();
+    header.key_pool_offset = sizeof(Stat_Database_Header) + compiled_files.size()*sizeof(Stat_Database_Entry);
+
+    vector<Stat_Database_Entry> entries(compiled_files.size());
+    string key_pool;
+    for (size_t i = 0; i < compiled_files.size(); i++) {
+        entries[i].key_offset = key_pool.size();
+        entries[i].key_length = compiled_files[i].key.size();
+        key_pool += compiled_files[i].key;
+    }
+    header.key_pool_size = key_pool.size();
+
+    auto align_offset = [](uint64_t offset) { return (offset + TABLE_ALIGNMENT - 1)/TABLE_ALIGNMENT*TABLE_ALIGNMENT; };
+    uint64_t offset = align_offset(header.key_pool_offset + key_pool.size());
+    for (size_t i = 0; i < compiled_files.size(); i++) {
+        entries[i].table_offset = offset;
+        entries[i].table_size = compiled_files[i].table.size();
+        entries[i].source_size = compiled_files[i].source_info.size;
+        entries[i].source_modified_time = compiled_files[i].source_info.modified_time;
+        offset = align_offset(offset + entries[i].table_size);
+    }
+
+    filesystem::create_directories(compiled_dir);
+    const string temp_filename = database_filename + ".tmp";
+    Binary_Writer writer(temp_filename);
+    writer.write(header);
+    writer.write_array(entries.data(), entries.size());
+    writer.write_array(key_pool.data(), key_pool.size());
+    uint64_t written = header.key_pool_offset + key_pool.size();
+    const char padding[TABLE_ALIGNMENT] = {};
+    for (size_t i = 0; i < compiled_files.size(); i++) {
+        writer.write_array(padding, entries[i].table_offset - written);
+        writer.write_array(compiled_files[i].table.data(), compiled_files[i].table.size());
+        written = entries[i].table_offset + entries[i].table_size;
+    }
+    writer.close();
+    old_file.reset();
+    filesystem::rename(temp_filename, database_filename);
+
+    cout << "Compiled " << compiled_files.size() << " stat files into " << database_filename << " (" << num_parsed << " parsed, "
+         << num_reused << " unchanged since the last compile)\n";
+}
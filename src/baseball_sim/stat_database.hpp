@@ -0,0 +1,50 @@
+#pragma once
+
+#include "includes.hpp"
+#include "table.hpp"
+#include "serialization.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+
+struct Stat_Database_Entry;
+
+
+/* The whole stat data tree (every team-year, league-year and player CSV file) packed into one indexed file, written by
+compile_stat_database. Tables are read in place out of the memory mapped file instead of being parsed.
+The CSV files stay the source of truth: every table remembers the size and modification time of the file it was compiled from,
+and a table whose file changed since (or that was never compiled) is not served, so callers fall back to reading the CSV.
+Tables are only checked for damage when compile_stat_database writes them, so looking one up never reads more than its
+directory entry. Thread safe. */
+class Stat_Database {
+    public:
+        // Maps data_path's database file if there is one. Only the first call does anything.
+        void open(const std::string& data_path);
+
+        // Returns the compiled table of a CSV file under data_path, or NULL if it is not in the database or is out of date
+        const Compiled_Table_Header* find(const std::string& filename) const;
+
+        // Gets the size and modification time of the CSV file a table that find returned was compiled from, which stand in
+        // for its contents (ex: in hash_source_files). Returns false if the file is not in the database.
+        bool get_source_info(const std::string& filename, uint64_t& source_size, int64_t& source_modified_time) const;
+
+    private:
+        std::once_flag open_flag;
+        std::string data_path;
+        std::unique_ptr<Mapped_File> file;
+
+        const Stat_Database_Entry* find_entry(const std::string& filename) const;
+};
+
+
+// Compiles every CSV file under data_path into its database file. Tables whose files did not change since the last time
+// are copied over from the old database instead of being parsed again.
+void compile_stat_database(const std::string& data_path);
+
+std::string get_stat_database_file_path(const std::string& data_path);
+
+extern Stat_Database stat_database;
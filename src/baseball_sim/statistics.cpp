@@ -8,7 +8,7 @@
 
 using namespace std;
 
-Global_Running_Stat_Container global_stats;
+const Stat_Table EMPTY_STAT_TABLE;
 
 string PLAYER_STAT_NAMES[NUM_PLAYER_STAT_TYPES] = {"batting", "pitching", "fielding", "appearances", "baserunning", "baserunning_against", "batting_against"};
 string TEAM_STAT_NAMES[NUM_TEAM_STAT_TYPES] = {"roster", "batting", "pitching", "common_batting_orders", "team_info", "schedule"};
@@ -40,7 +40,17 @@ map<eLeague_Stat_Types, uint> LEAGUE_STAT_EARLIEST_YEARS {
 };
 
 
-Player_Stats::Player_Stats(const string& player_id, uint year_to_pull_stats_from, const string& team_abbreviation, Stat_Table player_stat_tables[NUM_PLAYER_STAT_TYPES]) : Stat_Table_Container(player_stat_tables) {
+Player_Stats::Player_Stats() {
+    for (int i = 0; i < NUM_PLAYER_STAT_TYPES; i++) {
+        stat_tables[i] = &EMPTY_STAT_TABLE;
+    }
+}
+
+
+Player_Stats::Player_Stats(const string& player_id, uint year_to_pull_stats_from, const string& team_abbreviation, const Stat_Table* player_stat_tables[NUM_PLAYER_STAT_TYPES]) {
+    for (int i = 0; i < NUM_PLAYER_STAT_TYPES; i++) {
+        stat_tables[i] = player_stat_tables[i] ? player_stat_tables[i] : &EMPTY_STAT_TABLE;
+    }
     this->player_id = player_id;
     this->cache_id = get_player_cache_id(player_id, team_abbreviation, year_to_pull_stats_from);
     this->current_year = year_to_pull_stats_from;
@@ -61,12 +71,12 @@ void Player_Stats::change_stat_table_target_row(ePlayer_Stat_Types stat_type, ui
         team_name_str = "team_ID";
     }
 
-    int target_row = stat_tables[stat_type].find_row(map<string, vector<Table_Entry>>({{year_str, {(float)year}}, {team_name_str, {team_abbreviation}}}));
+    int target_row = stat_tables[stat_type]->find_row(map<string, vector<Table_Entry>>({{year_str, {(float)year}}, {team_name_str, {team_abbreviation}}}));
     if (target_row < 0) {
-        current_table_row_indices[stat_type] = stat_tables[stat_type].size() - 1;
+        current_table_row_indices[stat_type] = stat_tables[stat_type]->size() - 1;
         debug_line(
-            if (!stat_tables[stat_type].empty())
-                cout << "Missing stat row of player stat type "<< PLAYER_STAT_NAMES[stat_type] << " in non-empty stat table "<< stat_tables[stat_type].stat_table_id << " for player "<< cache_id << "\n";
+            if (!stat_tables[stat_type]->empty())
+                cout << "Missing stat row of player stat type "<< PLAYER_STAT_NAMES[stat_type] << " in non-empty stat table "<< stat_tables[stat_type]->stat_table_id << " for player "<< cache_id << "\n";
         )
     }
     else {
@@ -116,11 +126,17 @@ League_Stats::League_Stats(uint year, Stat_Table league_stat_tables[NUM_LEAGUE_S
 
 
 void League_Stats::populate_probs() {
+    populate_pitching_stats();
     populate_at_bat_probs();
     populate_steal_probs();
 }
 
 
+void League_Stats::populate_pitching_stats() {
+    earned_run_avg = get_stat(LEAGUE_PITCHING, "earned_run_avg", 0, .0f);
+}
+
+
 void League_Stats::populate_at_bat_probs() {
     int league_plate_appearances = get_stat(LEAGUE_BATTING, "PA", 0, 1.f);
     at_bat_probs[OUTCOME_STRIKEOUT] = get_stat(LEAGUE_BATTING, "SO", 0, .0f)/league_plate_appearances;
@@ -165,15 +181,39 @@ void League_Stats::populate_steal_probs() {
 
 
 bool All_League_Stats_Wrapper::holds_year(uint year) const {
+    std::shared_lock<std::shared_mutex> lock(league_stats_mutex);
     return league_stat_tables.find(year) != league_stat_tables.end();
 }
 
 
+// If the year was already added (ex: by another thread), the existing stats are kept, since simulations may be using them
 void All_League_Stats_Wrapper::add_year(uint year, const League_Stats& year_table) {
-    league_stat_tables.insert({year, year_table});
+    if (year > MAX_LEAGUE_YEAR) {
+        cerr << "League year " << year << " is out of range (the latest supported year is " << MAX_LEAGUE_YEAR << ")\n";
+        throw exception();
+    }
+    std::unique_lock<std::shared_mutex> lock(league_stats_mutex);
+    auto [it, inserted] = league_stat_tables.insert({year, year_table});
+    if (inserted) constants_by_year[year] = &it->second;
+}
+
+
+void All_League_Stats_Wrapper::remove_year(uint year) {
+    std::unique_lock<std::shared_mutex> lock(league_stats_mutex);
+    if (league_stat_tables.erase(year)) constants_by_year[year] = NULL;
 }
 
 
 const League_Stats& All_League_Stats_Wrapper::get_year(uint year) const {
+    std::shared_lock<std::shared_mutex> lock(league_stats_mutex);
     return league_stat_tables.at(year);
-}
\ No newline at end of file
+}
+
+
+const League_Constants* All_League_Stats_Wrapper::get_constants(uint year) const {
+    std::shared_lock<std::shared_mutex> lock(league_stats_mutex);
+    if ((year > MAX_LEAGUE_YEAR) || !constants_by_year[year]) {
+        throw out_of_range("League stats for " + to_string(year) + " are not loaded");
+    }
+    return constants_by_year[year];
+}
@@ -10,6 +10,8 @@
 #include <cstdint>
 #include <iostream>
 #include <iomanip>
+#include <shared_mutex>
+#include <mutex>
 
 enum ePlayer_Stat_Types {
     PLAYER_BATTING,
@@ -25,21 +27,38 @@ enum ePlayer_Stat_Types {
 extern std::string PLAYER_STAT_NAMES[NUM_PLAYER_STAT_TYPES];
 extern std::map<ePlayer_Stat_Types, uint> PLAYER_STAT_EARLIEST_YEARS;
 
-class Player_Stats : public Stat_Table_Container<ePlayer_Stat_Types, NUM_PLAYER_STAT_TYPES> {
+extern const Stat_Table EMPTY_STAT_TABLE;
+
+/* One player's stats for one team and year. The career tables themselves are shared by every team/year the player
+is loaded for (see Career_Store), this only points at them and remembers which row of each belongs to this team and year.
+Stat types that were not loaded for this team/year point at EMPTY_STAT_TABLE. */
+class Player_Stats {
     public:
         std::string player_id;
         std::string cache_id;
         uint current_year;
 
-        Player_Stats(){}
-        Player_Stats(const std::string& player_id, uint year, const std::string& team_abbreviation, Stat_Table player_stat_tables[NUM_PLAYER_STAT_TYPES]);
+        Player_Stats();
+        Player_Stats(const std::string& player_id, uint year, const std::string& team_abbreviation, const Stat_Table* player_stat_tables[NUM_PLAYER_STAT_TYPES]);
 
         template <class T>
         T get_stat(ePlayer_Stat_Types stat_type, const std::string& stat_name, const T& default_val) const {
-            return stat_tables[stat_type].get_stat(stat_name, current_table_row_indices[stat_type], default_val);
+            return stat_tables[stat_type]->get_stat(stat_name, current_table_row_indices[stat_type], default_val);
+        }
+
+        bool has_stats(ePlayer_Stat_Types stat_type) const {
+            return !stat_tables[stat_type]->empty();
+        }
+
+        const Stat_Table& operator[](ePlayer_Stat_Types stat_type) const {
+            if ((stat_type < 0) || (stat_type >= NUM_PLAYER_STAT_TYPES)) {
+                throw std::out_of_range("Illegal stat_table access in Player_Stats\n");
+            }
+            return *stat_tables[stat_type];
         }
 
     private:
+        const Stat_Table* stat_tables[NUM_PLAYER_STAT_TYPES];
         size_t current_table_row_indices[NUM_PLAYER_STAT_TYPES] = {0};
         std::string current_team_abbreviation;
 
@@ -90,15 +109,21 @@ enum eLeague_Stat_Types {
 extern std::string LEAGUE_STAT_NAMES[NUM_LEAGUE_STAT_TYPES];
 extern std::map<eLeague_Stat_Types, uint> LEAGUE_STAT_EARLIEST_YEARS;
 
-class League_Stats : public Stat_Table_Container<eLeague_Stat_Types, NUM_LEAGUE_STAT_TYPES> {
-    public:
-        float at_bat_probs[NUM_AB_OUTCOMES];
-        float hit_or_out_probs[2];
-        float hit_type_probs[4];
-        float steal_attempt_probs[2][2];
-        float steal_success_probs[2][2];
+// Everything the simulation needs from a league year, worked out once when the year is loaded.
+// Steal stats are left at 0 for years before baserunning stats exist.
+struct League_Constants {
+    float at_bat_probs[NUM_AB_OUTCOMES] = {0};
+    float hit_or_out_probs[2] = {0};
+    float hit_type_probs[4] = {0};
+    float steal_attempt_probs[2][2] = {{0}};
+    float steal_success_probs[2][2] = {{0}};
+
+    float sbo_on_first_percent = 0;
+    float earned_run_avg = 0;
+};
 
-        float sbo_on_first_percent;
+class League_Stats : public Stat_Table_Container<eLeague_Stat_Types, NUM_LEAGUE_STAT_TYPES>, public League_Constants {
+    public:
         uint year;
 
         League_Stats() {}
@@ -106,21 +131,29 @@ class League_Stats : public Stat_Table_Container<eLeague_Stat_Types, NUM_LEAGUE_
 
     private:
         void populate_probs();
+        void populate_pitching_stats();
         void populate_at_bat_probs();
         void populate_steal_probs();
 };
 
+const uint MAX_LEAGUE_YEAR = 2100;
+
 // Holds real-world League Stats for all loaded years
+// Years can be added from one thread while simulations on other threads read the years they already use.
 class All_League_Stats_Wrapper {
     public:
         All_League_Stats_Wrapper(){}
         void add_year(uint year, const League_Stats& year_table);
+        void remove_year(uint year); // Nothing may still be using the year's stats or constants
         bool holds_year(uint year) const;
         const League_Stats& get_year(uint year) const;
 
+        // Simulations look this up once per team and keep the pointer, it stays valid until the year is removed
+        const League_Constants* get_constants(uint year) const;
+
         template <class T>
         T get_stat(eLeague_Stat_Types stat_type, uint year, const std::string& stat_name, const T& default_val) const {
-            return league_stat_tables.at(year).get_stat(stat_type, stat_name, 0, default_val);
+            return get_year(year).get_stat(stat_type, stat_name, 0, default_val);
         }
 
         const League_Stats& operator[](uint year) const {
@@ -130,29 +163,24 @@ class All_League_Stats_Wrapper {
     private:
         // Keys are years, values are League Stats for that year
         std::map<uint, League_Stats> league_stat_tables;
+        const League_Constants* constants_by_year[MAX_LEAGUE_YEAR + 1] = {}; // Points into league_stat_tables, which never moves its values
+        mutable std::shared_mutex league_stats_mutex;
 }
 extern ALL_LEAGUE_STATS;
 
 
-// Container for stats that our simulation accumulates (not real-life stats)
-struct Global_Running_Stat_Container {
-    uint32_t balls_in_play = 0;
-    uint32_t total_PAs = 0;
-    uint32_t total_hits = 0;
-
-    void print(int divisor = 1) {
-        std::cout << std::fixed << std::setprecision(3);
-        std::cout << "BALL IN PLAY%: " << ((float)balls_in_play)/(float)total_PAs << "\n"
-                  << "         HITS: " << total_hits/divisor << "\n"
-                  << "          PAs: " << total_PAs/divisor << "\n";
-    }
-}
-extern global_stats;
-
-
+// Each team's results summed over every simulation (counts of things that happen in the games themselves are in sim_counters.hpp)
 struct Team_Running_Stat_Container {
-    uint runs_scored = 0;
-    uint runs_allowed = 0;
-    uint wins = 0;
-    uint losses = 0;
+    uint64_t runs_scored = 0;
+    uint64_t runs_allowed = 0;
+    uint64_t wins = 0;
+    uint64_t losses = 0;
+
+    Team_Running_Stat_Container& operator+=(const Team_Running_Stat_Container& other) {
+        runs_scored += other.runs_scored;
+        runs_allowed += other.runs_allowed;
+        wins += other.wins;
+        losses += other.losses;
+        return *this;
+    }
 };
\ No newline at end of file
@@ -1,41 +1,130 @@
 #pragma once
 
 #include "includes.hpp"
+#include "arena.hpp"
 
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
 #include <iostream>
 #include <stdexcept>
 #include <variant>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
 
 
 typedef std::variant<std::monostate, float, std::string> Table_Entry;
 
+// How parsed tables keep their cells, strings point into the table's arena so cells never own any memory of their own
+typedef std::variant<std::monostate, float, std::string_view> Arena_Entry;
+
+
+/* Layout of a table inside the compiled stat database (see Stat_Database), which is read in place instead of being parsed.
+A Compiled_Table_Header is followed by its columns (sorted by name) and then every column's cells, one column after another.
+Names and string cells are stored as a uint32_t length followed by the characters. Offsets are from the start of the header. */
+enum eCompiled_Cell_Types : uint32_t {
+    CELL_EMPTY,
+    CELL_FLOAT,
+    CELL_STRING
+};
+
+struct Compiled_Cell {
+    uint32_t type;
+    union {
+        float number;
+        uint32_t string_offset;
+    };
+};
+
+struct Compiled_Column {
+    uint32_t name_offset;
+    uint32_t cells_offset;
+};
+
+struct Compiled_Table_Header {
+    uint32_t num_columns;
+    uint32_t num_rows;
+};
+
+
+const size_t MIN_INDEXED_ROWS = 32; // Smaller tables are always scanned (ex: a player's career)
+
+// Secondary hash index on one column of a table (see Stat_Table::add_index), built the first time a search uses it
+struct Column_Index {
+    std::once_flag built;
+    std::unordered_map<Table_Entry, std::vector<uint32_t>> rows_by_value; // Every value's rows in order
+};
+
+// The data of a table is immutable once it is loaded and lives in an arena (or in the compiled stat database), so copying a
+// table only copies a pointer to it
 class Stat_Table {
     public:
         std::string stat_table_id;
 
         Stat_Table() {}
-        Stat_Table(const std::map<std::string, std::vector<Table_Entry>>& table_data, const std::string& stat_table_id = "") {
+        Stat_Table(std::map<std::string, std::vector<Table_Entry>>&& table_data, const std::string& stat_table_id, Arena& arena) {
             if (!is_table_data_valid(table_data)) {
                 std::cerr << "ERROR: ROWS OF MISMATCHED SIZES IN TABLE " << stat_table_id << "\n";
                 throw std::exception();
             }
 
             this->stat_table_id = stat_table_id;
-            this->table_data = table_data;
+            Table_Data* arena_data = arena.create<Table_Data>(&arena);
+            for (auto const& [header, column] : table_data) {
+                std::pmr::vector<Arena_Entry>& arena_column = (*arena_data)[arena.copy_string(header)];
+                arena_column.reserve(column.size());
+                for (const Table_Entry& entry : column) {
+                    arena_column.push_back(to_arena_entry(entry, arena));
+                }
+            }
+            this->table_data = arena_data;
 
-            if (this->table_data.size() == 0) {
+            if (this->table_data->size() == 0) {
                 column_size = 0;
             }
             else {
-                column_size = this->table_data.begin()->second.size();
+                column_size = this->table_data->begin()->second.size();
             }
         }
 
+        // Reads the table in place, compiled_table has to stay valid for as long as the table is used
+        Stat_Table(const Compiled_Table_Header* compiled_table, const std::string& stat_table_id) {
+            this->stat_table_id = stat_table_id;
+            this->compiled_table = compiled_table;
+            column_size = compiled_table->num_rows;
+        }
+
+        /* Makes searches on the column (find_row and filter_rows) look their rows up in an index instead of scanning the table.
+        Copies made after this share the table's indexes, which are built the first time a search uses them, but this has to be
+        called before the table is shared between threads. Does nothing if the table has no such column, or is small enough that
+        scanning it is cheaper than building the index. */
+        void add_index(const std::string& column_name) {
+            if ((size() < MIN_INDEXED_ROWS) || !has_stat(column_name)) return;
+            if (!column_indexes) column_indexes = std::make_shared<std::map<std::string, Column_Index>>();
+            column_indexes->try_emplace(column_name);
+        }
+
         // Return the index of the row with the given attributes, return -1 if no row exists with the given attributes.
         int find_row(const std::map<std::string, std::vector<Table_Entry>>& search_attributes) const {
+            std::vector<size_t> candidate_rows;
+            if (find_indexed_rows(search_attributes, candidate_rows)) {
+                auto found = std::find_if(candidate_rows.begin(), candidate_rows.end(), [&](size_t row){return row_has_attributes(row, search_attributes);});
+                int result = (found == candidate_rows.end()) ? -1 : *found;
+                debug_line(
+                    std::vector<size_t> scanned_rows = scan_rows(search_attributes);
+                    assert(result == (scanned_rows.empty() ? -1 : (int)scanned_rows[0]));
+                )
+                return result;
+            }
+
             for (size_t i = 0; i < size(); i++) {
                 if (row_has_attributes(i, search_attributes)) {
                     return i;
@@ -48,10 +137,12 @@ class Stat_Table {
         /* Return a vector of row indexes corresponding to rows with the given attributes. If search attributes is empty, returns all rows. */
         std::vector<size_t> filter_rows(const std::map<std::string, std::vector<Table_Entry>>& search_attributes) const {
             std::vector<size_t> result;
-            for (size_t i = 0; i < size(); i++) {
-                if (row_has_attributes(i, search_attributes)) result.push_back(i);
+            if (find_indexed_rows(search_attributes, result)) {
+                result.erase(std::remove_if(result.begin(), result.end(), [&](size_t row){return !row_has_attributes(row, search_attributes);}), result.end());
+                debug_line(assert(result == scan_rows(search_attributes));)
+                return result;
             }
-            return result;
+            return scan_rows(search_attributes);
         }
 
 
@@ -62,17 +153,27 @@ class Stat_Table {
                 throw std::exception();
             }
 
+            if (compiled_table) return convert_cell(compiled_column(stat_name)[row_index], default_val);
             return convert_entry(get_entry(row_index, stat_name), default_val);
         }
 
 
         template <class T>
         std::vector<T> column(const std::string& stat_name, const T& default_val) const {
-            const std::vector<Table_Entry>& table_col = column(stat_name);
             std::vector<T> result;
+            if (compiled_table) {
+                const Compiled_Cell* cells = compiled_column(stat_name);
+                result.reserve(size());
+                for (size_t i = 0; i < size(); i++) {
+                    result.push_back(convert_cell(cells[i], default_val));
+                }
+                return result;
+            }
+
+            const std::pmr::vector<Arena_Entry>& table_col = column(stat_name);
             result.reserve(table_col.size());
 
-            for (const Table_Entry& entry : table_col) {
+            for (const Arena_Entry& entry : table_col) {
                 result.push_back(convert_entry(entry, default_val));
             }
             return result;
@@ -80,7 +181,8 @@ class Stat_Table {
 
 
         bool has_stat(const std::string& stat_name) const {
-            return table_data.find(stat_name) != table_data.end();
+            if (compiled_table) return find_compiled_column(stat_name) != NULL;
+            return table_data->find(stat_name) != table_data->end();
         }
 
 
@@ -92,13 +194,27 @@ class Stat_Table {
             return column_size == 0;
         }
 
+        // Whether the table is read in place out of the compiled stat database, rather than parsed from its CSV file
+        bool is_compiled() const {
+            return compiled_table != NULL;
+        }
+
     private:
-        std::map<std::string, std::vector<Table_Entry>> table_data;
+        typedef std::pmr::map<std::string_view, std::pmr::vector<Arena_Entry>> Table_Data; // Column names point into the arena too
+
+        const Table_Data* table_data = &empty_table_data();
+        const Compiled_Table_Header* compiled_table = NULL; // Only set for tables read from the compiled stat database
         size_t column_size = 0;
+        std::shared_ptr<std::map<std::string, Column_Index>> column_indexes; // Keyed by column name, NULL until a column is indexed
+
+        static const Table_Data& empty_table_data() {
+            static const Table_Data empty_data;
+            return empty_data;
+        }
 
-        const std::vector<Table_Entry>& column(const std::string& stat_name) const {
+        const std::pmr::vector<Arena_Entry>& column(const std::string& stat_name) const {
             try {
-                return table_data.at(stat_name);
+                return table_data->at(stat_name);
             }
             catch (const std::out_of_range&) {
                 std::cerr << "Stat " + stat_name + " is not a column in table " + stat_table_id + "\n";
@@ -106,9 +222,9 @@ class Stat_Table {
             }
         }
 
-        const Table_Entry& get_entry(size_t row, const std::string& column) const {
+        const Arena_Entry& get_entry(size_t row, const std::string& column) const {
             try {
-                return table_data.at(column).at(row);
+                return table_data->at(column).at(row);
             }
             catch (const std::out_of_range&) {
                 std::cerr << "Stat " + column + " not in table " + stat_table_id + "at row " << row << "\n";
@@ -116,13 +232,33 @@ class Stat_Table {
             }
         }
 
+        std::vector<size_t> scan_rows(const std::map<std::string, std::vector<Table_Entry>>& search_attributes) const {
+            std::vector<size_t> result;
+            for (size_t i = 0; i < size(); i++) {
+                if (row_has_attributes(i, search_attributes)) result.push_back(i);
+            }
+            return result;
+        }
+
         bool row_has_attributes(size_t row, const std::map<std::string, std::vector<Table_Entry>>& attributes) const {
             for (auto const& [attr_name, attr_values] : attributes) {
                 bool found_attribute = false;
-                if (has_stat(attr_name)) {
-                    const Table_Entry& existing_value = get_entry(row, attr_name);
+                if (compiled_table) {
+                    const Compiled_Column* column = find_compiled_column(attr_name);
+                    if (column) {
+                        const Compiled_Cell& cell = get_compiled_cells(*column)[row];
+                        for (const Table_Entry& value : attr_values) {
+                            if (cell_equals(cell, value)) {
+                                found_attribute = true;
+                                break;
+                            }
+                        }
+                    }
+                }
+                else if (has_stat(attr_name)) {
+                    const Arena_Entry& existing_value = get_entry(row, attr_name);
                     for (const Table_Entry& value : attr_values) {
-                        if (value == existing_value) {
+                        if (entry_equals(existing_value, value)) {
                             found_attribute = true;
                             break;
                         }
@@ -133,6 +269,38 @@ class Stat_Table {
             return true;
         }
 
+        /* If one of the searched columns has an index that can look up all of its searched values, fills rows with the rows
+        (in order) that hold one of them, which still have to be checked against the other columns. Returns false otherwise. */
+        bool find_indexed_rows(const std::map<std::string, std::vector<Table_Entry>>& search_attributes, std::vector<size_t>& rows) const {
+            if (!column_indexes || column_indexes->empty()) return false;
+
+            for (auto const& [attr_name, attr_values] : search_attributes) {
+                auto index_it = column_indexes->find(attr_name);
+                if (index_it == column_indexes->end()) continue;
+                Column_Index& index = index_it->second;
+                std::call_once(index.built, [&](){build_index(attr_name, index);});
+                for (const Table_Entry& value : attr_values) {
+                    auto found = index.rows_by_value.find(value);
+                    if (found != index.rows_by_value.end()) rows.insert(rows.end(), found->second.begin(), found->second.end());
+                }
+                if (attr_values.size() > 1) {
+                    std::sort(rows.begin(), rows.end());
+                    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void build_index(const std::string& column_name, Column_Index& index) const {
+            const Compiled_Cell* cells = compiled_table ? compiled_column(column_name) : NULL;
+            for (uint32_t row = 0; row < size(); row++) {
+                Table_Entry value = cells ? cell_entry(cells[row]) : table_entry(get_entry(row, column_name));
+                if (std::holds_alternative<float>(value) && std::isnan(std::get<float>(value))) continue; // NaN never equals a searched value
+                index.rows_by_value[value].push_back(row);
+            }
+        }
+
         bool is_table_data_valid(const std::map<std::string, std::vector<Table_Entry>>& data) const {
             if (data.size() == 0) { // Empty tables are ok
                 return true;
@@ -147,18 +315,107 @@ class Stat_Table {
         }
 
 
+        const char* compiled_data() const {
+            return reinterpret_cast<const char*>(compiled_table);
+        }
+
+        std::string_view get_compiled_string(uint32_t offset) const {
+            uint32_t length;
+            std::copy(compiled_data() + offset, compiled_data() + offset + sizeof(length), reinterpret_cast<char*>(&length));
+            return std::string_view(compiled_data() + offset + sizeof(length), length);
+        }
+
+        const Compiled_Cell* get_compiled_cells(const Compiled_Column& column) const {
+            return reinterpret_cast<const Compiled_Cell*>(compiled_data() + column.cells_offset);
+        }
+
+        // Columns are sorted by name. Returns NULL if there is no such column.
+        const Compiled_Column* find_compiled_column(const std::string& stat_name) const {
+            const Compiled_Column* columns = reinterpret_cast<const Compiled_Column*>(compiled_table + 1);
+            size_t low = 0, high = compiled_table->num_columns;
+            while (low < high) {
+                size_t middle = (low + high)/2;
+                int comparison = get_compiled_string(columns[middle].name_offset).compare(stat_name);
+                if (comparison == 0) return &columns[middle];
+                if (comparison < 0) low = middle + 1;
+                else high = middle;
+            }
+            return NULL;
+        }
+
+        const Compiled_Cell* compiled_column(const std::string& stat_name) const {
+            const Compiled_Column* column = find_compiled_column(stat_name);
+            if (column == NULL) {
+                std::cerr << "Stat " + stat_name + " is not a column in table " + stat_table_id + "\n";
+                throw std::out_of_range("");
+            }
+            return get_compiled_cells(*column);
+        }
+
+        bool cell_equals(const Compiled_Cell& cell, const Table_Entry& value) const {
+            switch (cell.type) {
+                case CELL_FLOAT: return std::holds_alternative<float>(value) && (std::get<float>(value) == cell.number);
+                case CELL_STRING: return std::holds_alternative<std::string>(value) && (std::get<std::string>(value) == get_compiled_string(cell.string_offset));
+                default: return std::holds_alternative<std::monostate>(value);
+            }
+        }
+
+        Table_Entry cell_entry(const Compiled_Cell& cell) const {
+            switch (cell.type) {
+                case CELL_FLOAT: return cell.number;
+                case CELL_STRING: return std::string(get_compiled_string(cell.string_offset));
+                default: return std::monostate();
+            }
+        }
+
+        template <class T>
+        T convert_cell(const Compiled_Cell& cell, const T& default_val) const {
+            static_assert(std::is_same_v<T, float> || std::is_same_v<T, std::string>, "Stat tables only hold floats and strings");
+            if (cell.type == CELL_EMPTY) {
+                return default_val;
+            }
+            if constexpr (std::is_same_v<T, float>) {
+                if (cell.type == CELL_FLOAT) return cell.number;
+            }
+            else {
+                if (cell.type == CELL_STRING) return std::string(get_compiled_string(cell.string_offset));
+            }
+            std::cerr << "Bad variant access in " << stat_table_id << " (default val was " << default_val << ")\n";
+            throw std::exception();
+        }
+
+        static Arena_Entry to_arena_entry(const Table_Entry& entry, Arena& arena) {
+            if (std::holds_alternative<float>(entry)) return std::get<float>(entry);
+            if (std::holds_alternative<std::string>(entry)) return arena.copy_string(std::get<std::string>(entry));
+            return std::monostate();
+        }
+
+        static Table_Entry table_entry(const Arena_Entry& entry) {
+            if (std::holds_alternative<float>(entry)) return std::get<float>(entry);
+            if (std::holds_alternative<std::string_view>(entry)) return std::string(std::get<std::string_view>(entry));
+            return std::monostate();
+        }
+
+        static bool entry_equals(const Arena_Entry& entry, const Table_Entry& value) {
+            if (std::holds_alternative<float>(entry)) return std::holds_alternative<float>(value) && (std::get<float>(value) == std::get<float>(entry));
+            if (std::holds_alternative<std::string_view>(entry)) return std::holds_alternative<std::string>(value) && (std::get<std::string>(value) == std::get<std::string_view>(entry));
+            return std::holds_alternative<std::monostate>(value);
+        }
+
         template <class T>
-        T convert_entry(const Table_Entry& entry, const T& default_val) const {
+        T convert_entry(const Arena_Entry& entry, const T& default_val) const {
+            static_assert(std::is_same_v<T, float> || std::is_same_v<T, std::string>, "Stat tables only hold floats and strings");
             if (std::holds_alternative<std::monostate>(entry)) {
                 return default_val;
             }
-            try {
-                return std::get<T>(entry);
+            if constexpr (std::is_same_v<T, float>) {
+                if (std::holds_alternative<float>(entry)) return std::get<float>(entry);
             }
-            catch (const std::bad_variant_access&) {
-                std::cerr << "Bad variant access in " << stat_table_id << " (default val was " << default_val << ")\n";
-                throw std::exception();
+            else {
+                if (std::holds_alternative<std::string_view>(entry)) return std::string(std::get<std::string_view>(entry));
             }
+            std::cerr << "Bad variant access in " << stat_table_id << " (default val was " << default_val << ")\n";
+            throw std::exception();
         }
 };
 
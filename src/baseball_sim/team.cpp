@@ -2,38 +2,128 @@
 
 #include "includes.hpp"
 #include "statistics.hpp"
+#include "sim_counters.hpp"
 #include "player.hpp"
 #include "table.hpp"
+#include "matchup_probabilities.hpp"
 
 #include <vector>
 #include <fstream>
 #include <algorithm>
 #include <random>
 #include <set>
+#include <utility>
 #include <cassert>
 
 
 using namespace std;
 
 
-Team::Team(const string& team_name, const vector<Player*>& players, const Team_Stats& team_stats): 
+const float MIN_DEFENSE_STOLEN_BASE_PROB = .01;
+const float MAX_DEFENSE_STOLEN_BASE_PROB = .99;
+
+
+Team_Definition::Team_Definition(const string& team_name, const vector<Player*>& players, const Team_Stats& team_stats):
     team_stats(team_stats),
-    uses_dh(true),
-    all_players(players), 
-    batting_order(), 
-    fielders() 
+    all_players(players),
+    most_common_batting_order()
 {
     this->team_name = team_name;
+    find_table_players();
+}
+
+
+set<Player*, Player_Ptr_Less> Team_Definition::filter_players_by_listed_pos(const vector<Table_Entry>& positions) const {
+    set<Player*, Player_Ptr_Less> result;
+
+    for (eTeam_Stat_Types team_stat_type : {TEAM_BATTING, TEAM_PITCHING}) {
+        const vector<Player*>& table_players = (team_stat_type == TEAM_BATTING) ? batting_table_players : pitching_table_players;
+        vector<size_t> search_results = team_stats[team_stat_type].filter_rows({{"team_position", positions}});
+
+        for (size_t search_result : search_results) {
+            result.insert(table_players[search_result]);
+        }
+    }
+
+    return result;
+}
+
+
+set<Player*, Player_Ptr_Less> Team_Definition::filter_pitchers(const vector<Table_Entry>& pitcher_types) const {
+    vector<size_t> search_results = team_stats[TEAM_PITCHING].filter_rows({{"team_position", pitcher_types}});
+    set<Player*, Player_Ptr_Less> result;
+
+    for (size_t search_result : search_results) {
+        result.insert(pitching_table_players[search_result]);
+    }
+
+    return result;
+}
+
+
+// Resolves the player ids in the team tables to the team's players. Only called when the team is built.
+void Team_Definition::find_table_players() {
+    for (const string& player_id : team_stats[TEAM_BATTING].column<string>("ID", "")) {
+        batting_table_players.push_back(find_player(player_id));
+    }
+    for (const string& player_id : team_stats[TEAM_PITCHING].column<string>("ID", "")) {
+        pitching_table_players.push_back(find_player(player_id));
+    }
+    set<Player*, Player_Ptr_Less> sorted_pitchers(pitching_table_players.begin(), pitching_table_players.end());
+    pitchers.assign(sorted_pitchers.begin(), sorted_pitchers.end());
+
+    // Finding the most used batting order (in the future use discrete distribution and select randomly)
+    const Stat_Table& batting_order_table = team_stats[TEAM_COMMON_BATTING_ORDERS];
+    int max_games_found = -1;
+    int most_common_batting_order_row = -1;
+    for (size_t i = 0; i < batting_order_table.size(); i++) {
+        int games = batting_order_table.get_stat("games", i, .0f);
+        if (games > max_games_found) {
+            most_common_batting_order_row = i;
+            max_games_found = games;
+        }
+    }
+    for (int i = 1; i < 10; i++) {
+        string player_id = batting_order_table.get_stat<string>(to_string(i), most_common_batting_order_row, "");
+        most_common_batting_order[i - 1] = (player_id == "Pitcher") ? NULL : find_player(player_id);
+        if (most_common_batting_order[i - 1] == NULL) pitcher_bats = true;
+    }
+}
+
+
+Player* Team_Definition::find_player(const string& player_id) const {
+    for (Player* player : all_players) {
+        if (player->id == player_id) return player;
+    }
+    cerr << "Player " << player_id << " is listed in the stats of " << team_stats.team_cache_id << " but is not on its roster\n";
+    throw exception();
+}
+
 
+Team_Game_State::Team_Game_State(const Team_Definition* team):
+    team(team),
+    league(ALL_LEAGUE_STATS.get_constants(team->team_stats.year)),
+    uses_dh(true),
+    batting_order(),
+    fielders(),
+    pitcher_available(team->pitchers.size(), true)
+{
     position_in_batting_order = 0;
     runs_allowed_by_pitcher = 0;
     current_pitcher_starting_half_inning = 0;
 
+    const Team_Probability_Tables& tables = probability_store.get_team_tables(team);
+    player_runner_probabilities = tables.runner_probabilities;
+    pitcher_usage = tables.pitcher_usage;
+    pitcher_hooks = tables.pitcher_hooks;
+    fielding_games = tables.fielding_games;
+    pitcher_scheduler = Pitcher_Scheduler(pitcher_usage, team->pitchers.size(), team->team_stats.days_in_schedule);
     prepare_for_game(0, false);
 }
 
+
 // Call this before every game the team plays
-void Team::prepare_for_game(uint day_of_game, bool keep_batting_order) {
+void Team_Game_State::prepare_for_game(uint day_of_game, bool keep_batting_order) {
     position_in_batting_order = 0;
     runs_allowed_by_pitcher = 0;
     current_pitcher_starting_half_inning = 0;
@@ -44,152 +134,179 @@ void Team::prepare_for_game(uint day_of_game, bool keep_batting_order) {
         set_up_batting_order();
         set_up_fielders();
     }
+    update_steal_defense();
 }
 
 
-set<Player*> Team::filter_players_by_listed_pos(const vector<Table_Entry>& positions) {
-    vector<string> player_ids;
-
-    for (eTeam_Stat_Types team_stat_type : {TEAM_BATTING, TEAM_PITCHING}) {
-        const Stat_Table& stat_table = team_stats[team_stat_type];
-        vector<size_t> search_results = stat_table.filter_rows({{"team_position", positions}});
-
-        for (size_t search_result : search_results) {
-            player_ids.push_back(stat_table.get_stat<string>("ID", search_result, ""));
+// Puts the team partway through a game (see Game_Snapshot), call after prepare_for_game. pitchers_used are indices in
+// team->pitchers in the order they pitched, the last one is pitching now.
+void Team_Game_State::resume_game(uint8_t position_in_batting_order, const vector<uint>& pitchers_used, uint8_t runs_allowed_by_pitcher, uint8_t pitcher_starting_half_inning) {
+    if (position_in_batting_order >= 9) {
+        cerr << "Batting order position " << (int)position_in_batting_order << " is out of range\n";
+        throw exception();
+    }
+    if (pitchers_used.empty()) {
+        cerr << "A game in progress needs the pitcher that is pitching for " << team->team_stats.team_cache_id << "\n";
+        throw exception();
+    }
+    for (uint pitcher : pitchers_used) {
+        if (pitcher >= team->pitchers.size()) {
+            cerr << "Pitcher " << pitcher << " is not on " << team->team_stats.team_cache_id << "\n";
+            throw exception();
         }
     }
 
-    return find_players(player_ids);
+    set_up_pitchers();
+    for (uint pitcher : pitchers_used) set_current_pitcher(pitcher, pitcher_starting_half_inning);
+    update_steal_defense();
+    this->position_in_batting_order = position_in_batting_order;
+    this->runs_allowed_by_pitcher = runs_allowed_by_pitcher;
 }
 
 
-set<Player*> Team::filter_pitchers(const vector<Table_Entry>& pitcher_types) {
-    const Stat_Table& stat_table = team_stats[TEAM_PITCHING];
-    vector<size_t> search_results = stat_table.filter_rows({{"team_position", pitcher_types}});
-    vector<string> pitcher_ids;
-
-    for (size_t search_result : search_results) {
-        pitcher_ids.push_back(stat_table.get_stat<string>("ID", search_result, ""));
+uint Team_Game_State::pick_starting_pitcher(uint current_day_of_year) {
+    uint new_pitcher = pitcher_scheduler.pick_rested(ROLE_STARTER, current_day_of_year, pitcher_available);
+    if (new_pitcher == Pitcher_Scheduler::NO_PITCHER) { // If there are no rested pitchers (this is somewhat rare), then we just go with the player that has the most rest
+        new_pitcher = pitcher_scheduler.pick_most_rested(ROLE_STARTER, current_day_of_year, pitcher_available, current_pitcher);
+        game_viewer_line(debug_print("No rested starting pitchers available on " << team->team_stats.team_cache_id << ", defaulting to least unrested player..."));
     }
-
-    return find_players(pitcher_ids);
+    debug_line(assert(new_pitcher == scan_for_starting_pitcher(current_day_of_year)));
+    return new_pitcher;
 }
 
 
-set<Player*> Team::get_all_pitchers() {
-    vector<string> pitcher_ids = team_stats[TEAM_PITCHING].column<string>("ID", "");
-    return find_players(pitcher_ids);
+uint Team_Game_State::pick_relief_pitcher(uint current_day_of_year) {
+    uint new_pitcher = pitcher_scheduler.pick_rested(ROLE_RELIEVER, current_day_of_year, pitcher_available);
+    if (new_pitcher == Pitcher_Scheduler::NO_PITCHER) {
+        new_pitcher = pitcher_scheduler.pick_most_rested(ROLE_RELIEVER, current_day_of_year, pitcher_available, current_pitcher);
+        game_viewer_line(debug_print("No rested relief pitchers available on " << team->team_stats.team_cache_id << ", defaulting to least unrested player..."));
+    }
+    debug_line(assert(new_pitcher == scan_for_relief_pitcher(current_day_of_year)));
+    return new_pitcher;
 }
 
 
-Player* Team::pick_starting_pitcher(uint current_day_of_year) {
-    Player* new_pitcher = get_pitcher();
-    Player* least_unrested_pitcher = get_pitcher();
+// The scans the scheduler replaced, kept so debug builds can check that it picks the same pitchers
+uint Team_Game_State::scan_for_starting_pitcher(uint current_day_of_year) {
+    uint new_pitcher = current_pitcher;
+    uint least_unrested_pitcher = current_pitcher;
     int max_games = -1;
     uint most_days_of_rest_for_unrested_player = 0;
 
-    for (Player* player : available_pitchers) {
-        int games_started = player->stats.get_stat(PLAYER_PITCHING, "p_gs", .0f);
+    for (uint i = 0; i < team->pitchers.size(); i++) {
+        if (!pitcher_available[i]) continue;
+        int games_started = pitcher_usage[i].games_started;
         if (games_started <= 0) continue; // This player has never been a starting pitcher, so we don't want to put him in
 
-        uint cooldown = min(team_stats.days_in_schedule/games_started, MAX_PITCHER_COOLDOWN);
-        uint days_of_rest = current_day_of_year - player->day_of_last_game_played;
+        uint cooldown = min(team->team_stats.days_in_schedule/games_started, Pitcher_Scheduler::MAX_PITCHER_COOLDOWN);
+        uint days_of_rest = current_day_of_year - pitcher_scheduler.get_day_of_last_game_pitched(i);
         bool is_rested = days_of_rest >= cooldown;
 
         if (is_rested && (games_started > max_games)) { // Also use winrate here
             max_games = games_started;
-            new_pitcher = player;
+            new_pitcher = i;
         }
         else if ((max_games == -1) && (days_of_rest >= most_days_of_rest_for_unrested_player)) { // if our player is unrested and we are yet to find a rested player
             most_days_of_rest_for_unrested_player = days_of_rest;
-            least_unrested_pitcher = player;
+            least_unrested_pitcher = i;
         }
     }
     if (max_games == -1) { // If there are no rested pitchers (this is somewhat rare), then we just go with the player that has the most rest
         new_pitcher = least_unrested_pitcher;
-        game_viewer_line(debug_print("No rested starting pitchers available on " << team_stats.team_cache_id << ", defaulting to least unrested player..."));
     }
 
     return new_pitcher;
 }
 
 
-Player* Team::pick_relief_pitcher(uint current_day_of_year) {
-    Player* new_pitcher = get_pitcher();
-    Player* least_unrested_pitcher = get_pitcher();
+uint Team_Game_State::scan_for_relief_pitcher(uint current_day_of_year) {
+    uint new_pitcher = current_pitcher;
+    uint least_unrested_pitcher = current_pitcher;
     int most_relief_games = -1;
     uint most_days_of_rest_for_unrested_player = 0;
 
-    for (Player* player : available_pitchers) {
-        int games_total = player->stats.get_stat(PLAYER_PITCHING, "p_g", .0f);
-        int relief_games = games_total - player->stats.get_stat(PLAYER_PITCHING, "p_gs", .0f);
+    for (uint i = 0; i < team->pitchers.size(); i++) {
+        if (!pitcher_available[i]) continue;
+        int games_total = pitcher_usage[i].games;
+        int relief_games = games_total - pitcher_usage[i].games_started;
         if (relief_games <= 0) continue; // If this player is only a starter, we do not put them in as a reliever. This helps save starting pitchers.
 
-        uint cooldown = min(team_stats.days_in_schedule/games_total, MAX_PITCHER_COOLDOWN);
-        uint days_of_rest = current_day_of_year - player->day_of_last_game_played;
+        uint cooldown = min(team->team_stats.days_in_schedule/games_total, Pitcher_Scheduler::MAX_PITCHER_COOLDOWN);
+        uint days_of_rest = current_day_of_year - pitcher_scheduler.get_day_of_last_game_pitched(i);
         bool is_rested = days_of_rest >= cooldown;
 
         if (is_rested && (relief_games > most_relief_games)) {
             most_relief_games = relief_games;
-            new_pitcher = player;
+            new_pitcher = i;
         }
         else if ((most_relief_games == -1) && (days_of_rest >= most_days_of_rest_for_unrested_player)) { // if our player is unrested and we are yet to find a rested player
             most_days_of_rest_for_unrested_player = days_of_rest;
-            least_unrested_pitcher = player;
+            least_unrested_pitcher = i;
         }
     }
     if (most_relief_games == -1) { // If there are no rested pitchers (this is somewhat rare), then we just go with the player that has the most rest
         new_pitcher = least_unrested_pitcher;
-        game_viewer_line(debug_print("No rested relief pitchers available on " << team_stats.team_cache_id << ", defaulting to least unrested player..."));
     }
 
     return new_pitcher;
 }
 
 
-void Team::set_current_pitcher(Player* new_pitcher, uint8_t current_half_inning) {
+void Team_Game_State::set_current_pitcher(uint new_pitcher_index, uint8_t current_half_inning) {
+    if (new_pitcher_index == NO_PITCHER) {
+        cerr << "No pitcher available on " << team->team_stats.team_cache_id << "\n";
+        throw exception();
+    }
+    Player* new_pitcher = team->pitchers[new_pitcher_index];
+
     if (!uses_dh) {
         debug_line(assert(fielders[POS_DH] == fielders[POS_PITCHER]));
         fielders[POS_DH] = new_pitcher;
         for (int i = 8; i >= 0; i--) { // Loop backwards since pitcher is almost always batting last
             if (batting_order[i] == fielders[POS_PITCHER]) {
                 batting_order[i] = new_pitcher;
+                batting_order_runner_probabilities[i] = get_runner_probabilities(new_pitcher);
+                batting_order_matchup_rows[i] = 9 + new_pitcher_index;
                 break;
             }
         }
     }
     fielders[POS_PITCHER] = new_pitcher;
-    available_pitchers.erase(new_pitcher);
-    pitchers_used.push_back(new_pitcher);
+    pitcher_available[new_pitcher_index] = false;
+    pitchers_used.push_back(new_pitcher_index);
+    current_pitcher = new_pitcher_index;
     runs_allowed_by_pitcher = 0;
     current_pitcher_starting_half_inning = current_half_inning;
+    pitcher_hook_runs = pitcher_hooks[new_pitcher_index].max_runs;
+    // (half innings since the pitcher came in)/2 > max_innings, for whole numbers of half innings
+    pitcher_hook_half_inning = current_half_inning + 2*pitcher_hooks[new_pitcher_index].max_innings + 2;
 }
 
 
-Player* Team::try_switching_pitcher(uint8_t current_half_inning, uint current_day_of_year) {
-    if (should_swap_pitcher(get_pitcher(), current_half_inning)) {
-        Player* new_pitcher = pick_next_pitcher(current_half_inning, current_day_of_year);
-        set_current_pitcher(new_pitcher, current_half_inning);
-        game_viewer_print("NEW PITCHER FOR " << team_name << ": " << new_pitcher->name << "\n");
-        return new_pitcher;
+Player* Team_Game_State::try_switching_pitcher(uint8_t current_half_inning, uint current_day_of_year) {
+    if (should_swap_pitcher(current_half_inning)) {
+        set_current_pitcher(pick_next_pitcher(current_half_inning, current_day_of_year), current_half_inning);
+        update_steal_defense();
+        sim_counters.add(COUNTER_PITCHING_CHANGES);
+        game_viewer_print("NEW PITCHER FOR " << team->team_name << ": " << get_pitcher()->name << "\n");
     }
     return get_pitcher();
 }
 
 
-bool Team::should_swap_pitcher(Player* pitcher, uint8_t current_half_inning) {
-    const float league_era = ALL_LEAGUE_STATS.get_stat(LEAGUE_PITCHING, team_stats.year, "earned_run_avg", .0f);
-    if (runs_allowed_by_pitcher > league_era + 1) return true;
-
-    const float total_innings = pitcher->stats.get_stat(PLAYER_PITCHING, "p_ip", .0f);
-    float total_games = pitcher->stats.get_stat(PLAYER_PITCHING, "p_g", .0f);
-    if (total_games == 0) total_games = 1;
-
-    return ((current_half_inning - current_pitcher_starting_half_inning)/2) > (total_innings/total_games + 1);
+// Runs before every plate appearance, so the thresholds are worked out when the pitcher comes in (see Pitcher_Hook)
+bool Team_Game_State::should_swap_pitcher(uint8_t current_half_inning) {
+    debug_line(
+        float total_games = (pitcher_usage[current_pitcher].games == 0) ? 1 : pitcher_usage[current_pitcher].games;
+        bool old_decision = (runs_allowed_by_pitcher > league->earned_run_avg + 1)
+                            || (((current_half_inning - current_pitcher_starting_half_inning)/2) > (pitcher_usage[current_pitcher].innings_pitched/total_games + 1));
+        assert(old_decision == ((runs_allowed_by_pitcher > pitcher_hook_runs) || (current_half_inning >= pitcher_hook_half_inning)));
+    )
+    return (runs_allowed_by_pitcher > pitcher_hook_runs) || (current_half_inning >= pitcher_hook_half_inning);
 }
 
 
-Player* Team::pick_next_pitcher(uint8_t current_half_inning, uint current_day_of_year) {
+uint Team_Game_State::pick_next_pitcher(uint8_t current_half_inning, uint current_day_of_year) {
     if (current_half_inning > 5) {
         return pick_relief_pitcher(current_day_of_year);
     }
@@ -198,95 +315,167 @@ Player* Team::pick_next_pitcher(uint8_t current_half_inning, uint current_day_of
 
 
 // Pitcher must be set before calling
-void Team::set_up_batting_order() {
-    const Stat_Table& batting_order_table = team_stats[TEAM_COMMON_BATTING_ORDERS];
+void Team_Game_State::set_up_batting_order() {
     uses_dh = true;
-
-    // Finding the most used batting order (in the future use discrete distribution and select randomly)
-    int max_games_found = -1;
-    int most_common_batting_order_row = -1;
-    for (size_t i = 0; i < batting_order_table.size(); i++) {
-        int games = batting_order_table.get_stat("games", i, .0f);
-        if (games > max_games_found) {
-            most_common_batting_order_row = i;
-            max_games_found = games;
-        }
-    }
-    // Loop through that batting order, add each player to our current batting order
-    for (int i = 1; i < 10; i++) {
-        string pos_in_order = to_string(i);
-        string player_id = batting_order_table.get_stat<string>(pos_in_order, most_common_batting_order_row, "");
-        if (player_id == "Pitcher") {
-            batting_order[i - 1] = fielders[POS_PITCHER];
+    for (int i = 0; i < 9; i++) {
+        if (team->most_common_batting_order[i] == NULL) {
+            batting_order[i] = fielders[POS_PITCHER];
+            batting_order_matchup_rows[i] = 9 + current_pitcher;
             uses_dh = false;
         }
         else {
-            set<Player*> search_results = find_players({player_id});
-            if (search_results.size()) {
-                batting_order[i - 1] = *search_results.begin();
-            }
+            batting_order[i] = team->most_common_batting_order[i];
+            batting_order_matchup_rows[i] = i;
         }
+        batting_order_runner_probabilities[i] = get_runner_probabilities(batting_order[i]);
     }
 }
 
 
 // Pitcher and batting order must be set before calling this
-void Team::set_up_fielders() {
-    vector<string> players_added;
+// Each position goes to the batter who played it the most, out of the ones who don't have a position yet
+void Team_Game_State::set_up_fielders() {
+    bool slot_taken[9] = {};
+    auto take_position = [&](uint slot, eDefensivePositions position) {
+        set_position_in_field(batting_order[slot], position);
+        for (int i = 0; i < 9; i++) {
+            if (batting_order[i] == batting_order[slot]) slot_taken[i] = true; // A player can bat in two slots (ex: a two-way player)
+        }
+    };
+
     for (int i = POS_CATCHER; i < POS_DH; i++) {
-        eDefensivePositions pos_value = (eDefensivePositions)i;
-        Player* best_player = find_best_player_for_defense_pos(pos_value, players_added);
-        set_position_in_field(best_player, pos_value);
-        players_added.push_back(best_player->id);
+        take_position(find_best_slot_for_defense_pos((eDefensivePositions)i, slot_taken), (eDefensivePositions)i);
     }
 
-    Player* dh;
     if (uses_dh)
-        dh = find_best_player_for_defense_pos(POS_DH, players_added);
+        take_position(find_best_slot_for_defense_pos(POS_DH, slot_taken), POS_DH);
     else
-        dh = fielders[POS_PITCHER];
-    
-    set_position_in_field(dh, POS_DH);
+        set_position_in_field(fielders[POS_PITCHER], POS_DH);
 }
 
 
-void Team::set_up_pitchers() {
-    available_pitchers = get_all_pitchers();
+void Team_Game_State::set_up_pitchers() {
+    fill(pitcher_available.begin(), pitcher_available.end(), true);
     pitchers_used.clear();
 }
 
 
-void Team::set_position_in_field(Player* new_player, eDefensivePositions position) {
+// Call this whenever the pitcher changes. Fielders must be set before calling.
+void Team_Game_State::update_steal_defense() {
+    if (!team->has_baserunning_stats()) return;
+
+    const Player* pitcher = fielders[POS_PITCHER];
+    for (int base = FIRST_BASE; base <= SECOND_BASE; base++) {
+        steal_defense.league_attempt_probs[base] = league->steal_attempt_probs[base];
+        steal_defense.league_success_probs[base] = league->steal_success_probs[base];
+
+        float sbo_multiplier = league->sbo_on_first_percent;
+        if (base == SECOND_BASE) sbo_multiplier = 1 - sbo_multiplier;
+
+        // Pitchers without baserunning against stats get the league averages
+        float pitcher_sbo = 0, pitcher_steals = 0, pitcher_caught = 0;
+        if (pitcher->stats.has_stats(PLAYER_BASERUNNING_AGAINST)) {
+            pitcher_sbo = pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, "SB_opp", .0f)*sbo_multiplier;
+            pitcher_steals = pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, BASE_STEALING_STAT_STRINGS[base][0], .0f);
+            pitcher_caught = pitcher->stats.get_stat(PLAYER_BASERUNNING_AGAINST, BASE_STEALING_STAT_STRINGS[base][1], .0f);
+        }
+        if (pitcher_sbo <= 20)
+            steal_defense.attempt[base] = league->steal_attempt_probs[base][1];
+        else
+            steal_defense.attempt[base] = (pitcher_steals + pitcher_caught)/pitcher_sbo;
+
+        const Player* baseman = fielders[BASE_TO_POSITION_KEY[base+1]];
+        if (pitcher_steals + pitcher_caught == 0)
+            steal_defense.success[base] = league->steal_success_probs[base][1];
+        else
+            steal_defense.success[base] = clamp(baseman->stats.get_stat(PLAYER_FIELDING, "f_fielding_perc", .0f) * pitcher_steals/(pitcher_steals + pitcher_caught), MIN_DEFENSE_STOLEN_BASE_PROB, MAX_DEFENSE_STOLEN_BASE_PROB); // We don't want pitchers who never ever give up stolen bases
+    }
+}
+
+
+const Runner_Probabilities& Team_Game_State::get_runner_probabilities(const Player* runner) const {
+    size_t player_index = find(team->all_players.begin(), team->all_players.end(), runner) - team->all_players.begin();
+    debug_line(assert(player_index < team->all_players.size()))
+    return player_runner_probabilities[player_index];
+}
+
+
+void Team_Game_State::set_position_in_field(Player* new_player, eDefensivePositions position) {
     fielders[position] = new_player;
 }
 
 
-// NOTE: only returns players currently in the batting order
-Player* Team::find_best_player_for_defense_pos(eDefensivePositions position, const vector<string>& players_to_exclude) {
+// Returns a slot in the batting order, the first one if every slot is taken
+uint Team_Game_State::find_best_slot_for_defense_pos(eDefensivePositions position, const bool slot_taken[9]) const {
     int max_games_found = -1;
-    Player* best_player = batting_order[0];
-    
-    for (int i = 0; i < 9; i++) {
-        int games_at_pos = batting_order[i]->games_at_fielding_position(position);
-        if ((games_at_pos > max_games_found) && (find(players_to_exclude.begin(), players_to_exclude.end(), batting_order[i]->id) == players_to_exclude.end())) {
+    uint best_slot = 0;
+
+    for (uint i = 0; i < 9; i++) {
+        int games_at_pos = fielding_games[batting_order_matchup_rows[i]].games[position];
+        if ((games_at_pos > max_games_found) && !slot_taken[i]) {
             max_games_found = games_at_pos;
-            best_player = batting_order[i];
+            best_slot = i;
         }
     }
 
-    return best_player;
+    return best_slot;
 }
 
 
-void Team::reset_player_tracking_data() {
-    for (Player* player : all_players) {
-        player->day_of_last_game_played = 1000;
+// Call this after every game the team plays, so the pitchers who played need rest before they pitch again
+void Team_Game_State::rest_pitchers_used(uint day_of_game) {
+    for (uint pitcher : pitchers_used) {
+        pitcher_scheduler.record_game_pitched(pitcher, day_of_game);
+    }
+}
+
+
+void Team_Game_State::reset_player_tracking_data() {
+    pitcher_scheduler.reset();
+}
+
+
+Pitcher_Rest Team_Game_State::get_pitcher_rest(uint day_of_game) const {
+    Pitcher_Rest pitcher_rest;
+    for (uint pitcher = 0; pitcher < team->pitchers.size(); pitcher++) {
+        uint days_of_rest = day_of_game - pitcher_scheduler.get_day_of_last_game_pitched(pitcher); // Wraps around if they haven't pitched
+        if (days_of_rest >= Pitcher_Scheduler::MAX_PITCHER_COOLDOWN) continue;
+        if ((pitcher_rest.num_resting == MAX_RESTING_PITCHERS) || (pitcher > UINT8_MAX)) {
+            pitcher_rest.num_resting = PITCHER_REST_NOT_RECORDED;
+            return pitcher_rest;
+        }
+        pitcher_rest.pitchers[pitcher_rest.num_resting] = pitcher;
+        pitcher_rest.days_of_rest[pitcher_rest.num_resting] = days_of_rest;
+        pitcher_rest.num_resting++;
     }
+    return pitcher_rest;
+}
+
+
+// The pitchers are rested in the order they pitched in, since the scheduler expects days to never go backwards
+void Team_Game_State::set_pitcher_rest(const Pitcher_Rest& pitcher_rest, uint day_of_game) {
+    if (pitcher_rest.num_resting == PITCHER_REST_NOT_RECORDED) {
+        cerr << "Too many " << team->team_stats.team_cache_id << " pitchers were resting to record how rested they were\n";
+        throw exception();
+    }
+    vector<pair<uint, uint>> games_pitched; // (day, pitcher)
+    for (uint i = 0; i < pitcher_rest.num_resting; i++) {
+        if ((pitcher_rest.pitchers[i] >= team->pitchers.size()) || (pitcher_rest.days_of_rest[i] > day_of_game)) {
+            cerr << "Pitcher " << (int)pitcher_rest.pitchers[i] << " of " << team->team_stats.team_cache_id << " can't have rested "
+                 << (int)pitcher_rest.days_of_rest[i] << " days by day " << day_of_game << "\n";
+            throw exception();
+        }
+        games_pitched.push_back({day_of_game - pitcher_rest.days_of_rest[i], pitcher_rest.pitchers[i]});
+    }
+    sort(games_pitched.begin(), games_pitched.end());
+
+    pitcher_scheduler.reset();
+    for (auto [day, pitcher] : games_pitched) pitcher_scheduler.record_game_pitched(pitcher, day);
 }
 
 
-void Team::print_fielders() {
-    cout << team_name + " fielders:\n";
+void Team_Game_State::print_fielders() {
+    cout << team->team_name + " fielders:\n";
     for (int i = 0; i < NUM_DEFENSIVE_POSITIONS; i++) {
         cout << fielders[i]->name << " is starting at " << DEFENSIVE_POSITIONS[i] << "\n";
     }
@@ -294,8 +483,8 @@ void Team::print_fielders() {
 }
 
 
-void Team::print_batting_order() {
-    cout << team_name + " batting order:\n";
+void Team_Game_State::print_batting_order() {
+    cout << team->team_name + " batting order:\n";
     for (int i = 0; i < 9; i++) {
         cout << to_string(i + 1) << ": " << batting_order[i]->name << "\n";
         cout << "\t-Batting Avg: " << batting_order[i]->stats.get_stat(PLAYER_BATTING, "b_batting_avg", .0f) << "\n";
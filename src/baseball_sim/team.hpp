@@ -3,39 +3,134 @@
 #include "utils.hpp"
 #include "player.hpp"
 #include "statistics.hpp"
+#include "registry.hpp"
+#include "pitcher_scheduler.hpp"
 
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <set>
-#include <memory>
 #include <cstdint>
 
 
-class Team {
+// Everything about a team that is known once it is loaded. Never changes after that, so any number of simulations
+// (on any number of threads) can share one definition, each with its own Team_Game_State. It stays loaded until its year is
+// released (see Stat_Loader::release_year).
+class Team_Definition {
     public:
         std::string team_name;
+        Entity_Id entity_id = NO_ENTITY;
         Team_Stats team_stats;
-        bool uses_dh;
 
         std::vector<Player*> all_players;
+        std::vector<Player*> pitchers; // Every pitcher on the team, ordered by player id. Game states refer to pitchers by their index in here.
+        Player* most_common_batting_order[9]; // NULL where the pitcher bats
+
+        Team_Definition(){}
+        Team_Definition(const std::string& team_name, const std::vector<Player*>& players, const Team_Stats& team_stats);
+
+        const std::vector<Player*>& get_players() const {
+            return all_players;
+        }
+
+        // Baserunning, baserunning against and batting against stats only exist from 1912 on
+        bool has_baserunning_stats() const {
+            return team_stats.year >= PLAYER_STAT_EARLIEST_YEARS.at(PLAYER_BASERUNNING);
+        }
+
+        // Matchup tables (see Probability_Store) have a row for each batting order slot, followed by a row for each pitcher
+        // if the pitcher bats. Returns NULL for the slots the pitcher bats in, those rows are never used.
+        uint get_num_matchup_rows() const {
+            return 9 + (pitcher_bats ? pitchers.size() : 0);
+        }
+        Player* get_matchup_row_batter(uint row) const {
+            return (row < 9) ? most_common_batting_order[row] : pitchers[row - 9];
+        }
+
+        std::set<Player*, Player_Ptr_Less> filter_players_by_listed_pos(const std::vector<Table_Entry>& positions = {}) const;
+        std::set<Player*, Player_Ptr_Less> filter_pitchers(const std::vector<Table_Entry>& positions = {}) const;
+
+    private:
+        bool pitcher_bats = false; // Whether most_common_batting_order has a slot for the pitcher
+
+        // Players in each row of the team batting/pitching tables. These are looked up once when the team is built, so setting up a game never searches by id.
+        std::vector<Player*> batting_table_players;
+        std::vector<Player*> pitching_table_players;
+
+        void find_table_players();
+        Player* find_player(const std::string& player_id) const;
+};
+
+
+// Base running probabilities that only depend on the runner. Only filled in for teams that have baserunning stats.
+struct Runner_Probabilities {
+    float steal_attempt[2] = {0, 0}; // Indexed by the base the runner steals from (first or second)
+    float steal_success[2] = {0, 0};
+    float extra_base[2][2] = {{0, 0}, {0, 0}}; // [starting base][single/double], chance of taking an extra base on a hit
+};
+
+// How a pitcher was used in real life, read once from their pitching stats so picking and pulling pitchers never looks up stats by name
+struct Pitcher_Usage {
+    float games_started = 0;
+    float games = 0;
+    float innings_pitched = 0;
+};
+
+// When to pull a pitcher (see Team_Game_State::should_swap_pitcher), worked out once per pitcher from their usage and the league
+struct Pitcher_Hook {
+    uint max_runs = 0; // Pulled once they have allowed more runs than this
+    uint max_innings = 0; // Pulled once they have pitched more full innings than this
+};
+
+// How many games a batter played at each position in real life, indexed by eDefensivePositions
+struct Fielding_Games {
+    int games[NUM_DEFENSIVE_POSITIONS] = {};
+};
+
+// The defense's half of steal attempts (see Base_State::will_runner_attempt_steal), these only change with the pitcher
+struct Steal_Defense_Probabilities {
+    float attempt[2] = {0, 0}; // Indexed by the base the runner steals from
+    float success[2] = {0, 0};
+    const float* league_attempt_probs[2] = {NULL, NULL};
+    const float* league_success_probs[2] = {NULL, NULL};
+};
+
+const uint MAX_RESTING_PITCHERS = 32;
+const uint8_t PITCHER_REST_NOT_RECORDED = UINT8_MAX; // num_resting of a Pitcher_Rest that had more resting pitchers than it can hold
+
+/* How rested a team's pitchers are coming into a game. Anyone who last pitched MAX_PITCHER_COOLDOWN or more days ago is rested
+for every role, and picks between rested pitchers never look at their days of rest, so only the pitchers who pitched since are kept.
+This is everything a team carries over from one game of a simulation to the next. */
+struct Pitcher_Rest {
+    uint8_t num_resting = 0;
+    uint8_t pitchers[MAX_RESTING_PITCHERS] = {}; // Indices in team->pitchers
+    uint8_t days_of_rest[MAX_RESTING_PITCHERS] = {};
+};
+
+
+// What a team looks like during one simulation: its lineup, who is pitching and how rested its pitchers are.
+// Each simulation context owns one of these per team, and it is cheap to copy.
+class Team_Game_State {
+    public:
+        const Team_Definition* team;
+        const League_Constants* league; // This team's league year, resolved once so games never look it up
+        bool uses_dh;
+
         Player* batting_order[9];
         Player* fielders[NUM_DEFENSIVE_POSITIONS];
-        std::set<Player*> available_pitchers;
-        std::vector<Player*> pitchers_used;
+
+        Runner_Probabilities batting_order_runner_probabilities[9]; // Indexed like batting_order
+        uint batting_order_matchup_rows[9]; // Indexed like batting_order, see Team_Definition::get_num_matchup_rows
+        Steal_Defense_Probabilities steal_defense;
 
         uint8_t position_in_batting_order;
         uint8_t runs_allowed_by_pitcher;
         uint8_t current_pitcher_starting_half_inning;
+        uint pitcher_hook_runs; // Copied from the current pitcher's Pitcher_Hook
+        uint pitcher_hook_half_inning; // The first half inning the current pitcher gets pulled in, if he is still pitching
 
-        Team_Running_Stat_Container running_stats;
-
-        Team(){}
-        Team(const std::string& team_name, const std::vector<Player*>& players, const Team_Stats& team_stats);
-
-        const std::vector<Player*>& get_players() {
-            return all_players;
-        }
+        Team_Game_State(){}
+        Team_Game_State(const Team_Definition* team);
 
         inline Player* get_batter() {
             return batting_order[position_in_batting_order];
@@ -45,44 +140,61 @@ class Team {
             return fielders[POS_PITCHER];
         }
 
+        inline uint get_batter_matchup_row() const {
+            return batting_order_matchup_rows[position_in_batting_order];
+        }
 
-        std::set<Player*> filter_players_by_listed_pos(const std::vector<Table_Entry>& positions = {});
-        std::set<Player*> filter_pitchers(const std::vector<Table_Entry>& positions = {});
+        // The current pitcher's index in team->pitchers
+        inline uint get_pitcher_index() const {
+            return current_pitcher;
+        }
 
         Player* try_switching_pitcher(uint8_t current_half_inning, uint current_day_of_year);
-        Player* pick_next_pitcher(uint8_t current_half_inning, uint current_day_of_year);
-        void set_current_pitcher(Player* new_pitcher, uint8_t current_half_inning);
         void set_position_in_field(Player* new_player, eDefensivePositions position);
 
         void print_fielders();
         void print_batting_order();
 
         void prepare_for_game(uint day_of_game, bool keep_batting_order);
+        void resume_game(uint8_t position_in_batting_order, const std::vector<uint>& pitchers_used, uint8_t runs_allowed_by_pitcher, uint8_t pitcher_starting_half_inning);
+        void rest_pitchers_used(uint day_of_game);
         void reset_player_tracking_data();
+        // Between games, ex: to play a game of a simulation again without the games before it (see Game_Identity)
+        Pitcher_Rest get_pitcher_rest(uint day_of_game) const;
+        void set_pitcher_rest(const Pitcher_Rest& pitcher_rest, uint day_of_game);
 
     private:
-        const uint MAX_PITCHER_COOLDOWN = 15; // days
+        static const uint NO_PITCHER = UINT32_MAX;
+
+        // These are all indexed by the pitcher's index in team->pitchers
+        std::vector<bool> pitcher_available;
+        std::vector<uint> pitchers_used;
+        Pitcher_Scheduler pitcher_scheduler;
+        uint current_pitcher = NO_PITCHER;
+
+        // Shared by every game state of this team, see Probability_Store
+        const Runner_Probabilities* player_runner_probabilities = NULL; // Indexed like team->all_players
+        const Pitcher_Usage* pitcher_usage = NULL; // Indexed like team->pitchers
+        const Pitcher_Hook* pitcher_hooks = NULL; // Indexed like team->pitchers
+        const Fielding_Games* fielding_games = NULL; // Indexed by matchup row, like batting_order_matchup_rows
 
         void set_up_batting_order();
         void set_up_fielders();
         void set_up_pitchers();
-
-        Player* pick_starting_pitcher(uint current_day_of_year);
-        Player* pick_relief_pitcher(uint current_day_of_year);
-        std::set<Player*> get_all_pitchers();
-        bool should_swap_pitcher(Player* pitcher, uint8_t current_half_inning);
-
-        std::set<Player*> find_players(const std::vector<std::string>& player_ids) {
-            std::set<Player*> result;
-            for (const std::string& player_id : player_ids) {
-                Player* player = player_cache.at(get_player_cache_id(player_id, team_stats.team_cache_id)).get();
-                result.insert(player);
-            }
-            return result;
-        }
-
-        Player* find_best_player_for_defense_pos(eDefensivePositions position, const std::vector<std::string>& players_to_exclude = {});
+        void update_steal_defense();
+        const Runner_Probabilities& get_runner_probabilities(const Player* runner) const;
+
+        uint pick_next_pitcher(uint8_t current_half_inning, uint current_day_of_year);
+        uint pick_starting_pitcher(uint current_day_of_year);
+        uint pick_relief_pitcher(uint current_day_of_year);
+        uint scan_for_starting_pitcher(uint current_day_of_year);
+        uint scan_for_relief_pitcher(uint current_day_of_year);
+        void set_current_pitcher(uint new_pitcher, uint8_t current_half_inning);
+        bool should_swap_pitcher(uint8_t current_half_inning);
+
+        uint find_best_slot_for_defense_pos(eDefensivePositions position, const bool slot_taken[9]) const;
 };
 
 
-extern std::unordered_map<std::string, std::unique_ptr<Team>> team_cache;
\ No newline at end of file
+// Every loaded team, keyed by get_team_cache_id. Teams and their ids stay valid until their year is released.
+extern Entity_Registry<Team_Definition> team_registry;
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "tournament.hpp"
+
+#include "includes.hpp"
+#include "season.hpp"
+#include "worker_pool.hpp"
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+Tournament::Tournament(const vector<const Team_Definition*>& teams, uint games_in_series, uint sims_per_series) {
+    if (teams.size() < 2) {
+        cerr << "A tournament needs at least two teams\n";
+        throw exception();
+    }
+    if (games_in_series * sims_per_series == 0) {
+        cerr << "Please input a nonzero number of games.\n";
+        throw exception();
+    }
+    this->teams = teams;
+    this->games_in_series = games_in_series;
+    this->sims_per_series = sims_per_series;
+    home_series_won.assign(teams.size()*teams.size(), 0);
+    series_played.assign(teams.size()*teams.size(), 0);
+}
+
+
+void Tournament::play(uint64_t seed, uint num_workers) {
+    struct Chunk {
+        uint home, away, first_sim, num_sims;
+        uint64_t pairing_seed;
+    };
+
+    const vector<Sim_Chunk> series_chunks = split_into_chunks(sims_per_series, games_in_series);
+    vector<Chunk> chunks;
+    uint pairing_index = 0;
+    for (uint home = 0; home < teams.size(); home++) {
+        for (uint away = home + 1; away < teams.size(); away++) {
+            const uint64_t pairing_seed = seed + 0x9E3779B97F4A7C15ull*(++pairing_index); // Keeps the pairings' random streams apart
+            for (const Sim_Chunk& series_chunk : series_chunks) {
+                chunks.push_back({home, away, series_chunk.first_sim, series_chunk.num_sims, pairing_seed});
+            }
+        }
+    }
+    stable_sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b){return a.num_sims > b.num_sims;});
+
+    Worker_Pool worker_pool(num_workers); // Waits for every chunk to finish when it goes out of scope
+    for (const Chunk& chunk : chunks) {
+        worker_pool.submit([this, chunk]() {
+            play_chunk(chunk.home, chunk.away, chunk.first_sim, chunk.num_sims, chunk.pairing_seed);
+        });
+    }
+}
+
+
+void Tournament::play_chunk(uint home, uint away, uint first_sim, uint num_sims, uint64_t pairing_seed) {
+    Series series(teams[home], teams[away], games_in_series, num_sims);
+    series.play(pairing_seed, first_sim);
+
+    lock_guard<mutex> lock(results_mutex);
+    home_series_won[home*teams.size() + away] += series.get_series_won(HOME_TEAM);
+    series_played[home*teams.size() + away] += series.sims_completed;
+}
+
+
+float Tournament::get_series_win_prob(uint team, uint opponent) const {
+    if (team == opponent) return .5f;
+    const uint home = min(team, opponent);
+    const uint away = max(team, opponent);
+    const uint played = series_played[home*teams.size() + away];
+    if (played == 0) return .5f;
+
+    const float home_win_prob = (float)home_series_won[home*teams.size() + away]/played;
+    return (team == home) ? home_win_prob : 1 - home_win_prob;
+}
+
+
+// Each round, a team advances if it won every round so far and beats whichever team comes out of the other half of its block
+vector<float> Tournament::get_bracket_win_probs() const {
+    vector<float> advance_probs(teams.size(), 1);
+    for (size_t block_size = 2; block_size <= teams.size(); block_size *= 2) {
+        vector<float> next_advance_probs(teams.size(), 0);
+        for (size_t team = 0; team < teams.size(); team++) {
+            const size_t block_start = team - team % block_size;
+            const size_t half = block_size/2;
+            const size_t opponents_start = ((team - block_start) < half) ? block_start + half : block_start;
+
+            float win_prob = 0;
+            for (size_t opponent = opponents_start; opponent < opponents_start + half; opponent++) {
+                win_prob += advance_probs[opponent]*get_series_win_prob(team, opponent);
+            }
+            next_advance_probs[team] = advance_probs[team]*win_prob;
+        }
+        advance_probs = next_advance_probs;
+    }
+    return advance_probs;
+}
+
+
+string Tournament::get_team_label(uint team) const {
+    return teams[team]->team_name + "_" + to_string(teams[team]->team_stats.year);
+}
+
+
+void Tournament::print_results() const {
+    const bool is_bracket = (teams.size() & (teams.size() - 1)) == 0;
+    vector<float> bracket_win_probs;
+    if (is_bracket) bracket_win_probs = get_bracket_win_probs();
+
+    cout << fixed << setprecision(3);
+    cout << "SERIES WIN PROBABILITIES (row team beats column team, " << games_in_series << " game series):\n";
+    cout << "TEAM\t";
+    for (uint opponent = 0; opponent < teams.size(); opponent++) cout << "\t" << get_team_label(opponent);
+    cout << "\tAVG" << (is_bracket ? "\tBRACKET" : "") << "\n";
+
+    for (uint team = 0; team < teams.size(); team++) {
+        cout << get_team_label(team) << "\t";
+        float total_win_prob = 0;
+        for (uint opponent = 0; opponent < teams.size(); opponent++) {
+            if (opponent == team) {
+                cout << "\t-";
+                continue;
+            }
+            float win_prob = get_series_win_prob(team, opponent);
+            total_win_prob += win_prob;
+            cout << "\t" << win_prob;
+        }
+        cout << "\t" << total_win_prob/(teams.size() - 1);
+        if (is_bracket) cout << "\t" << bracket_win_probs[team];
+        cout << "\n";
+    }
+    cout << "\n";
+}
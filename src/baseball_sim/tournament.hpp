@@ -0,0 +1,43 @@
+#pragma once
+
+#include "includes.hpp"
+#include "team.hpp"
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+
+/* Round robin between any team-seasons (ex: 64 all-time great teams). Every pair of teams plays sims_per_series series,
+with the team listed first at home, and the results make up a matrix of series win probabilities.
+If the number of teams is a power of two, the matrix also gives each team's odds of winning a single elimination
+bracket seeded in the order the teams are listed (1st vs 2nd, 3rd vs 4th, ...), since any two teams can meet in it.
+
+All the series run on one worker pool. Each pairing is split into chunks of about the same number of games, and the
+biggest chunks are queued first so that no thread is left running one long pairing at the end. Chunks are seeded by
+their pairing and their first simulation, so the results only depend on the seed, not on the number of threads. */
+class Tournament {
+    public:
+        std::vector<const Team_Definition*> teams;
+
+        Tournament(const std::vector<const Team_Definition*>& teams, uint games_in_series, uint sims_per_series);
+
+        void play(uint64_t seed, uint num_workers);
+        void print_results() const;
+
+        float get_series_win_prob(uint team, uint opponent) const; // Chance that team wins a series against opponent
+        std::vector<float> get_bracket_win_probs() const; // Only valid when the number of teams is a power of two
+
+    private:
+        uint games_in_series;
+        uint sims_per_series;
+
+        // Indexed by [team*num_teams + opponent], only filled in for team < opponent (the home team)
+        std::vector<uint> home_series_won;
+        std::vector<uint> series_played;
+        std::mutex results_mutex;
+
+        void play_chunk(uint home, uint away, uint first_sim, uint num_sims, uint64_t pairing_seed);
+        std::string get_team_label(uint team) const;
+};
@@ -3,9 +3,59 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <stdexcept>
 
 using namespace std;
 
+#if BASEBALL_VIEW
+bool game_viewer_enabled = true;
+#endif
+
+
+Run_Options parse_run_options(int argc, char* argv[]) {
+    Run_Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) { // Not an option, so it is either the command or one of its arguments
+            if (options.command.empty()) options.command = arg;
+            else options.command_args.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for option " << arg << "\n";
+            throw exception();
+        }
+
+        if (arg == "--resume") {
+            options.resume_filename = argv[++i];
+        }
+        else if (arg == "--checkpoint") {
+            options.checkpoint_filename = argv[++i];
+        }
+        else if (arg == "--checkpoint-interval") {
+            options.checkpoint_interval = stof(argv[++i]);
+        }
+        else if (arg == "--seed") {
+            options.has_seed = true;
+            options.seed = stoull(argv[++i]);
+        }
+        else if (arg == "--first-sim") {
+            options.first_sim = stoul(argv[++i]);
+        }
+        else if (arg == "--workers") {
+            options.num_workers = stoul(argv[++i]);
+        }
+        else if (arg == "--event-log") {
+            options.event_log_filename = argv[++i];
+        }
+        else {
+            cerr << "Unknown option: " << arg << "\n";
+            throw exception();
+        }
+    }
+    return options;
+}
+
 
 string get_user_choice(const string& prompt, const vector<string>& choices) {
     string input = "";
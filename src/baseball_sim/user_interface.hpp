@@ -4,6 +4,38 @@
 #include <vector>
 #include <iostream>
 
+#include <cstdint>
+
+/* Options that can be passed on the command line. A run can also be fully described on the command line with a command:
+    season YEAR SIMS
+    series HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAMES SIMS
+    merge SHARD_FILE...
+    serve [SOCKET_PATH]
+    tournament GAMES SIMS TEAM YEAR TEAM YEAR [TEAM YEAR]...
+    expectancy YEAR SIMS [OUTPUT_DIR]
+    rollout HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR INNING top|bottom OUTS BASES AWAY_SCORE HOME_SCORE [ROLLOUTS]
+    player-value TEAM YEAR SIMS
+    replay HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAME_CODE
+    find-game season YEAR SIM GAME | find-game series HOME_TEAM HOME_YEAR AWAY_TEAM AWAY_YEAR GAMES SIM GAME (with the run's --seed)
+    check-sampling [DRAWS]
+    compile-stats
+    decode-events EVENT_LOG_FILE
+If no command is given, everything about the run is prompted for. */
+struct Run_Options {
+    std::string command = "";
+    std::vector<std::string> command_args;
+
+    std::string resume_filename = "";                   // --resume FILE: continue the run saved in this checkpoint
+    std::string checkpoint_filename = "simulation.ckpt"; // --checkpoint FILE: where to save checkpoints (and the shard file of a sharded run)
+    float checkpoint_interval = 300;                    // --checkpoint-interval SECONDS: time between checkpoints (0 to only save when the run stops)
+    bool has_seed = false;
+    uint64_t seed = 0;                                  // --seed N: base seed of the run, shards of the same run must use the same seed
+    unsigned int first_sim = 0;                         // --first-sim N: index of the first simulation this process runs (for sharded runs)
+    unsigned int num_workers = 0;                       // --workers N: number of simulation threads for the server, tournaments, expectancy tables, rollouts and player values (0 means one per core)
+    std::string event_log_filename = "";                // --event-log FILE: write every game of a season or series run to this event log
+};
+
+Run_Options parse_run_options(int argc, char* argv[]);
 std::string get_user_choice(const std::string& prompt, const std::vector<std::string>& choices);
 std::string get_simulation_type();
 void wait_for_user_input(const std::string& prompt);
@@ -0,0 +1,62 @@
+#include "worker_pool.hpp"
+
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+
+vector<Sim_Chunk> split_into_chunks(uint num_sims, size_t games_per_sim) {
+    const uint sims_per_chunk = max<uint>(GAMES_PER_CHUNK/max<size_t>(games_per_sim, 1), 1);
+    vector<Sim_Chunk> chunks;
+    for (uint first_sim = 0; first_sim < num_sims; first_sim += sims_per_chunk) {
+        chunks.push_back({first_sim, min(sims_per_chunk, num_sims - first_sim)});
+    }
+    return chunks;
+}
+
+
+Worker_Pool::Worker_Pool(uint num_workers) {
+    for (uint i = 0; i < max(num_workers, 1u); i++) {
+        workers.emplace_back(&Worker_Pool::work, this);
+    }
+}
+
+
+Worker_Pool::~Worker_Pool() {
+    {
+        lock_guard<mutex> lock(jobs_mutex);
+        stopping = true;
+    }
+    jobs_available.notify_all();
+    for (thread& worker : workers) worker.join();
+}
+
+
+void Worker_Pool::submit(const function<void()>& job) {
+    {
+        lock_guard<mutex> lock(jobs_mutex);
+        jobs.push(job);
+    }
+    jobs_available.notify_one();
+}
+
+
+void Worker_Pool::work() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> lock(jobs_mutex);
+            jobs_available.wait(lock, [this]{return stopping || !jobs.empty();});
+            if (stopping && jobs.empty()) return;
+            job = jobs.front();
+            jobs.pop();
+        }
+        job();
+    }
+}
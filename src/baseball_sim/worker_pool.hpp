@@ -0,0 +1,40 @@
+#pragma once
+
+#include "includes.hpp"
+
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+
+const uint GAMES_PER_CHUNK = 5000; // Roughly how many games each job on the worker pool plays
+
+struct Sim_Chunk {
+    uint first_sim;
+    uint num_sims;
+};
+
+// Splits a run of num_sims simulations (of games_per_sim games each) into chunks of about GAMES_PER_CHUNK games for a worker pool
+std::vector<Sim_Chunk> split_into_chunks(uint num_sims, size_t games_per_sim);
+
+
+// Fixed set of threads that run queued jobs in order. Destroying the pool waits for every queued job to finish.
+class Worker_Pool {
+    public:
+        Worker_Pool(uint num_workers);
+        ~Worker_Pool();
+
+        void submit(const std::function<void()>& job);
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> jobs;
+        std::mutex jobs_mutex;
+        std::condition_variable jobs_available;
+        bool stopping = false;
+
+        void work();
+};